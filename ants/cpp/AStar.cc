@@ -13,7 +13,7 @@ AStar::AStar( const Map& map, const Location& start, const Location& destination
       m_destination( destination ),
       m_max_depth( 40 )
 {
-    m_open.push_back( new Node( start, NONE, 0, m_map.manhattanDistance( start, destination ), 0 ) );
+    m_open.push_back( new Node( start, NONE, 0, m_map.distanceLowerBound( start, destination ), 0 ) );
 }
 
 
@@ -108,7 +108,7 @@ bool AStar::step()
             Node* neighbor_node = new Node( neighbor_loc,
                                             static_cast<Direction>( i ),
                                             current->g+1,
-                                            m_map.manhattanDistance( neighbor_loc, m_destination ),
+                                            m_map.distanceLowerBound( neighbor_loc, m_destination ),
                                             current ); 
             m_open.push_back( neighbor_node );
             std::push_heap( m_open.begin(), m_open.end(), NodeCompare() );
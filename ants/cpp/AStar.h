@@ -124,7 +124,7 @@ AStar::AStar( const Map& map, Iter begins, Iter ends, const Location& destinatio
       m_max_depth( 40 )
 {
     for( Iter it = begins; it != ends; ++it )
-        m_open.push_back( new Node( *it, NONE, 0, m_map.manhattanDistance( *it, destination ), 0 ) );
+        m_open.push_back( new Node( *it, NONE, 0, m_map.distanceLowerBound( *it, destination ), 0 ) );
     std::make_heap( m_open.begin(), m_open.end(), NodeCompare() );
 }
 
@@ -27,6 +27,8 @@ public:
     Assignment assignment; //< What is this ants job
     Location   goal;       //< Destination for this ant
     Path       path;       //< Path to destination
+    bool       has_vision; //< Is this ants view counted in State's vision?
+    Location   vision;     //< Where this ants view was last counted
 
 private:
     Ant& operator=( Ant& );
@@ -37,7 +39,9 @@ private:
 inline Ant::Ant( const Location& location )
     : location( location ),
       assignment( EXPLORE ),
-      goal( location )
+      goal( location ),
+      has_vision( false ),
+      vision( location )
 {
 }
 
@@ -2,79 +2,12 @@
 #ifndef BF_H_
 #define BF_H_
 
+#include "BFWorkspace.h"
 #include "Debug.h"
 #include "Direction.h"
 #include "Location.h"
 #include "Map.h"
 
-#include <algorithm>
-#include <deque>
-#include <map>
-#include <vector>
-
-class Map;
-
-//------------------------------------------------------------------------------
-//
-// BF::BFNode methods
-//
-//------------------------------------------------------------------------------
-
-struct BFNode
-{
-    BFNode( const Location& loc,
-            Square* square,
-            Direction dir,
-            unsigned depth,
-            BFNode* child ) 
-        : loc( loc ),
-          square( square ),
-          dir( dir ),
-          depth( depth ),
-          child( child )
-          
-        {}
-
-    void getPath( Path& path )const;
-    void getRPath( Path& path )const;
-
-    Location  loc;
-    Square*   square;
-    Direction dir;
-    unsigned  depth;
-    BFNode*   child;
-};
-
-inline void BFNode::getPath( Path& path )const
-{
-    // Backtrack to create path
-    path.reset();
-
-    std::deque<Direction> dirs;
-    for( const BFNode* current = this; current->child != 0; current = current->child )
-    {
-        dirs.push_front( current->dir );
-    }
-    path.assign( loc, dirs.begin(), dirs.end() );
-}
-
-
-inline void BFNode::getRPath( Path& path )const
-{
-    // Backtrack to create path
-    path.reset();
-
-    std::vector<Direction> dirs;
-    Location destination;
-    for( const BFNode* current = this; current->child != 0; current = current->child )
-    {
-        dirs.push_back( reverseDirection( current->dir ) );
-        destination = current->child->loc;
-    }
-    path.assign( destination, dirs.begin(), dirs.end() );
-}
-
-
 //------------------------------------------------------------------------------
 //
 // Action: bool (*Action)( const BFNode* node )
@@ -86,6 +19,9 @@ inline void BFNode::getRPath( Path& path )const
 //                                       const Square& neighbor )
 //    - returns true if this square is traversable for this search
 //
+// Nodes live in a pooled BFWorkspace for the lifetime of the BF, so a
+// search allocates nothing once the pool is warm.
+//
 //------------------------------------------------------------------------------
 template< class Action, class ValidNeighbor >
 class BF
@@ -109,23 +45,9 @@ private:
     BF& operator=( const BF& );
     
 
-    /// For searching stl containers for node with a given location
-    struct HasLocation
-    {
-        HasLocation( const Location& location ) : location( location ) {}
-        bool operator()( BFNode* node )const { return node->loc == location; }
-        Location location;
-    };
-
     bool step();
 
-
-    typedef std::deque<BFNode*>            BFNodeQueue;
-    typedef std::map<Location, BFNode*>    LocationToBFNode;
-
-    BFNodeQueue              m_open;
-    LocationToBFNode         m_closed;
-
+    BFWorkspace*           m_workspace;
     Map&                   m_map;
     Action&                m_action;
     ValidNeighbor&         m_valid_neighbor;
@@ -147,12 +69,14 @@ BF<Action, ValidNeighbor>::BF( Map& map,
                              const Location& start_loc,
                              Action& action,
                              ValidNeighbor& valid_neighbor )
-  : m_map( map ),
+  : m_workspace( BFWorkspace::acquire() ),
+    m_map( map ),
     m_action( action ),
     m_valid_neighbor( valid_neighbor ),
     m_max_depth( 25u )
 {
-    m_open.push_back( new BFNode( start_loc, &m_map( start_loc ), NONE, 0u, NULL ) );
+    m_workspace->begin( m_map.height(), m_map.width() );
+    addStartLocation( start_loc );
 }
 
 
@@ -160,96 +84,87 @@ template< class Action, class ValidNeighbor >
 BF<Action, ValidNeighbor>::BF( Map& map,
                              Action& action,
                              ValidNeighbor& valid_neighbor )
-  : m_map( map ),
+  : m_workspace( BFWorkspace::acquire() ),
+    m_map( map ),
     m_action( action ),
     m_valid_neighbor( valid_neighbor ),
     m_max_depth( 25u )
 {
+    m_workspace->begin( m_map.height(), m_map.width() );
 }
 
 
 template< class Action, class ValidNeighbor >
 BF<Action, ValidNeighbor>::~BF()
 {
-    for( BFNodeQueue::iterator it = m_open.begin(); it != m_open.end(); ++it )
-        delete *it;
-    m_open.clear();
-
-    for( LocationToBFNode::iterator it = m_closed.begin(); it != m_closed.end(); ++it )
-        delete it->second;
-    m_closed.clear();
+    BFWorkspace::release( m_workspace );
 }
 
 
 template< class Action, class ValidNeighbor >
 void BF<Action, ValidNeighbor>::addStartLocation( const Location& start_loc )
 {
-    m_open.push_back( new BFNode( start_loc, &m_map( start_loc ), NONE, 0u, NULL ) );
+    const unsigned index = start_loc.row*m_map.width() + start_loc.col;
+    if( !m_workspace->visit( index ) ) return;
+
+    m_workspace->node( index ) = BFNode( start_loc, &m_map, NONE, 0u, NULL );
+    m_workspace->push( index );
 }
 
 
 template< class Action, class ValidNeighbor >
 void BF<Action, ValidNeighbor>::traverse()
 {
-    while( !m_open.empty() && step() ) ;
+    while( !m_workspace->empty() && step() ) ;
 }
 
 
 template< class Action, class ValidNeighbor >
 bool BF<Action, ValidNeighbor>::step()
 {
-    BFNode* current =  m_open.front();
+    BFNode* current = &m_workspace->node( m_workspace->front() );
 
     //
     // Check to see if we have reached our goal
     //
     if( !m_action( current ) ) return false;
 
-    //
-    // Move current from open to closed list 
-    //
-    m_open.pop_front();
-    m_closed.insert( std::make_pair( current->loc, current ) );
+    m_workspace->pop();
 
     //
     // Process all neighbors
     //
-    if( current->depth < m_max_depth /*&& ( m_map( current->loc ).isTraversable() || current->depth == 0 ) */ )
+    if( current->depth < m_max_depth )
     {
-        for( int i = 0; i < NUM_DIRECTIONS; ++i )
+        const int height = m_map.height();
+        const int width  = m_map.width();
+        for( int i = 0; i < NONE; ++i )
         {
-            const Location neighbor_loc = m_map.getLocation( current->loc, static_cast<Direction>( i ) );
-            
-            // Check if the neighbor is available to be traversed
-            if( !m_map( neighbor_loc ).isLand() ||
-                !m_valid_neighbor( current, neighbor_loc, m_map( neighbor_loc ) ) )
-            {
-                //Debugstream() << "      not avail " << std::endl;
-                continue;
-            }
-
-            // Check if neighbor is already in open set
-            if( std::find_if( m_open.begin(), m_open.end(), HasLocation( neighbor_loc ) ) != m_open.end() )
-            {
-                //Debugstream() << "      in open set" << std::endl;
-                continue;
-            }
-
-            // Check to see if this neighbor is in closed set 
-            if( m_closed.find( neighbor_loc ) != m_closed.end() )
+            Location neighbor_loc( current->loc.row + DIRECTION_OFFSET[ i ][ 0 ],
+                                   current->loc.col + DIRECTION_OFFSET[ i ][ 1 ] );
+            if     ( neighbor_loc.row <  0      ) neighbor_loc.row += height;
+            else if( neighbor_loc.row >= height ) neighbor_loc.row -= height;
+            if     ( neighbor_loc.col <  0      ) neighbor_loc.col += width;
+            else if( neighbor_loc.col >= width  ) neighbor_loc.col -= width;
+
+            const unsigned index = neighbor_loc.row*width + neighbor_loc.col;
+            const Square neighbor = m_map( neighbor_loc );
+
+            // Check if the neighbor is available to be traversed and not
+            // already open or closed
+            if( !neighbor.isLand() ||
+                !m_valid_neighbor( current, neighbor_loc, neighbor ) ||
+                !m_workspace->visit( index ) )
             {
-                //Debugstream() << "      in closed set" << std::endl;
                 continue;
             }
 
-            // Insert this location into open set
-            //Debugstream() << "       pushing " << std::endl;
-            BFNode* neighbor_node = new BFNode( neighbor_loc,
-                                                &m_map( neighbor_loc ),
-                                                static_cast<Direction>( i ),
-                                                current->depth+1,
-                                                current );
-            m_open.push_back( neighbor_node  );
+            m_workspace->node( index ) = BFNode( neighbor_loc,
+                                                 &m_map,
+                                                 static_cast<Direction>( i ),
+                                                 current->depth+1,
+                                                 current );
+            m_workspace->push( index );
         }
     }
 
@@ -5,24 +5,47 @@
 #include "Path.h"
 
 #include <algorithm>
+#include <deque>
 
 
 BFS::BFS( const Map& map, const Location& start_loc, Predicate predicate )
-  : m_map( map ),
+  : m_workspace( BFWorkspace::acquire() ),
+    m_map( map ),
     m_predicate( predicate ),
     m_max_depth( 25u )
 {
-    m_open.push_back( new Node( start_loc ) );
+    startSearch();
+    addStartLocation( start_loc );
+}
+
+
+BFS::~BFS()
+{
+    BFWorkspace::release( m_workspace );
+}
+
+
+void BFS::startSearch()
+{
+    m_workspace->begin( m_map.height(), m_map.width() );
+}
+
+
+void BFS::addStartLocation( const Location& start_loc )
+{
+    const unsigned index = start_loc.row*m_map.width() + start_loc.col;
+    if( !m_workspace->visit( index ) ) return;
+
+    m_workspace->node( index ) = BFNode( start_loc, NULL, NONE, 0u, NULL );
+    m_workspace->push( index );
 }
 
 
 bool BFS::search()
 {
     //Debug::stream() << "BFS searching from locations  ..." << std::endl;
-    //for( NodeQueue::iterator it = m_open.begin(); it != m_open.end(); ++it )
-    //    Debug::stream() <<  "    " << (*it)->loc << std::endl;
 
-    while( !m_open.empty() )
+    while( !m_workspace->empty() )
     {
         if( step() ) return true;
     }
@@ -33,7 +56,7 @@ bool BFS::search()
 
 bool BFS::step()
 {
-    Node* current =  m_open.front();
+    const BFNode* current = &m_workspace->node( m_workspace->front() );
 
     //Debug::stream() << "  Checking " << current->loc << std::endl;
     //
@@ -49,41 +72,27 @@ bool BFS::step()
             m_path.push_back( current->dir );
             current = current->child;
         }
-        m_origin = current->child ? current->child->loc : current->loc;
-
-        // Clean up
-        for( NodeQueue::const_iterator it = m_open.begin(); it != m_open.end(); ++it )
-            delete *it;
-        m_open.clear();
+        m_origin = current->loc;
 
-        for( LocationToNode::const_iterator it = m_closed.begin(); it != m_closed.end(); ++it )
-            delete it->second;
-        m_closed.clear();
+        // Later searches start afresh
+        startSearch();
 
         // Indicate search completion
         return true;
     }
 
-    //
-    // Move current from open to closed list 
-    //
-    m_open.pop_front();
-    m_closed.insert( std::make_pair( current->loc, current ) );
+    m_workspace->pop();
 
     //
     // Process all neighbors
     //
     if( current->depth < m_max_depth )
     {
-        for( int i = 0; i < NUM_DIRECTIONS; ++i )
+        for( int i = 0; i < NONE; ++i )
         {
             const Location neighbor_loc = m_map.getLocation( current->loc, static_cast<Direction>( i ) );
+            const unsigned index        = neighbor_loc.row*m_map.width() + neighbor_loc.col;
             
-            /*
-            // Check if the neighbor is available to be traversed
-            if( !m_map( neighbor_loc ).isAvailable() ) 
-            */
-
             if( ( current->depth == 0 && !m_map( neighbor_loc ).isAvailable() ) ||
                 m_map( neighbor_loc ).isWater() )                    
                 
@@ -92,27 +101,21 @@ bool BFS::step()
                 continue;
             }
 
-            // Check if neighbor is already in open set
-            if( std::find_if( m_open.begin(), m_open.end(), HasLocation( neighbor_loc ) ) != m_open.end() )
-            {
-                //Debug::stream() << "  in open set" << std::endl;
-                continue;
-            }
-
-            // Check to see if this neighbor is in closed set 
-            if( m_closed.find( neighbor_loc ) != m_closed.end() )
+            // Check if neighbor is already in open or closed set
+            if( !m_workspace->visit( index ) )
             {
-                //Debug::stream() << "  in closed set" << std::endl;
+                //Debug::stream() << "  already visited" << std::endl;
                 continue;
             }
 
             // Insert this location into open set
             //Debug::stream() << "   pushing " << std::endl;
-            Node* neighbor_node = new Node( neighbor_loc,
-                                            static_cast<Direction>( i ),
-                                            current->depth+1,
-                                            current );
-            m_open.push_back( neighbor_node  );
+            m_workspace->node( index ) = BFNode( neighbor_loc,
+                                                 NULL,
+                                                 static_cast<Direction>( i ),
+                                                 current->depth+1,
+                                                 const_cast<BFNode*>( current ) );
+            m_workspace->push( index );
         }
     }
 
@@ -2,11 +2,10 @@
 #ifndef BFS_H_
 #define BFS_H_
 
+#include "BFWorkspace.h"
 #include "Location.h"
 #include "Direction.h"
 
-#include <map>
-#include <deque>
 #include <vector>
 
 class Map;
@@ -24,6 +23,8 @@ public:
     template<class Iter>
     BFS( const Map& map, Iter begin, Iter end, Predicate predicate );
 
+    ~BFS();
+
     void setMaxDepth( unsigned max_depth )   { m_max_depth = max_depth; }
 
     bool search();
@@ -44,37 +45,12 @@ private:
     BFS& operator=( const BFS& );
     
 
-    struct Node
-    {
-        Node( const Location& loc ) 
-            : loc( loc ), dir( NONE ), depth( 0u ), child( 0 ) {}
-        
-        Node( const Location& loc, Direction dir, unsigned depth, Node* child ) 
-            : loc( loc ), dir( dir ), depth( depth ), child( child ) {}
-
-        Location  loc;
-        Direction dir;
-        unsigned  depth;
-        Node*     child;
-    };
-
-    /// For searching stl containers for node with a given location
-    struct HasLocation
-    {
-        HasLocation( const Location& location ) : location( location ) {}
-        bool operator()( Node* node )const { return node->loc == location; }
-        Location location;
-    };
-
     bool step();
+    void startSearch();
+    void addStartLocation( const Location& start_loc );
 
-
-    typedef std::deque<Node*>            NodeQueue;
-    typedef std::map<Location, Node*>    LocationToNode;
-
+    BFWorkspace*           m_workspace;
     const Map&             m_map;
-    NodeQueue              m_open;
-    LocationToNode         m_closed;
 
     std::vector<Direction> m_path;
     Location               m_origin; 
@@ -87,12 +63,14 @@ private:
 
 template<class Iter>
 BFS::BFS( const Map& map, Iter begins, Iter ends, Predicate predicate )
-    : m_map( map ),
-      m_max_depth( 25u ),
-      m_predicate( predicate )
+    : m_workspace( BFWorkspace::acquire() ),
+      m_map( map ),
+      m_predicate( predicate ),
+      m_max_depth( 25u )
 {
+    startSearch();
     for( Iter it = begins; it != ends; ++it )
-        m_open.push_back( new Node( *it ) );
+        addStartLocation( *it );
 }
 
 
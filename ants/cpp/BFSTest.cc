@@ -15,7 +15,7 @@ struct FindHill
 {
     bool operator()( const BFNode* node )
     {
-        if( node->square->hill_id > 0 )
+        if( node->square().hill_id > 0 )
         {
             node->getPath( path );
             node->getRPath( rpath );
@@ -44,7 +44,7 @@ struct FindAnts
 {
     bool operator()( const BFNode* node )
     {
-        if( node->square->ant_id == 0 )
+        if( node->square().ant_id == 0 )
         {
             ants.push_back( node->loc );
         }
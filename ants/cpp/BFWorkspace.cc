@@ -0,0 +1,97 @@
+
+#include "BFWorkspace.h"
+#include "Path.h"
+
+#include <algorithm>
+#include <deque>
+
+
+namespace
+{
+    // Workspaces are few and live for the whole game
+    struct Pool
+    {
+        ~Pool()
+        {
+            for( std::vector<BFWorkspace*>::iterator it = all.begin(); it != all.end(); ++it )
+                delete *it;
+        }
+
+        std::vector<BFWorkspace*> all;
+        std::vector<BFWorkspace*> free;
+    };
+
+    thread_local Pool pool;
+}
+
+
+BFWorkspace* BFWorkspace::acquire()
+{
+    if( pool.free.empty() )
+    {
+        pool.all.push_back( new BFWorkspace );
+        return pool.all.back();
+    }
+
+    BFWorkspace* workspace = pool.free.back();
+    pool.free.pop_back();
+    return workspace;
+}
+
+
+void BFWorkspace::release( BFWorkspace* workspace )
+{
+    pool.free.push_back( workspace );
+}
+
+
+void BFWorkspace::begin( unsigned height, unsigned width )
+{
+    const unsigned num_squares = height*width;
+    if( m_stamps.size() != num_squares )
+    {
+        m_stamps.assign( num_squares, 0u );
+        m_nodes.resize( num_squares );
+        m_queue.resize( num_squares );
+        m_generation = 0u;
+    }
+
+    if( ++m_generation == 0u )
+    {
+        std::fill( m_stamps.begin(), m_stamps.end(), 0u );
+        m_generation = 1u;
+    }
+
+    m_head = 0u;
+    m_size = 0u;
+}
+
+
+void BFNode::getPath( Path& path )const
+{
+    // Backtrack to create path
+    path.reset();
+
+    std::deque<Direction> dirs;
+    for( const BFNode* current = this; current->child != 0; current = current->child )
+    {
+        dirs.push_front( current->dir );
+    }
+    path.assign( loc, dirs.begin(), dirs.end() );
+}
+
+
+void BFNode::getRPath( Path& path )const
+{
+    // Backtrack to create path
+    path.reset();
+
+    std::vector<Direction> dirs;
+    Location destination;
+    for( const BFNode* current = this; current->child != 0; current = current->child )
+    {
+        dirs.push_back( reverseDirection( current->dir ) );
+        destination = current->child->loc;
+    }
+    path.assign( destination, dirs.begin(), dirs.end() );
+}
@@ -0,0 +1,113 @@
+
+#ifndef BFWORKSPACE_H_
+#define BFWORKSPACE_H_
+
+#include "Direction.h"
+#include "Location.h"
+#include "Map.h"
+
+#include <vector>
+
+class Path;
+
+//------------------------------------------------------------------------------
+//
+// BFNode: a square reached by a breadth first search, viewed in map by
+// square().  child is the node it was reached from, NULL for start locations.
+//
+//------------------------------------------------------------------------------
+
+struct BFNode
+{
+    BFNode()
+        : map( 0 ),
+          dir( NONE ),
+          depth( 0u ),
+          child( 0 )
+        {}
+
+    BFNode( const Location& loc,
+            Map* map,
+            Direction dir,
+            unsigned depth,
+            BFNode* child )
+        : loc( loc ),
+          map( map ),
+          dir( dir ),
+          depth( depth ),
+          child( child )
+
+        {}
+
+    void getPath( Path& path )const;
+    void getRPath( Path& path )const;
+
+    Square square()const { return (*map)( loc ); }
+
+    Location  loc;
+    Map*      map;
+    Direction dir;
+    unsigned  depth;
+    BFNode*   child;
+};
+
+
+//------------------------------------------------------------------------------
+//
+// BFWorkspace: per square node storage, visited stamps and the open queue
+// for one breadth first search over a map, kept between searches.
+//
+//   - A search begins by bumping the generation; a square is visited in this
+//     search if its stamp equals the generation, so nothing is cleared
+//   - Each square is queued at most once per search, so the open queue is a
+//     ring buffer with one slot per square that never overflows
+//   - Workspaces are pooled per thread.  acquire() hands out a free one, so
+//     a search started from inside another gets its own
+//
+//------------------------------------------------------------------------------
+
+class BFWorkspace
+{
+public:
+    static BFWorkspace* acquire();
+    static void         release( BFWorkspace* workspace );
+
+    /// Start a new search over a map of height x width
+    void begin( unsigned height, unsigned width );
+
+    /// Mark a square visited, returning false if it already was
+    bool visit( unsigned index )
+    {
+        if( m_stamps[ index ] == m_generation ) return false;
+        m_stamps[ index ] = m_generation;
+        return true;
+    }
+
+    BFNode& node( unsigned index )             { return m_nodes[ index ];  }
+
+    bool     empty()const                      { return m_size == 0u;      }
+    unsigned front()const                      { return m_queue[ m_head ]; }
+    void     pop()                             { m_head = next( m_head ); --m_size; }
+    void     push( unsigned index )            { m_queue[ next( m_head, m_size ) ] = index; ++m_size; }
+
+private:
+    BFWorkspace() : m_generation( 0u ), m_head( 0u ), m_size( 0u ) {}
+    BFWorkspace( const BFWorkspace& );
+    BFWorkspace& operator=( const BFWorkspace& );
+
+    unsigned next( unsigned slot, unsigned count = 1u )const
+    {
+        slot += count;
+        return slot >= m_queue.size() ? slot - m_queue.size() : slot;
+    }
+
+    std::vector<unsigned>  m_stamps;
+    std::vector<BFNode>    m_nodes;
+    std::vector<unsigned>  m_queue;
+    unsigned               m_generation;
+    unsigned               m_head;
+    unsigned               m_size;
+};
+
+
+#endif // BFWORKSPACE_H_
@@ -1,5 +1,6 @@
 
 
+#include <algorithm>
 #include <cstring>
 #include <iterator>
 #include <map>
@@ -138,7 +139,7 @@ namespace
 
         bool operator()( const BFNode* node )
         { 
-            int other_ant_id = node->square->ant_id;
+            int other_ant_id = node->square().ant_id;
             if( other_ant_id >= 0 && other_ant_id != ant_id  )
             {
                 if( !found_enemy ) // First enemy found for this ant
@@ -164,7 +165,7 @@ namespace
 
         bool operator()( const BFNode* node )
         { 
-            int other_ant_id = node->square->ant_id;
+            int other_ant_id = node->square().ant_id;
             if( other_ant_id >= 0 && other_ant_id != ant_id  )
             {
                 found_enemy = true;
@@ -731,26 +732,23 @@ Battle::Battle( Map& map, AssignedAnts& food_ants )
       m_food_ants( food_ants )
 {
     //
-    // create m_grid
+    // create m_grid, rows of one contiguous array of tiles
     //
     const unsigned height = m_map.height();
     const unsigned width  = m_map.width();
-    m_grid = new CombatTile*[ height ];
+    m_tiles = new CombatTile[ height*width ];
+    m_grid  = new CombatTile*[ height ];
     for( unsigned i = 0; i < height; ++i )
-        m_grid[i] = new CombatTile[ width ];
+        m_grid[i] = m_tiles + i*width;
 }
 
 
 Battle::~Battle()
 {
-    const unsigned height = m_map.height();
-    for( unsigned i = 0; i < height; ++i )
-    {
-        delete m_grid[i];
-    }
-    delete m_grid;
-    m_grid = 0u;
-
+    delete [] m_grid;
+    delete [] m_tiles;
+    m_grid  = 0u;
+    m_tiles = 0u;
 }
 
 
@@ -759,11 +757,7 @@ void Battle::solve( const Ants& ants, const Locations& enemy_ants )
     //
     // Reset state 
     //
-    const unsigned height = m_map.height();
-    const unsigned width  = m_map.width();
-    for( unsigned i = 0; i < height; ++i )
-        for( unsigned j = 0; j < width; ++j )
-            m_grid[i][j].reset();
+    std::fill( m_tiles, m_tiles + m_map.height()*m_map.width(), CombatTile() );
 
     m_allies.clear();
     m_enemies.clear();
@@ -63,7 +63,8 @@ private:
     LocationSet   m_assigned_tiles;   //< Tiles already used in fill methods 
 
 
-    CombatTile** m_grid; 
+    CombatTile*  m_tiles;             //< m_map.height() x m_map.width(), row major
+    CombatTile** m_grid;              //< Rows of m_tiles
 };
 
 
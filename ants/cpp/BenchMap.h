@@ -0,0 +1,75 @@
+
+#ifndef BENCHMAP_H_
+#define BENCHMAP_H_
+
+#include "Map.h"
+
+#include <cstdlib>
+#include <vector>
+
+//
+// Synthetic maps for the benchmarks, driven by rand() so a seed reproduces
+// them: land with square blobs of water, and ants' view circles marked
+// visible.
+//
+
+const int BENCH_VIEW_RADIUS2 = 77;
+
+
+inline Location randomLand( const Map& map )
+{
+    while( true )
+    {
+        Location loc( rand() % map.height(), rand() % map.width() );
+        if( map( loc ).isLand() )
+            return loc;
+    }
+}
+
+
+/// Turn a square of radius 1 to 3 around a random center to water.  Squares
+/// which were not water already are appended to water, if given
+inline void addWaterBlob( Map& map, std::vector<Location>* water = 0 )
+{
+    const int h      = map.height();
+    const int w      = map.width();
+    const int row    = rand() % h;
+    const int col    = rand() % w;
+    const int radius = 1 + rand() % 3;
+    for( int i = -radius; i <= radius; ++i )
+        for( int j = -radius; j <= radius; ++j )
+        {
+            Square square = map( ( row+i+h ) % h, ( col+j+w ) % w );
+            if( water && square.type != Square::WATER )
+                water->push_back( Location( ( row+i+h ) % h, ( col+j+w ) % w ) );
+            square.type = Square::WATER;
+        }
+}
+
+
+/// Random blobs of water over about a tenth of the map, land elsewhere
+inline void makeTerrain( Map& map )
+{
+    for( unsigned i = 0; i < map.height(); ++i )
+        for( unsigned j = 0; j < map.width(); ++j )
+            map( i, j ).type = Square::LAND;
+
+    for( unsigned blob = 0; blob < map.height()*map.width() / 160; ++blob )
+        addWaterBlob( map );
+}
+
+
+/// Mark the squares within view of the ants visible
+inline void updateVision( Map& map, const std::vector<Location>& ants )
+{
+    const int h = map.height();
+    const int w = map.width();
+    for( std::vector<Location>::const_iterator it = ants.begin(); it != ants.end(); ++it )
+        for( int i = -8; i <= 8; ++i )
+            for( int j = -8; j <= 8; ++j )
+                if( i*i + j*j <= BENCH_VIEW_RADIUS2 )
+                    map( ( it->row+i+h ) % h, ( it->col+j+w ) % w ).setVisible();
+}
+
+
+#endif // BENCHMAP_H_
@@ -45,7 +45,7 @@ namespace
 
         bool operator()( const BFNode* node )
         {
-            if( node->square->ant_id > 0 )
+            if( node->square().ant_id > 0 )
             {
                 found_enemy = true;
                 enemies.push_back( node->loc );
@@ -62,15 +62,15 @@ namespace
     {
         bool operator()( const BFNode* node )
         {
-            if( node->square->ant_id == 0 &&
-                node->square->ant->path.goal() != Path::HILL &&
-                node->square->ant->path.goal() != Path::FOOD &&
-                node->child->square->isAvailable() )
+            if( node->square().ant_id == 0 &&
+                node->square().ant->path.goal() != Path::HILL &&
+                node->square().ant->path.goal() != Path::FOOD &&
+                node->child->square().isAvailable() )
             {
-                Ant* cur_ant = node->square->ant;
+                Ant* cur_ant = node->square().ant;
                 node->getRPath( cur_ant->path );
                 cur_ant->path.setGoal( Path::HILL );
-                node->child->square->assigned = true;
+                node->child->square().assigned = true;
             }
             return true;
         }
@@ -89,14 +89,14 @@ namespace
 
         bool operator()( const BFNode* node )
         {
-            if( node->square->ant_id == 0 )
+            if( node->square().ant_id == 0 )
             {
-                Ant* cur_ant = node->square->ant;
+                Ant* cur_ant = node->square().ant;
                 if( ( cur_ant->assignment  != Ant::STATIC_DEFENSE ) &&
                     ( cur_ant->path.goal() != Path::ATTACK || allow_overrides ) &&
                     ( !already_assigned                    || already_assigned->path.size() > node->depth ) && 
                     ( cur_ant->path.goal() != Path::FOOD   || cur_ant->path.size() > node->depth ) &&
-                      node->child->square->isAvailable() )
+                      node->child->square().isAvailable() )
                 {
                     //Debug::stream() << " prev ant: " << 
                     Debug::stream() << " Assigning ant " << *cur_ant << " to food:" << std::endl;
@@ -117,7 +117,7 @@ namespace
 
                     node->getRPath( cur_ant->path );
                     cur_ant->path.setGoal( Path::FOOD );
-                    node->child->square->assigned = true;
+                    node->child->square().assigned = true;
 
                     // If an ant is already assigned to this food, free it up
                     if( already_assigned )
@@ -150,9 +150,9 @@ namespace
 
         bool operator()( const BFNode* node )
         {
-            if( node->square->ant_id == 0 )
+            if( node->square().ant_id == 0 )
             {
-                Ant* cur_ant = node->square->ant;
+                Ant* cur_ant = node->square().ant;
                 if( cur_ant->assignment != Ant::STATIC_DEFENSE &&
                     cur_ant->assignment != Ant::DEFENSE )
                 {
@@ -177,9 +177,9 @@ namespace
 
         bool operator()( const BFNode* node )
         {
-            if( node->square->ant_id == 0 )
+            if( node->square().ant_id == 0 )
             {
-                Ant* cur_ant = node->square->ant;
+                Ant* cur_ant = node->square().ant;
                 if( cur_ant->assignment != Ant::STATIC_DEFENSE )
                 {
                     assigned.insert( cur_ant );
@@ -416,7 +416,7 @@ namespace
 
 Bot::Bot()
     : m_enemy_hills_changed( false ),
-      m_max_time( 0.0f ),
+      m_turn_times( "turn", 0.5 ),
       m_battle( 0 )
 {
 }
@@ -424,7 +424,7 @@ Bot::Bot()
 
 Bot::~Bot()
 {
-    std::cerr << " maximum time: " << m_max_time << "ms" << std::endl;
+    m_turn_times.print( std::cerr );
 }
 
 
@@ -449,6 +449,7 @@ void Bot::playGame()
     //while( infile >> m_state )
     {
         m_state.updateVisionInformation();
+        m_state.map().updateDistanceOracle();
         updateHillList();
         updateTargetedFood();
         makeMoves();
@@ -547,8 +548,8 @@ void Bot::makeMoves()
     // TODO: persistant notvisible info so squares which have been non-visible
     //       for longer are higher priority
     //
-    m_state.map().updatePriority( Map::EXPLORE, 100, notVisible );
-    for( State::LocationSet::const_iterator it = m_state.frontier().begin(); it != m_state.frontier().end(); ++it )
+    m_state.map().updatePriority( Map::EXPLORE, 100, Square::VISIBLE, 0 );
+    for( State::Locations::const_iterator it = m_state.frontier().begin(); it != m_state.frontier().end(); ++it )
     {
         std::vector<Location> neighbors;
         m_state.map().getNeighbors( *it, isLand, neighbors );
@@ -606,18 +607,30 @@ void Bot::endTurn()
     m_hills_under_attack.clear();
 
     const float turn_time = m_state.timer().getTime();
-    m_max_time = turn_time > m_max_time ? turn_time : m_max_time;
-    Debug::stream() << "time taken: \n" << turn_time << "ms.  Max: " << m_max_time << "ms." << std::endl;
+    m_turn_times.record( turn_time * 1.0e-3 );
+    Debug::stream() << "time taken: \n" << turn_time << "ms.  Max: "
+                    << m_turn_times.getMax() * 1.0e3 << "ms." << std::endl;
 
     std::cout << "go" << std::endl;
 }
 
 
+bool Bot::antsWithin( const Location& loc, unsigned max_dist )const
+{
+    for( State::Ants::const_iterator it = m_state.myAnts().begin(); it != m_state.myAnts().end(); ++it )
+        if( m_state.map().distanceLowerBound( ( *it )->location, loc ) <= static_cast<int>( max_dist ) )
+            return true;
+    return false;
+}
+
+
 void Bot::assignToHillAttack( unsigned max_dist )
 {
     for( LocationSet::iterator it = m_enemy_hills.begin(); it != m_enemy_hills.end(); ++it )
     {
         Debug::stream() << " Searching for nearby ants to attack hill: " << *it << std::endl;
+        if( !antsWithin( *it, max_dist ) )
+            continue;
 
         HillAttackAnts hill_attack_ants;
         //Always         always;
@@ -638,6 +651,11 @@ void Bot::assignToFood( unsigned max_dist, bool allow_overrides )
     for( State::Locations::const_iterator it = m_state.food().begin(); it != m_state.food().end(); ++it )
     {
         Debug::stream() << " Searching for ant to collect food: " << *it << std::endl;
+        if( !antsWithin( *it, max_dist ) )
+        {
+            Debug::stream() << "    no ant in range" << std::endl;
+            continue;
+        }
 
         AssignedAnts::iterator prev  = m_food_ants.find( *it );
         Ant* previous_ant = ( prev != m_food_ants.end() ) ? prev->second : 0u;
@@ -843,7 +861,7 @@ void Bot::updateHillList()
     std::vector< LocationSet::iterator > remove_these;
     for( LocationSet::iterator it = m_enemy_hills.begin(); it != m_enemy_hills.end(); ++it )
     {
-        const Square& square = m_state.map()( *it );
+        const Square square = m_state.map()( *it );
         if( square.visible && square.hill_id < 0 )
             remove_these.push_back( it );
     }
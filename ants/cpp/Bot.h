@@ -1,6 +1,7 @@
 #ifndef BOT_H_
 #define BOT_H_
 
+#include "LatencyHistogram.h"
 #include "State.h"
 #include <set>
 #include <map>
@@ -39,6 +40,10 @@ private:
     
     void makeAssignments();
 
+    /// True if one of our ants may be within max_dist steps of loc.  Uses
+    /// the map's distance lower bound, so false means none can be
+    bool antsWithin( const Location& loc, unsigned max_dist )const;
+
     void assignToHillAttack( unsigned max_dist );
     void assignToFood( unsigned max_dist, bool allow_overrides );
     void assignToMapPath( Ant* ant );
@@ -61,7 +66,7 @@ private:
 
     AssignedAnts       m_food_ants;
 
-    float              m_max_time;
+    LatencyHistogram   m_turn_times;
     State              m_state;
 
     Battle*            m_battle;
@@ -0,0 +1,172 @@
+#include "BenchMap.h"
+#include "Map.h"
+#include "Timer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//
+// Convergence against time for the EXPLORE diffusion solvers on a synthetic
+// map set up the way Bot::makeMoves does: unseen squares, frontier squares
+// and our own ants as sources.
+//
+// For each Jacobi iteration count it prints the time taken, the largest
+// change one more iteration would make and the fraction of ants whose
+// uphill move agrees with the reference run of Bot's max(rows, cols)
+// iterations.  The single INFLUENCE pass is reported the same way.
+//
+// Usage: diffbench [size, default 200] [decay, default 0.9]
+//
+
+namespace
+{
+
+const int   NUM_ANTS     = 100;
+
+
+void setSources( Map& map, const std::vector<Location>& ants )
+{
+    map.updatePriority( Map::EXPLORE, 100, Square::VISIBLE, 0 );
+    for( unsigned i = 0; i < map.height(); ++i )
+        for( unsigned j = 0; j < map.width(); ++j )
+        {
+            // Visible land next to unseen land is frontier
+            Location loc( i, j );
+            if( !map( loc ).visible ) continue;
+            for( int d = 0; d < NUM_DIRECTIONS; ++d )
+                if( !map( map.getLocation( loc, static_cast<Direction>( d ) ) ).visible )
+                {
+                    map.setPriority( Map::EXPLORE, loc, 1000 );
+                    break;
+                }
+        }
+    for( std::vector<Location>::const_iterator it = ants.begin(); it != ants.end(); ++it )
+        map.setPriority( Map::EXPLORE, *it, -100 );
+}
+
+
+/// The move Bot would pick: the neighbor with the highest priority, if
+/// higher than staying put
+Direction uphill( const Map& map, const Location& loc )
+{
+    Direction best          = NONE;
+    float     best_priority = map.getPriority( Map::EXPLORE, loc );
+    for( int d = 0; d < NUM_DIRECTIONS; ++d )
+    {
+        Location next = map.getLocation( loc, static_cast<Direction>( d ) );
+        if( !map( next ).isLand() ) continue;
+        float priority = map.getPriority( Map::EXPLORE, next );
+        if( priority > best_priority )
+        {
+            best          = static_cast<Direction>( d );
+            best_priority = priority;
+        }
+    }
+    return best;
+}
+
+
+float maxChange( const Map& map )
+{
+    Map next( map );
+    next.setDiffusionSolver( Map::JACOBI );
+    next.diffusePriority( Map::EXPLORE, 1 );
+
+    float max_change = 0.0f;
+    for( unsigned i = 0; i < map.height(); ++i )
+        for( unsigned j = 0; j < map.width(); ++j )
+        {
+            Location loc( i, j );
+            if( !map( loc ).isLand() ) continue;
+            max_change = std::max( max_change, fabsf( next.getPriority( Map::EXPLORE, loc ) -
+                                                      map.getPriority( Map::EXPLORE, loc ) ) );
+        }
+    return max_change;
+}
+
+
+float agreement( const Map& map, const std::vector<Direction>& reference, const std::vector<Location>& ants )
+{
+    int agree = 0;
+    for( unsigned i = 0; i < ants.size(); ++i )
+        if( uphill( map, ants[ i ] ) == reference[ i ] )
+            ++agree;
+    return static_cast<float>( agree ) / static_cast<float>( ants.size() );
+}
+
+
+/// Diffuse a copy of sources and time it, best of a few runs
+double diffuse( const Map& sources, Map& result, unsigned iterations )
+{
+    Timer  timer;
+    double best_ms = 1.0e30;
+    for( int run = 0; run < 3; ++run )
+    {
+        result = sources;
+        timer.start();
+        result.diffusePriority( Map::EXPLORE, iterations );
+        best_ms = std::min( best_ms, timer.getTime() );
+    }
+    return best_ms;
+}
+
+
+void report( const char* name, unsigned iterations, double ms, float change, float agree )
+{
+    std::cout << std::setw( 10 ) << name
+              << std::setw( 8 )  << iterations
+              << std::setw( 12 ) << std::fixed << std::setprecision( 3 ) << ms;
+    if( change >= 0.0f )
+        std::cout << std::setw( 14 ) << std::setprecision( 4 ) << change;
+    else
+        std::cout << std::setw( 14 ) << "-";
+    std::cout
+              << std::setw( 10 ) << std::setprecision( 2 ) << agree*100.0f << "%" << std::endl;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const int   size  = argc > 1 ? atoi( argv[1] ) : 200;
+    const float decay = argc > 2 ? static_cast<float>( atof( argv[2] ) ) : 0.9f;
+
+    srand( 1234 );
+    Map sources( size, size );
+    std::vector<Location> ants;
+    for( int i = 0; i < NUM_ANTS; ++i )
+        ants.push_back( Location( rand() % size, rand() % size ) );
+    makeTerrain( sources );
+    updateVision( sources, ants );
+    for( int i = 0; i < NUM_ANTS; ++i )
+        if( !sources( ants[ i ] ).isLand() )
+            ants[ i ] = randomLand( sources );
+    setSources( sources, ants );
+
+    Map result;
+    const unsigned reference_iterations = size;
+    diffuse( sources, result, reference_iterations );
+    std::vector<Direction> reference;
+    for( unsigned i = 0; i < ants.size(); ++i )
+        reference.push_back( uphill( result, ants[ i ] ) );
+
+    std::cout << size << "x" << size << " map, reference " << reference_iterations
+              << " Jacobi iterations" << std::endl
+              << "    solver    iter          ms    max change     agree" << std::endl;
+
+    for( unsigned iterations = 1; iterations <= 4*reference_iterations; iterations *= 2 )
+    {
+        double ms = diffuse( sources, result, iterations );
+        report( "jacobi", iterations, ms, maxChange( result ), agreement( result, reference, ants ) );
+    }
+
+    sources.setDiffusionSolver( Map::INFLUENCE, decay );
+    double ms = diffuse( sources, result, 1 );
+    report( "influence", 1, ms, -1.0f, agreement( result, reference, ants ) );
+
+    return 0;
+}
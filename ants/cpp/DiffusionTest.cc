@@ -3,12 +3,151 @@
 #include "Path.h"
 #include "AStar.h"
 #include "Map.h"
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <queue>
+#include <vector>
 
 
 const int SIZE = 64;
 
 
+//
+// Checks diffusePriority against a plain branching stencil over the land
+// squares, with the map edges wrapping and water blocking, on the given
+// number of threads
+//
+bool checkDiffusion( int height, int width, int iterations, unsigned threads )
+{
+    Map map( height, width );
+    map.setDiffusionThreads( threads );
+    std::vector<float> ref( height*width, 0.0f );
+    std::vector<float> tmp( height*width, 0.0f );
+
+    srand( height*width );
+    for( int i = 0; i < height; ++i )
+      for( int j = 0; j < width; ++j )
+      {
+        map( i, j ).type = rand() % 5 == 0 ? Square::WATER : Square::LAND;
+        ref[ i*width+j ] = static_cast<float>( rand() % 200 - 100 );
+        map.setPriority( Map::EXPLORE, Location( i, j ), ref[ i*width+j ] );
+      }
+
+    for( int k = 0; k < iterations; ++k )
+    {
+      for( int i = 0; i < height; ++i )
+        for( int j = 0; j < width; ++j )
+        {
+          tmp[ i*width+j ] = ref[ i*width+j ];
+          if( !map( i, j ).isLand() ) continue;
+
+          const int n[4][2] = { { i, (j+width-1)%width }, { i, (j+1)%width },
+                                { (i+1)%height, j }, { (i+height-1)%height, j } };
+          float sum       = ref[ i*width+j ];
+          float num_nodes = 1.0f;
+          for( int d = 0; d < 4; ++d )
+            if( map( n[d][0], n[d][1] ).isLand() )
+            {
+              sum += ref[ n[d][0]*width + n[d][1] ];
+              num_nodes += 1.0f;
+            }
+          tmp[ i*width+j ] = sum / num_nodes;
+        }
+      ref.swap( tmp );
+    }
+
+    map.diffusePriority( Map::EXPLORE, iterations );
+
+    float max_error = 0.0f;
+    for( int i = 0; i < height; ++i )
+      for( int j = 0; j < width; ++j )
+        if( map( i, j ).isLand() )
+        {
+          const float expected = ref[ i*width+j ];
+          const float error = fabsf( map.getPriority( Map::EXPLORE, Location( i, j ) ) - expected );
+          max_error = std::max( max_error, error / std::max( 1.0f, fabsf( expected ) ) );
+        }
+
+    std::cerr << " check " << height << "x" << width << " x" << iterations
+              << " on " << threads << " threads"
+              << ": max relative error " << max_error << std::endl;
+    return max_error < 1.0e-4f;
+}
+
+
+//
+// Checks the INFLUENCE solver against a breadth first search from each
+// source in turn
+//
+bool checkInfluence( int height, int width, float decay )
+{
+    Map map( height, width );
+    std::vector<Location> sources;
+    std::vector<float>    values;
+
+    srand( height+width );
+    for( int i = 0; i < height; ++i )
+      for( int j = 0; j < width; ++j )
+      {
+        map( i, j ).type = rand() % 4 == 0 ? Square::WATER : Square::LAND;
+        if( map( i, j ).isLand() && rand() % 40 == 0 )
+        {
+          sources.push_back( Location( i, j ) );
+          values.push_back( static_cast<float>( rand() % 2000 - 1000 ) );
+          map.setPriority( Map::EXPLORE, sources.back(), values.back() );
+        }
+      }
+
+    std::vector<float> positive( height*width, 0.0f );
+    std::vector<float> negative( height*width, 0.0f );
+    for( unsigned s = 0; s < sources.size(); ++s )
+    {
+      std::vector<int> depth( height*width, -1 );
+      std::queue<Location> open;
+      open.push( sources[ s ] );
+      depth[ sources[ s ].row*width + sources[ s ].col ] = 0;
+      while( !open.empty() )
+      {
+        Location loc = open.front();
+        open.pop();
+        const int d = depth[ loc.row*width + loc.col ];
+        const float influence = values[ s ] * powf( decay, static_cast<float>( d ) );
+        float& p = positive[ loc.row*width + loc.col ];
+        float& n = negative[ loc.row*width + loc.col ];
+        p = std::max( p, influence );
+        n = std::min( n, influence );
+
+        std::vector<Location> neighbors;
+        map.getNeighbors( loc, isLand, neighbors );
+        for( unsigned k = 0; k < neighbors.size(); ++k )
+          if( depth[ neighbors[ k ].row*width + neighbors[ k ].col ] < 0 )
+          {
+            depth[ neighbors[ k ].row*width + neighbors[ k ].col ] = d+1;
+            open.push( neighbors[ k ] );
+          }
+      }
+    }
+
+    map.setDiffusionSolver( Map::INFLUENCE, decay );
+    map.diffusePriority( Map::EXPLORE, 1 );
+
+    float max_error = 0.0f;
+    for( int i = 0; i < height; ++i )
+      for( int j = 0; j < width; ++j )
+        if( map( i, j ).isLand() )
+        {
+          const float expected = positive[ i*width+j ] + negative[ i*width+j ];
+          const float error = fabsf( map.getPriority( Map::EXPLORE, Location( i, j ) ) - expected );
+          max_error = std::max( max_error, error / std::max( 1.0f, fabsf( expected ) ) );
+        }
+
+    std::cerr << " influence check " << height << "x" << width << " decay " << decay
+              << ": max relative error " << max_error << std::endl;
+    return max_error < 1.0e-4f;
+}
+
+
 int main( int argc, char** argv )
 {
 
@@ -56,4 +195,17 @@ int main( int argc, char** argv )
     std::cerr << " Took " << dt << "ms" << std::endl;
     
     std::cout << map << std::endl;
+
+    // Odd and even iteration counts, serial and banded
+    bool ok = checkDiffusion( 37, 53, 25, 1 ) &&
+              checkDiffusion( 37, 53, 25, 3 ) &&
+              checkDiffusion( 64, 64, 50, 1 ) &&
+              checkDiffusion( 300, 300, 40, 1 ) &&
+              checkDiffusion( 300, 300, 41, 1 ) &&
+              checkDiffusion( 300, 300, 40, 4 ) &&
+              checkDiffusion( 300, 300, 41, 4 ) &&
+              checkInfluence( 31, 47, 0.9f ) &&
+              checkInfluence( 64, 64, 0.75f );
+    std::cerr << ( ok ? " diffusion check passed" : " diffusion check FAILED" ) << std::endl;
+    return ok ? 0 : 1;
 }
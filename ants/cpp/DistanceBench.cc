@@ -0,0 +1,146 @@
+#include "BenchMap.h"
+#include "DistanceOracle.h"
+#include "LatencyHistogram.h"
+#include "Timer.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//
+// Reveals water on a 200x200 map a few blobs per turn, the way exploring
+// does, on top of the benchmark terrain, and keeps a DistanceOracle up to
+// date with block().  Every turn a fixed set of destinations, whose fields
+// stay cached and so are repaired rather than rebuilt, is checked against a
+// fresh breadth first search, and lower bounds are checked against the
+// exact distances.
+//
+// Usage: distbench [turns, default 100]
+//
+
+namespace
+{
+
+const unsigned SIZE             = 200;
+const unsigned NUM_DESTINATIONS = 8;
+const unsigned BLOBS_PER_TURN   = 6;
+const unsigned QUERIES_PER_TURN = 2000;
+
+
+std::vector<unsigned> bfs( const std::vector<unsigned char>& passable, unsigned source )
+{
+    std::vector<unsigned> distances( SIZE*SIZE, DistanceOracle::UNREACHABLE );
+    if( !passable[ source ] ) return distances;
+
+    std::vector<unsigned> queue( 1, source );
+    distances[ source ] = 0u;
+    for( unsigned head = 0; head < queue.size(); ++head )
+    {
+        const unsigned row = queue[ head ] / SIZE;
+        const unsigned col = queue[ head ] % SIZE;
+        const unsigned n[ 4 ] = { row*SIZE + ( col+SIZE-1 ) % SIZE,
+                                  row*SIZE + ( col+1 ) % SIZE,
+                                  ( row+1 ) % SIZE*SIZE + col,
+                                  ( row+SIZE-1 ) % SIZE*SIZE + col };
+        for( int k = 0; k < 4; ++k )
+            if( passable[ n[ k ] ] && distances[ n[ k ] ] == DistanceOracle::UNREACHABLE )
+            {
+                distances[ n[ k ] ] = distances[ queue[ head ] ] + 1u;
+                queue.push_back( n[ k ] );
+            }
+    }
+    return distances;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const int turns = argc > 1 ? atoi( argv[1] ) : 100;
+
+    srand( 1234 );
+    Map map( SIZE, SIZE );
+    makeTerrain( map );
+    std::vector<unsigned char> passable( SIZE*SIZE );
+    for( unsigned i = 0; i < SIZE*SIZE; ++i )
+        passable[ i ] = map( i / SIZE, i % SIZE ).type != Square::WATER;
+    DistanceOracle oracle;
+
+    Timer            timer;
+    LatencyHistogram reset_times( "reset" );
+    LatencyHistogram block_times( "block" );
+    LatencyHistogram bound_times( "lower bound" );
+    LatencyHistogram exact_times( "exact" );
+    LatencyHistogram bfs_times( "bfs" );
+
+    timer.start();
+    oracle.reset( SIZE, SIZE, passable );
+    reset_times.record( timer.getTime()*1.0e-3 );
+
+    std::vector<unsigned> destinations;
+    for( unsigned i = 0; i < NUM_DESTINATIONS; ++i )
+        destinations.push_back( rand() % ( SIZE*SIZE ) );
+
+    unsigned exact_errors = 0;
+    unsigned bound_errors = 0;
+    unsigned checksum     = 0;
+    for( int turn = 1; turn <= turns; ++turn )
+    {
+        std::vector<Location> blobs;
+        for( unsigned i = 0; i < BLOBS_PER_TURN; ++i )
+            addWaterBlob( map, &blobs );
+        std::vector<unsigned> water;
+        for( std::vector<Location>::iterator it = blobs.begin(); it != blobs.end(); ++it )
+        {
+            water.push_back( it->row*SIZE + it->col );
+            passable[ water.back() ] = 0u;
+        }
+
+        timer.start();
+        oracle.block( water );
+        block_times.record( timer.getTime()*1.0e-3 );
+
+        for( std::vector<unsigned>::iterator it = destinations.begin(); it != destinations.end(); ++it )
+        {
+            timer.start();
+            const std::vector<unsigned> reference = bfs( passable, *it );
+            bfs_times.record( timer.getTime()*1.0e-3 );
+
+            // Single queries are too quick to time one by one
+            std::vector<unsigned> sources;
+            for( unsigned i = 0; i < QUERIES_PER_TURN / NUM_DESTINATIONS; ++i )
+                sources.push_back( rand() % ( SIZE*SIZE ) );
+            std::vector<unsigned> bounds( sources.size() );
+            std::vector<unsigned> exacts( sources.size() );
+
+            timer.start();
+            for( unsigned i = 0; i < sources.size(); ++i )
+                bounds[ i ] = oracle.lowerBound( sources[ i ], *it );
+            bound_times.record( timer.getTime()*1.0e-3 / sources.size() );
+
+            timer.start();
+            for( unsigned i = 0; i < sources.size(); ++i )
+                exacts[ i ] = oracle.distance( sources[ i ], *it );
+            exact_times.record( timer.getTime()*1.0e-3 / sources.size() );
+
+            for( unsigned i = 0; i < sources.size(); ++i )
+            {
+                if( exacts[ i ] != reference[ sources[ i ] ] )                           ++exact_errors;
+                if( bounds[ i ] > exacts[ i ] && exacts[ i ] != DistanceOracle::UNREACHABLE ) ++bound_errors;
+                checksum += exacts[ i ] + bounds[ i ];
+            }
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision( 4 )
+              << "reset       " << std::setw( 9 ) << reset_times.getMean()*1.0e3 << " ms\n"
+              << "block       " << std::setw( 9 ) << block_times.getMean()*1.0e3 << " ms/turn\n"
+              << "lower bound " << std::setw( 9 ) << bound_times.getMean()*1.0e6 << " us\n"
+              << "exact       " << std::setw( 9 ) << exact_times.getMean()*1.0e6 << " us\n"
+              << "bfs         " << std::setw( 9 ) << bfs_times.getMean()*1.0e3 << " ms\n"
+              << "checksum    " << checksum << "\n"
+              << "exact errors " << exact_errors << "  bound errors " << bound_errors << std::endl;
+    return exact_errors == 0 && bound_errors == 0 ? 0 : 1;
+}
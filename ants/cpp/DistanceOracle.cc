@@ -0,0 +1,309 @@
+
+#include "DistanceOracle.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <queue>
+#include <utility>
+
+
+namespace
+{
+    // distance, square
+    typedef std::pair<unsigned, unsigned> Entry;
+    typedef std::priority_queue< Entry, std::vector<Entry>, std::greater<Entry> > EntryQueue;
+}
+
+
+DistanceOracle::DistanceOracle( unsigned num_landmarks, unsigned cache_size )
+    : m_height( 0u ),
+      m_width( 0u ),
+      m_num_landmarks( num_landmarks ),
+      m_cache_size( cache_size ),
+      m_clock( 0u ),
+      m_generation( 0u )
+{
+}
+
+
+void DistanceOracle::reset( unsigned height, unsigned width, const std::vector<unsigned char>& passable )
+{
+    assert( passable.size() == height*width );
+    assert( height*width < UNREACHABLE );
+
+    m_height   = height;
+    m_width    = width;
+    m_passable.resize( height*width );
+    for( unsigned i = 0; i < height*width; ++i )
+        m_passable[ i ] = passable[ i ] != 0u;
+    m_queue.resize( height*width );
+    m_stamps.assign( height*width, 0u );
+    m_generation = 0u;
+    m_cache.clear();
+
+    chooseLandmarks();
+}
+
+
+void DistanceOracle::block( const std::vector<unsigned>& squares )
+{
+    std::vector<unsigned> blocked;
+    for( std::vector<unsigned>::const_iterator it = squares.begin(); it != squares.end(); ++it )
+        if( m_passable[ *it ] )
+        {
+            m_passable[ *it ] = 0u;
+            blocked.push_back( *it );
+        }
+    if( blocked.empty() ) return;
+
+    for( std::vector<Field>::iterator it = m_landmarks.begin(); it != m_landmarks.end(); ++it )
+    {
+        if( m_passable[ it->source ] )
+        {
+            repair( *it, blocked );
+            continue;
+        }
+
+        // Move a drowned landmark to a passable neighbor if there is one
+        unsigned n[ 4 ];
+        neighbors( it->source, n );
+        for( int k = 0; k < 4; ++k )
+            if( m_passable[ n[ k ] ] )
+                it->source = n[ k ];
+        compute( *it );
+    }
+
+    for( size_t i = 0; i < m_cache.size(); )
+    {
+        if( m_passable[ m_cache[ i ].source ] )
+        {
+            repair( m_cache[ i ], blocked );
+            ++i;
+        }
+        else
+        {
+            m_cache[ i ].distances.swap( m_cache.back().distances );
+            m_cache[ i ].source   = m_cache.back().source;
+            m_cache[ i ].last_use = m_cache.back().last_use;
+            m_cache.pop_back();
+        }
+    }
+}
+
+
+unsigned DistanceOracle::lowerBound( unsigned a, unsigned b )const
+{
+    unsigned bound = 0u;
+    for( std::vector<Field>::const_iterator it = m_landmarks.begin(); it != m_landmarks.end(); ++it )
+    {
+        const unsigned da = it->distances[ a ];
+        const unsigned db = it->distances[ b ];
+        if( da == UNREACHABLE && db == UNREACHABLE ) continue;
+        if( da == UNREACHABLE || db == UNREACHABLE ) return UNREACHABLE;
+        bound = std::max( bound, da > db ? da-db : db-da );
+    }
+    return bound;
+}
+
+
+unsigned DistanceOracle::distance( unsigned a, unsigned b )
+{
+    ++m_clock;
+    for( std::vector<Field>::iterator it = m_cache.begin(); it != m_cache.end(); ++it )
+    {
+        if( it->source == b ) { it->last_use = m_clock; return it->distances[ a ]; }
+        if( it->source == a ) { it->last_use = m_clock; return it->distances[ b ]; }
+    }
+    for( std::vector<Field>::iterator it = m_landmarks.begin(); it != m_landmarks.end(); ++it )
+    {
+        if( it->source == b ) return it->distances[ a ];
+        if( it->source == a ) return it->distances[ b ];
+    }
+
+    // Replace the least recently used field
+    Field* field = 0;
+    if( m_cache.size() < m_cache_size )
+    {
+        m_cache.push_back( Field() );
+        field = &m_cache.back();
+    }
+    else
+    {
+        field = &m_cache[ 0 ];
+        for( std::vector<Field>::iterator it = m_cache.begin(); it != m_cache.end(); ++it )
+            if( it->last_use < field->last_use )
+                field = &*it;
+    }
+
+    field->source   = b;
+    field->last_use = m_clock;
+    compute( *field );
+    return field->distances[ a ];
+}
+
+
+void DistanceOracle::neighbors( unsigned i, unsigned n[ 4 ] )const
+{
+    const unsigned row = i / m_width;
+    const unsigned col = i % m_width;
+    n[ 0 ] = row*m_width + ( col == 0          ? m_width-1  : col-1 );
+    n[ 1 ] = row*m_width + ( col == m_width-1  ? 0          : col+1 );
+    n[ 2 ] = ( row == m_height-1 ? 0          : row+1 )*m_width + col;
+    n[ 3 ] = ( row == 0          ? m_height-1 : row-1 )*m_width + col;
+}
+
+
+void DistanceOracle::compute( Field& field )
+{
+    field.distances.assign( m_height*m_width, UNREACHABLE );
+    if( !m_passable[ field.source ] ) return;
+
+    // Each square is queued once, so a flat array serves as the queue
+    unsigned head = 0u;
+    unsigned tail = 0u;
+    field.distances[ field.source ] = 0u;
+    m_queue[ tail++ ] = field.source;
+    while( head != tail )
+    {
+        const unsigned current  = m_queue[ head++ ];
+        const Distance distance = field.distances[ current ] + 1u;
+
+        unsigned n[ 4 ];
+        neighbors( current, n );
+        for( int k = 0; k < 4; ++k )
+            if( m_passable[ n[ k ] ] && field.distances[ n[ k ] ] == UNREACHABLE )
+            {
+                field.distances[ n[ k ] ] = distance;
+                m_queue[ tail++ ] = n[ k ];
+            }
+    }
+}
+
+
+//
+// Blocking squares only lengthens paths.  First find, in order of old
+// distance, the squares left with no unaffected neighbor one step closer to
+// the source; then grow their new distances in from the unaffected squares
+// around them.
+//
+void DistanceOracle::repair( Field& field, const std::vector<unsigned>& squares )
+{
+    std::vector<Distance>& distances = field.distances;
+
+    if( ++m_generation == 0u )
+    {
+        std::fill( m_stamps.begin(), m_stamps.end(), 0u );
+        m_generation = 1u;
+    }
+
+    EntryQueue queue;
+    unsigned   n[ 4 ];
+    for( std::vector<unsigned>::const_iterator it = squares.begin(); it != squares.end(); ++it )
+    {
+        const unsigned distance = distances[ *it ];
+        distances[ *it ] = UNREACHABLE;
+        m_stamps[ *it ]  = m_generation;
+        if( distance == UNREACHABLE ) continue;
+
+        neighbors( *it, n );
+        for( int k = 0; k < 4; ++k )
+            if( distances[ n[ k ] ] == distance+1u )
+                queue.push( Entry( distance+1u, n[ k ] ) );
+    }
+
+    std::vector<unsigned> affected;
+    while( !queue.empty() )
+    {
+        const unsigned distance = queue.top().first;
+        const unsigned square   = queue.top().second;
+        queue.pop();
+        if( m_stamps[ square ] == m_generation ) continue;
+
+        neighbors( square, n );
+        bool supported = false;
+        for( int k = 0; k < 4 && !supported; ++k )
+            supported = m_stamps[ n[ k ] ] != m_generation && m_passable[ n[ k ] ] &&
+                        distances[ n[ k ] ] == distance-1u;
+        if( supported ) continue;
+
+        m_stamps[ square ]    = m_generation;
+        distances[ square ]   = UNREACHABLE;
+        affected.push_back( square );
+        for( int k = 0; k < 4; ++k )
+            if( m_stamps[ n[ k ] ] != m_generation && distances[ n[ k ] ] == distance+1u )
+                queue.push( Entry( distance+1u, n[ k ] ) );
+    }
+
+    for( std::vector<unsigned>::iterator it = affected.begin(); it != affected.end(); ++it )
+    {
+        unsigned best = UNREACHABLE;
+        neighbors( *it, n );
+        for( int k = 0; k < 4; ++k )
+            if( m_stamps[ n[ k ] ] != m_generation && distances[ n[ k ] ] != UNREACHABLE )
+                best = std::min( best, distances[ n[ k ] ] + 1u );
+        if( best == UNREACHABLE ) continue;
+
+        distances[ *it ] = best;
+        queue.push( Entry( best, *it ) );
+    }
+
+    while( !queue.empty() )
+    {
+        const unsigned distance = queue.top().first;
+        const unsigned square   = queue.top().second;
+        queue.pop();
+        if( distance > distances[ square ] ) continue;
+
+        neighbors( square, n );
+        for( int k = 0; k < 4; ++k )
+            if( m_stamps[ n[ k ] ] == m_generation && m_passable[ n[ k ] ] &&
+                distance+1u < distances[ n[ k ] ] )
+            {
+                distances[ n[ k ] ] = distance+1u;
+                queue.push( Entry( distance+1u, n[ k ] ) );
+            }
+    }
+}
+
+
+void DistanceOracle::chooseLandmarks()
+{
+    m_landmarks.clear();
+
+    const unsigned num_squares = m_height*m_width;
+    std::vector<unsigned> nearest( num_squares, UNREACHABLE );
+
+    // Start from the square farthest from the first passable one
+    Field start;
+    start.source = std::find( m_passable.begin(), m_passable.end(), 1u ) - m_passable.begin();
+    if( start.source == num_squares ) return;
+    compute( start );
+
+    unsigned next = start.source;
+    for( unsigned i = 0; i < num_squares; ++i )
+        if( start.distances[ i ] != UNREACHABLE && start.distances[ i ] > start.distances[ next ] )
+            next = i;
+
+    while( m_landmarks.size() < m_num_landmarks )
+    {
+        m_landmarks.push_back( Field() );
+        m_landmarks.back().source = next;
+        compute( m_landmarks.back() );
+
+        // Next is the passable square farthest from every landmark so far,
+        // which picks up unconnected regions first
+        const std::vector<Distance>& distances = m_landmarks.back().distances;
+        unsigned farthest = 0u;
+        for( unsigned i = 0; i < num_squares; ++i )
+        {
+            nearest[ i ] = std::min<unsigned>( nearest[ i ], distances[ i ] );
+            if( m_passable[ i ] && nearest[ i ] > farthest )
+            {
+                farthest = nearest[ i ];
+                next     = i;
+            }
+        }
+        if( farthest == 0u ) break;
+    }
+}
@@ -0,0 +1,83 @@
+
+#ifndef DISTANCEORACLE_H_
+#define DISTANCEORACLE_H_
+
+#include <vector>
+
+#include <stdint.h>
+
+//
+// Shortest path step counts over the passable squares of a wrapping grid.
+//
+//   - A few landmarks, spread out by farthest point selection, each keep a
+//     distance field.  The triangle inequality on those gives lower bounds
+//     in O(landmarks) (ALT)
+//   - Exact distances come from whole distance fields kept for the most
+//     recently queried destinations, so repeat queries are a lookup
+//   - Squares only ever become impassable.  block() repairs every field in
+//     place, touching only the squares whose distance grew
+//
+// Squares are indexed row major.  Distances of UNREACHABLE or more mean
+// there is no path.
+//
+
+class DistanceOracle
+{
+public:
+    static const unsigned UNREACHABLE = 0xffffu;
+
+    explicit DistanceOracle( unsigned num_landmarks = 8u, unsigned cache_size = 16u );
+
+    /// Start over on a height x width grid; passable[i] is non-zero for
+    /// passable squares
+    void reset( unsigned height, unsigned width, const std::vector<unsigned char>& passable );
+
+    /// Make squares impassable and repair the fields
+    void block( const std::vector<unsigned>& squares );
+
+    unsigned height()const                   { return m_height; }
+    unsigned width()const                    { return m_width;  }
+    bool     passable( unsigned i )const     { return m_passable[ i ] != 0; }
+
+    /// Lower bound on the distance between squares a and b
+    unsigned lowerBound( unsigned a, unsigned b )const;
+
+    /// Exact distance between squares a and b
+    unsigned distance( unsigned a, unsigned b );
+
+private:
+    typedef uint16_t Distance;
+
+    struct Field
+    {
+        Field() : source( 0u ), last_use( 0u ) {}
+
+        unsigned              source;
+        unsigned              last_use;
+        std::vector<Distance> distances;
+    };
+
+    void neighbors( unsigned i, unsigned n[ 4 ] )const;
+
+    void compute( Field& field );
+    void repair( Field& field, const std::vector<unsigned>& squares );
+    void chooseLandmarks();
+
+    unsigned                   m_height;
+    unsigned                   m_width;
+    unsigned                   m_num_landmarks;
+    unsigned                   m_cache_size;
+    unsigned                   m_clock;
+
+    std::vector<unsigned char> m_passable;
+    std::vector<Field>         m_landmarks;
+    std::vector<Field>         m_cache;
+
+    // Scratch for the searches
+    std::vector<unsigned>      m_queue;
+    std::vector<unsigned>      m_stamps;
+    unsigned                   m_generation;
+};
+
+
+#endif // DISTANCEORACLE_H_
@@ -4,11 +4,16 @@
 #include "Map.h"
 #include "BF.h"
 
+#include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iomanip>
+#include <mutex>
 #include <ostream>
+#include <thread>
     
 
 namespace
@@ -25,18 +30,20 @@ namespace
 
     struct MarkDistance 
     {
-        MarkDistance( float** map ) : map( map ) {}
+        MarkDistance( float* map, unsigned stride ) : map( map ), stride( stride ) {}
 
         bool operator()( const BFNode* node )
         {
             Location node_loc = node->loc;
-            if( map[ node_loc.row ][ node_loc.col ] == 0.0f ) 
-                map[ node_loc.row ][ node_loc.col ] = node->depth;
+            float& priority = map[ node_loc.row*stride + node_loc.col ];
+            if( priority == 0.0f ) 
+                priority = node->depth;
 
             return true;
         }
 
-        float** map;
+        float*   map;
+        unsigned stride;
     };
     
 
@@ -55,103 +62,131 @@ namespace
     };
 
     typedef BF<MarkDistance, WithinDistance> ComputeDistance;
+
+
+    /// Reusable rendezvous point for the diffusion threads
+    class Barrier
+    {
+    public:
+        explicit Barrier( unsigned count )
+            : m_count( count ), m_waiting( 0 ), m_generation( 0 ) {}
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            const unsigned generation = m_generation;
+            if( ++m_waiting == m_count )
+            {
+                m_waiting = 0;
+                ++m_generation;
+                m_cv.notify_all();
+                return;
+            }
+            while( generation == m_generation )
+                m_cv.wait( lock );
+        }
+
+    private:
+        std::mutex              m_mutex;
+        std::condition_variable m_cv;
+        unsigned                m_count;
+        unsigned                m_waiting;
+        unsigned                m_generation;
+    };
 }
 
 
 Map::Map()
     : m_height( 0u ),
       m_width( 0u  ),
-      m_grid( 0u ),
-      m_scratch( 0u )
+      m_stride( 0u ),
+      m_diffusion_solver( JACOBI ),
+      m_influence_decay( 0.9f ),
+      m_diffusion_threads( 0u )
 {
-    for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-        m_priorities[ j ] = 0u;
 }
 
 
 Map::Map( unsigned height, unsigned width)
-    : m_height( height ),
-      m_width( width ),
-      m_grid( 0u )
+    : m_height( 0u ),
+      m_width( 0u ),
+      m_stride( 0u ),
+      m_diffusion_solver( JACOBI ),
+      m_influence_decay( 0.9f ),
+      m_diffusion_threads( 0u )
 {
-    resize( m_height, m_width );
+    resize( height, width );
 }
 
 
 void Map::resize( unsigned height, unsigned width )
 {
-
-    if( m_grid )
-    {
-        for( unsigned int i = 0; i < m_height; ++i )
-        {
-            delete [] m_grid[i];
-            delete [] m_scratch[i];
-            for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-                delete [] m_priorities[j][i];
-        }
-        delete m_grid;
-        delete m_scratch;
-        for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-            delete m_priorities[ j ];
-    }
-
     m_height = height;
     m_width  = width;
-    
-    m_grid        = new Square*[ m_height ];
-    m_scratch     = new float*[ m_height ];
-    for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-        m_priorities[ j ]  = new float*[ m_height ];
+    m_stride = ( width + 2 + PLANE_ALIGNMENT - 1 ) / PLANE_ALIGNMENT * PLANE_ALIGNMENT;
 
-    for( unsigned int i = 0; i < m_height; ++i )
-    {
-          m_grid[ i ]       = new Square[ m_width ];
-          m_scratch[ i ]    = new float[ m_width ];
-          memset( m_scratch[ i ], 0, m_width*sizeof( float ) );
-
-          for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-          {
-              m_priorities[ j ][ i ] = new float[ m_width ];
-              memset( m_priorities[ j ][ i ], 0, m_width*sizeof( float ) );
-          }
-    }
-}
+    const unsigned plane_size = m_height*m_stride;
+
+    const unsigned num_squares = m_height*m_width;
 
+    m_flags.assign( num_squares, Square::UNKNOWN );
+    m_hill_ids.assign( num_squares, -1 );
+    m_ant_ids.assign( num_squares, -1 );
+    m_new_ant_ids.assign( num_squares, -1 );
+    m_ants.assign( num_squares, SquareAnts() );
+    m_land_mask.assign( plane_size, 0.0f );
+    m_diffuse_scale.assign( plane_size, 0.0f );
+    m_scratch.assign( plane_size, 0.0f );
+    for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
+        m_priorities[ j ].assign( plane_size, 0.0f );
+}
 
 
-Map::~Map()
+void Map::reset()
 {
-    for( unsigned i = 0; i < m_height; ++i )
+    // Leave type alone as this is static between turns
+    for( std::vector<unsigned char>::iterator it = m_flags.begin(); it != m_flags.end(); ++it )
+        *it &= Square::TYPE_MASK;
+
+    std::fill( m_hill_ids.begin(),    m_hill_ids.end(),    -1 );
+    std::fill( m_ant_ids.begin(),     m_ant_ids.end(),     -1 );
+    std::fill( m_new_ant_ids.begin(), m_new_ant_ids.end(), -1 );
+
+    for( std::vector<SquareAnts>::iterator it = m_ants.begin(); it != m_ants.end(); ++it )
     {
-        delete [] m_grid[i];
-        delete [] m_scratch[i];
-        for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-            delete [] ( m_priorities[j][i] );
+        it->ant     = NULL;
+        it->new_ant = NULL;
+        it->deadAnts.clear();
     }
-    delete [] m_grid;
-    delete [] m_scratch;
-    for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-        delete [] m_priorities[ j ];
 
-    m_grid = 0u;
-    m_scratch = 0u;
-    for( int j = 0; j < NUM_PRIORITY_TYPES; ++j )
-        m_priorities[ j ] = 0u;
+    for( int p = 0; p < NUM_PRIORITY_TYPES; ++p )
+        std::fill( m_priorities[ p ].begin(), m_priorities[ p ].end(), 0.0f );
+
+    m_attack_targets.clear();
 }
 
 
-void Map::reset()
+void Map::updatePlanes()
 {
     for( unsigned i = 0u; i < m_height; ++i )
+    {
+        const unsigned char* flags     = &m_flags[ i*m_width ];
+        float*               land_mask = &m_land_mask[ planeIndex( i, 0 ) ];
         for( unsigned j = 0u; j < m_width; ++j )
-        {
-            m_grid[ i ][ j ].reset();
-            for( int p = 0; p < NUM_PRIORITY_TYPES; ++p )
-                m_priorities[ p ][ i ][ j ] = 0u;
-        }
+            land_mask[ j ] = ( flags[ j ] & Square::TYPE_MASK ) == Square::LAND ? 1.0f : 0.0f;
+        land_mask[ -1 ]      = land_mask[ m_width-1 ];
+        land_mask[ m_width ] = land_mask[ 0 ];
+    }
 
-    m_attack_targets.clear();
+    for( unsigned i = 0u; i < m_height; ++i )
+    {
+        const float* north = &m_land_mask[ planeIndex( i == 0          ? m_height-1 : i-1, 0 ) ];
+        const float* south = &m_land_mask[ planeIndex( i == m_height-1 ? 0          : i+1, 0 ) ];
+        const float* land  = &m_land_mask[ planeIndex( i, 0 ) ];
+        float*       scale = &m_diffuse_scale[ planeIndex( i, 0 ) ];
+        for( int j = 0; j < static_cast<int>( m_width ); ++j )
+            scale[ j ] = land[ j ] / ( 1.0f + land[ j-1 ] + land[ j+1 ] + south[ j ] + north[ j ] );
+    }
 }
 
 
@@ -243,22 +278,59 @@ int Map::distance2( const Location& loc0, const Location& loc1 )const
 }
 
 
+void Map::updateDistanceOracle()
+{
+    if( m_distance_oracle.height() != m_height || m_distance_oracle.width() != m_width )
+    {
+        std::vector<unsigned char> passable( m_flags.size() );
+        for( unsigned i = 0u; i < m_flags.size(); ++i )
+            passable[ i ] = ( m_flags[ i ] & Square::TYPE_MASK ) != Square::WATER;
+        m_distance_oracle.reset( m_height, m_width, passable );
+        return;
+    }
+
+    std::vector<unsigned> water;
+    for( unsigned i = 0u; i < m_flags.size(); ++i )
+        if( ( m_flags[ i ] & Square::TYPE_MASK ) == Square::WATER && m_distance_oracle.passable( i ) )
+            water.push_back( i );
+    if( !water.empty() )
+        m_distance_oracle.block( water );
+}
+
+
+int Map::distanceLowerBound( const Location& loc0, const Location& loc1 )const
+{
+    const int manhattan = manhattanDistance( loc0, loc1 );
+    if( m_distance_oracle.height() != m_height || m_distance_oracle.width() != m_width )
+        return manhattan;
+
+    const int bound = m_distance_oracle.lowerBound( loc0.row*m_width + loc0.col, loc1.row*m_width + loc1.col );
+    return std::max( manhattan, bound );
+}
+
+
+int Map::pathDistance( const Location& loc0, const Location& loc1 )
+{
+    if( m_distance_oracle.height() != m_height || m_distance_oracle.width() != m_width )
+        updateDistanceOracle();
+    return m_distance_oracle.distance( loc0.row*m_width + loc0.col, loc1.row*m_width + loc1.col );
+}
+
+
 void Map::makeMove( const Location &loc, Direction direction )
 {
-    Location new_loc = getLocation( loc, direction );
-    m_grid[ new_loc.row ][ new_loc.col ].new_ant_id = m_grid[loc.row][loc.col].ant_id;
-    m_grid[ new_loc.row ][ new_loc.col ].new_ant    = m_grid[loc.row][loc.col].ant;
-    m_grid[ loc.row     ][ loc.col     ].ant_id = -1;
-    m_grid[ loc.row     ][ loc.col     ].ant    = NULL;
+    makeMove( loc, getLocation( loc, direction ) );
 }
 
 
 void Map::makeMove( const Location &loc0, const Location& loc1 )
 {
-    m_grid[ loc1.row ][ loc1.col ].new_ant_id = m_grid[ loc0.row ][ loc0.col ].ant_id;
-    m_grid[ loc1.row ][ loc1.col ].new_ant    = m_grid[ loc0.row ][ loc0.col ].ant;
-    m_grid[ loc0.row ][ loc0.col ].ant_id = -1;
-    m_grid[ loc0.row ][ loc0.col ].ant    = NULL;
+    Square from = (*this)( loc0 );
+    Square to   = (*this)( loc1 );
+    to.new_ant_id = from.ant_id;
+    to.new_ant    = from.ant;
+    from.ant_id   = -1;
+    from.ant      = NULL;
 }
 
 
@@ -316,7 +388,7 @@ void Map::computeDistanceMap( PriorityType type )
     for( it = m_attack_targets.begin(); it != m_attack_targets.end(); ++it )
     {
         if( it->second == 0 ) break;
-        MarkDistance mark_distance( m_priorities[type] );
+        MarkDistance mark_distance( &m_priorities[type][ planeIndex( 0, 0 ) ], m_stride );
         WithinDistance within_distance( it->second );
         ComputeDistance compute_distance( *this, it->first, mark_distance, within_distance );
         compute_distance.setMaxDepth( 1000 );
@@ -324,7 +396,7 @@ void Map::computeDistanceMap( PriorityType type )
 
     }
 
-    MarkDistance    mark_distance( m_priorities[type] );
+    MarkDistance    mark_distance( &m_priorities[type][ planeIndex( 0, 0 ) ], m_stride );
     WithinDistance  within_distance( 0 );
     ComputeDistance compute_distance( *this, mark_distance, within_distance );
     compute_distance.setMaxDepth( 1000 );
@@ -336,13 +408,17 @@ void Map::computeDistanceMap( PriorityType type )
 }
 
 
-void Map::updatePriority( PriorityType type, float amount, SquarePredicate pred )
+void Map::updatePriority( PriorityType type, float amount, unsigned char mask, unsigned char value )
 {
     assert( type == EXPLORE || type == DEFENSE );
 
     for( unsigned int i = 0; i < m_height; ++i )
+    {
+        const unsigned char* flags      = &m_flags[ i*m_width ];
+        float*               priorities = &m_priorities[ type ][ planeIndex( i, 0 ) ];
         for( unsigned int j = 0; j < m_width; ++j )
-            if( pred( m_grid[i][j] ) ) m_priorities[ type ][i][j] += amount;
+            if( ( flags[j] & mask ) == value ) priorities[j] += amount;
+    }
 }
 
 
@@ -350,132 +426,185 @@ void Map::diffusePriority( PriorityType type, unsigned iterations )
 {
     assert( type == EXPLORE || type == DEFENSE );
 
-    const unsigned w = m_width;
-    const unsigned h = m_height;
+    if( iterations == 0 ) return;
 
-    for( unsigned int k = 0; k < iterations; ++k )
+    if( m_diffusion_solver == INFLUENCE )
     {
-        float** priorities = m_priorities[ type ];
+        propagateInfluence( type );
+        return;
+    }
+
+    updatePlanes();
 
-        // Diffuse the internal nodes first
-        for( unsigned i = 1u; i < h-1; ++i )
+    // Fill the halo columns of the input; diffuseRows keeps the output's
+    const unsigned w = m_width;
+    for( unsigned i = 0u; i < m_height; ++i )
+    {
+        float* row = &m_priorities[ type ][ planeIndex( i, 0 ) ];
+        row[ -1 ] = row[ w-1 ];
+        row[ w  ] = row[ 0   ];
+    }
+
+    float* priorities = &m_priorities[ type ][0];
+    float* scratch    = &m_scratch[0];
+
+    unsigned num_threads = std::min( m_diffusion_threads, m_height );
+    if( m_diffusion_threads == 0u && m_height*m_width >= PARALLEL_DIFFUSE_SQUARES )
+        num_threads = std::min( std::max( 1u, std::thread::hardware_concurrency() ), m_height / 16u );
+
+    if( num_threads <= 1u )
+    {
+        for( unsigned k = 0; k < iterations; ++k )
         {
-            for( unsigned j = 1u; j < w-1; ++j )
-            {
-                if( m_grid[ i ][ j ].isLand() )
-                {
-                    float sum       = priorities[ i ][ j ];
-                    float num_nodes = 1.0f;
-                    if( m_grid[ i+0 ][ j-1 ].isLand() ) { sum += priorities[ i+0 ][ j-1 ]; num_nodes += 1.0f; }
-                    if( m_grid[ i+0 ][ j+1 ].isLand() ) { sum += priorities[ i+0 ][ j+1 ]; num_nodes += 1.0f; }
-                    if( m_grid[ i+1 ][ j+0 ].isLand() ) { sum += priorities[ i+1 ][ j+0 ]; num_nodes += 1.0f; }
-                    if( m_grid[ i-1 ][ j+0 ].isLand() ) { sum += priorities[ i-1 ][ j+0 ]; num_nodes += 1.0f; }
-                    m_scratch[ i ][ j ] = sum / num_nodes; 
-                }
-            }
+            diffuseRows( priorities, scratch, 0, m_height );
+            std::swap( priorities, scratch );
         }
-
-        // Now do outside ring
-        for( unsigned i = 1u; i < h-1; ++i )
+    }
+    else
+    {
+        // A band reads its neighbors' edge rows, so every band finishes a
+        // step before any starts the next
+        Barrier barrier( num_threads );
+        auto band = [&]( unsigned t )
         {
-            if( m_grid[ i ][ 0 ].isLand() )
-            {
-                float sum         = priorities[ i ][ 0 ];
-                float num_nodes   = 1.0f;
-                if( m_grid[ i+0 ][ w-1 ].isLand() ) { sum += priorities[ i+0 ][ w-1 ]; num_nodes += 1.0f; }
-                if( m_grid[ i+0 ][ 1   ].isLand() ) { sum += priorities[ i+0 ][ 1   ]; num_nodes += 1.0f; }
-                if( m_grid[ i+1 ][ 0   ].isLand() ) { sum += priorities[ i+1 ][ 0   ]; num_nodes += 1.0f; }
-                if( m_grid[ i-1 ][ 0   ].isLand() ) { sum += priorities[ i-1 ][ 0   ]; num_nodes += 1.0f; }
-                m_scratch[ i ][ 0 ] = sum / num_nodes; 
-            }
-            
-            if( m_grid[ i ][ w-1 ].isLand() )
+            const unsigned begin = m_height *  t    / num_threads;
+            const unsigned end   = m_height * (t+1) / num_threads;
+            float* in  = priorities;
+            float* out = scratch;
+            for( unsigned k = 0; k < iterations; ++k )
             {
-                float sum       = priorities[ i ][ w-1 ];
-                float num_nodes = 1.0f;
-                if( m_grid[ i+0 ][ w-2 ].isLand() ) { sum += priorities[ i+0 ][ w-2 ]; num_nodes += 1.0f; }
-                if( m_grid[ i+0 ][ 0   ].isLand() ) { sum += priorities[ i+0 ][ 0   ]; num_nodes += 1.0f; }
-                if( m_grid[ i+1 ][ w-1 ].isLand() ) { sum += priorities[ i+1 ][ w-1 ]; num_nodes += 1.0f; }
-                if( m_grid[ i-1 ][ w-1 ].isLand() ) { sum += priorities[ i-1 ][ w-1 ]; num_nodes += 1.0f; }
-                m_scratch[ i ][ w-1 ] = sum / num_nodes; 
+                diffuseRows( in, out, begin, end );
+                barrier.wait();
+                std::swap( in, out );
             }
+        };
 
-        }
+        std::vector<std::thread> threads;
+        for( unsigned t = 1; t < num_threads; ++t )
+            threads.push_back( std::thread( band, t ) );
+        band( 0 );
+        for( unsigned t = 0; t < threads.size(); ++t )
+            threads[ t ].join();
 
-        for( unsigned j = 1u; j < w-1; ++j )
-        {
-            if( m_grid[ 0 ][ j ].isLand() )
-            {
-                float sum         = priorities[ 0 ][ j ];
-                float num_nodes   = 1.0f;
-                if( m_grid[ 0   ][ j-1 ].isLand() ) { sum += priorities[ 0   ][ j-1 ]; num_nodes += 1.0f; }
-                if( m_grid[ 0   ][ j+1 ].isLand() ) { sum += priorities[ 0   ][ j+1 ]; num_nodes += 1.0f; }
-                if( m_grid[ h-1 ][ j+0 ].isLand() ) { sum += priorities[ h-1 ][ j+0 ]; num_nodes += 1.0f; }
-                if( m_grid[ 1   ][ j+0 ].isLand() ) { sum += priorities[ 1   ][ j+0 ]; num_nodes += 1.0f; }
-                m_scratch[ 0 ][ j ] = sum / num_nodes; 
-            }
-            
-            if( m_grid[ h-1 ][ j ].isLand() )
-            {
-                float sum       = priorities[  h-1 ][ j ];
-                float num_nodes = 1.0f;
-                if( m_grid[ h-1 ][ j-1 ].isLand() ) { sum += priorities[ h-1 ][ j-1 ]; num_nodes += 1.0f; }
-                if( m_grid[ h-1 ][ j+1 ].isLand() ) { sum += priorities[ h-1 ][ j+1 ]; num_nodes += 1.0f; }
-                if( m_grid[ h-2 ][ j+0 ].isLand() ) { sum += priorities[ h-2 ][ j+0 ]; num_nodes += 1.0f; }
-                if( m_grid[ 0   ][ j+0 ].isLand() ) { sum += priorities[ 0   ][ j+0 ]; num_nodes += 1.0f; }
-                m_scratch[  h-1 ][ j ] = sum / num_nodes; 
-            }
-        }
+        if( iterations % 2 ) std::swap( priorities, scratch );
+    }
 
+    if( priorities != &m_priorities[ type ][0] )
+        m_priorities[ type ].swap( m_scratch );
+}
 
-        // four corners
-        if( m_grid[ 0 ][ 0 ].isLand() )
-        {
-            float sum         = priorities[ 0 ][ 0 ];
-            float num_nodes   = 1.0f;
-            if( m_grid[ 0   ][ w-1 ].isLand() ) { sum += priorities[ 0   ][ w-1 ]; num_nodes += 1.0f; }
-            if( m_grid[ 0   ][ 1   ].isLand() ) { sum += priorities[ 0   ][ 1   ]; num_nodes += 1.0f; }
-            if( m_grid[ h-1 ][ 0   ].isLand() ) { sum += priorities[ h-1 ][ 0   ]; num_nodes += 1.0f; }
-            if( m_grid[ 1   ][ 0   ].isLand() ) { sum += priorities[ 1   ][ 0   ]; num_nodes += 1.0f; }
-            m_scratch[ 0 ][ 0 ] = sum / num_nodes; 
-        }
-        
-        if( m_grid[ 0 ][ w-1 ].isLand() )
+
+void Map::diffuseRows( const float* in, float* out, unsigned begin, unsigned end )const
+{
+    const int      w = m_width;
+    const unsigned h = m_height;
+
+    for( unsigned i = begin; i < end; ++i )
+    {
+        const unsigned row   = planeIndex( i, 0 );
+        const float*   p     = in + row;
+        const float*   pn    = in + planeIndex( i == 0   ? h-1 : i-1, 0 );
+        const float*   ps    = in + planeIndex( i == h-1 ? 0   : i+1, 0 );
+        const float*   land  = &m_land_mask[ row ];
+        const float*   ln    = &m_land_mask[ pn - in ];
+        const float*   ls    = &m_land_mask[ ps - in ];
+        const float*   scale = &m_diffuse_scale[ row ];
+        float*         o     = out + row;
+
+        // Same summation order as a branching west, east, south, north
+        // stencil.  Water neighbors add an exact zero and water squares,
+        // whose scale is zero, keep their value.
+        for( int j = 0; j < w; ++j )
         {
-            float sum         = priorities[ 0 ][ w-1 ];
-            float num_nodes   = 1.0f;
-            if( m_grid[ 0   ][ w-2 ].isLand() ) { sum += priorities[ 0   ][ w-2 ]; num_nodes += 1.0f; }
-            if( m_grid[ 0   ][ 0   ].isLand() ) { sum += priorities[ 0   ][ 0   ]; num_nodes += 1.0f; }
-            if( m_grid[ h-1 ][ w-1 ].isLand() ) { sum += priorities[ h-1 ][ w-1 ]; num_nodes += 1.0f; }
-            if( m_grid[ 1   ][ w-1 ].isLand() ) { sum += priorities[ 1   ][ w-1 ]; num_nodes += 1.0f; }
-            m_scratch[ 0 ][ w-1 ] = sum / num_nodes; 
+            const float sum = p[ j ] + land[ j-1 ]*p[ j-1 ] + land[ j+1 ]*p[ j+1 ]
+                                     + ls[ j ]*ps[ j ] + ln[ j ]*pn[ j ];
+            o[ j ] = sum*scale[ j ] + ( 1.0f - land[ j ] )*p[ j ];
         }
+        o[ -1 ] = o[ w-1 ];
+        o[ w  ] = o[ 0   ];
+    }
+}
+
+
+void Map::setDiffusionSolver( DiffusionSolver solver, float decay )
+{
+    assert( decay > 0.0f && decay < 1.0f );
+    m_diffusion_solver = solver;
+    m_influence_decay  = decay;
+}
 
-        if( m_grid[ h-1 ][ 0 ].isLand() )
+
+void Map::propagateInfluence( PriorityType type )
+{
+    updatePlanes();
+
+    typedef std::pair<float, unsigned> Entry;  // influence, square index
+    std::vector<Entry> queue[ 2 ];             // positive, negated negative
+
+    // Sources are taken up front as the plane is overwritten with the result
+    float* priorities = &m_priorities[ type ][0];
+    for( unsigned i = 0u; i < m_height; ++i )
+        for( unsigned j = 0u; j < m_width; ++j )
         {
-            float sum         = priorities[ h-1 ][ 0 ];
-            float num_nodes   = 1.0f;
-            if( m_grid[ h-1 ][ w-1 ].isLand() ) { sum += priorities[ h-1 ][ w-1 ]; num_nodes += 1.0f; }
-            if( m_grid[ h-1 ][ 1   ].isLand() ) { sum += priorities[ h-1 ][ 1   ]; num_nodes += 1.0f; }
-            if( m_grid[ h-2 ][ 0   ].isLand() ) { sum += priorities[ h-2 ][ 0   ]; num_nodes += 1.0f; }
-            if( m_grid[ 0   ][ 0   ].isLand() ) { sum += priorities[ 0   ][ 0   ]; num_nodes += 1.0f; }
-            m_scratch[ h-1 ][ 0 ] = sum / num_nodes; 
+            const unsigned index = planeIndex( i, j );
+            if( m_land_mask[ index ] == 0.0f ) continue;
+
+            const float priority = priorities[ index ];
+            if( priority > 0.0f ) queue[ 0 ].push_back( Entry(  priority, i*m_width+j ) );
+            if( priority < 0.0f ) queue[ 1 ].push_back( Entry( -priority, i*m_width+j ) );
+            priorities[ index ] = 0.0f;
         }
 
-        if( m_grid[ h-1 ][ w-1 ].isLand() )
+    // Max-product Dijkstra.  Every step scales by the same decay < 1, so
+    // squares pop in falling order of influence and the influences they
+    // pass on are queued in falling order too.  Merging the sorted sources
+    // with that FIFO replaces the heap.
+    float* best = &m_scratch[0];
+    std::vector<Entry> fifo;
+    for( int sign = 0; sign < 2; ++sign )
+    {
+        std::vector<Entry>& sources = queue[ sign ];
+        std::sort( sources.begin(), sources.end(), std::greater<Entry>() );
+        std::fill( m_scratch.begin(), m_scratch.end(), 0.0f );
+        for( std::vector<Entry>::iterator it = sources.begin(); it != sources.end(); ++it )
+            best[ planeIndex( it->second / m_width, it->second % m_width ) ] = it->first;
+
+        fifo.clear();
+        size_t next_source = 0;
+        size_t next_fifo   = 0;
+        while( next_source < sources.size() || next_fifo < fifo.size() )
         {
-            float sum         = priorities[ h-1 ][ w-1 ];
-            float num_nodes   = 1.0f;
-            if( m_grid[ h-1 ][ w-2 ].isLand() ) { sum += priorities[ h-1 ][ w-2 ]; num_nodes += 1.0f; }
-            if( m_grid[ h-1 ][ 0   ].isLand() ) { sum += priorities[ h-1 ][ 0   ]; num_nodes += 1.0f; }
-            if( m_grid[ h-2 ][ w-1 ].isLand() ) { sum += priorities[ h-2 ][ w-1 ]; num_nodes += 1.0f; }
-            if( m_grid[ 0   ][ w-1 ].isLand() ) { sum += priorities[ 0   ][ w-1 ]; num_nodes += 1.0f; }
-            m_scratch[ h-1 ][ w-1 ] = sum / num_nodes; 
+            const bool from_source = next_fifo == fifo.size() ||
+                                     ( next_source < sources.size() &&
+                                       sources[ next_source ].first >= fifo[ next_fifo ].first );
+            const Entry entry = from_source ? sources[ next_source++ ] : fifo[ next_fifo++ ];
+
+            const unsigned row = entry.second / m_width;
+            const unsigned col = entry.second % m_width;
+            if( entry.first < best[ planeIndex( row, col ) ] ) continue;
+
+            const float influence = entry.first * m_influence_decay;
+            const unsigned neighbors[ 4 ][ 2 ] =
+            {
+                { row, col == 0          ? m_width-1  : col-1 },
+                { row, col == m_width-1  ? 0          : col+1 },
+                { row == m_height-1 ? 0          : row+1, col },
+                { row == 0          ? m_height-1 : row-1, col }
+            };
+            for( int n = 0; n < 4; ++n )
+            {
+                const unsigned index = planeIndex( neighbors[ n ][ 0 ], neighbors[ n ][ 1 ] );
+                if( m_land_mask[ index ] == 0.0f || influence <= best[ index ] ) continue;
+
+                best[ index ] = influence;
+                fifo.push_back( Entry( influence, neighbors[ n ][ 0 ]*m_width + neighbors[ n ][ 1 ] ) );
+            }
         }
 
-        // Swap buffers
-        m_priorities[ type ] = m_scratch;
-        m_scratch            = priorities;
+        const float scale = sign == 0 ? 1.0f : -1.0f;
+        for( unsigned i = 0u; i < m_height; ++i )
+            for( unsigned j = 0u; j < m_width; ++j )
+                priorities[ planeIndex( i, j ) ] += scale*best[ planeIndex( i, j ) ];
     }
 }
 
@@ -487,7 +616,7 @@ std::ostream& operator<<( std::ostream &os, const Map& map )
     {
         for( unsigned j = 0u; j < map.m_width; ++j )
         {
-            const Square& square = map.m_grid[ i ][ j ];
+            const Square square = map( i, j );
             os << ' ';
             if     ( square.food           ) os << 'f';
             else if( square.ant_id >=0     ) os << static_cast<char>( 'a' + square.ant_id );
@@ -504,15 +633,15 @@ std::ostream& operator<<( std::ostream &os, const Map& map )
         os << Map::priorityTypeString( static_cast<Map::PriorityType>( p ) ) << std::endl
            << "------------------------------------------------------------------" << std::endl;
 
-        float** priorities = map.m_priorities[ p ];
+        const float* priorities = &map.m_priorities[ p ][0];
 
         for( unsigned i = 0u; i < map.m_height; ++i )
         {
             for( unsigned j = 0u; j < map.m_width; ++j )
             {
-                const Square& square = map.m_grid[ i ][ j ];
+                const Square square = map( i, j );
                 os << ' ';
-                os << std::fixed << std::setw( 8 ) << std::setprecision( 3 ) << priorities[ i ][ j ]; 
+                os << std::fixed << std::setw( 8 ) << std::setprecision( 3 ) << priorities[ map.planeIndex( i, j ) ]; 
                 if     ( square.food           ) os << 'f';
                 else if( square.ant_id >=0     ) os << static_cast<char>( 'a' + square.ant_id );
                 else if( square.new_ant_id >=0 ) os << static_cast<char>( 'a' + square.new_ant_id );
@@ -3,6 +3,7 @@
 #define MAP_H_
 
 #include "Direction.h"
+#include "DistanceOracle.h"
 #include "Square.h"
 #include "Location.h"
 
@@ -11,6 +12,28 @@
 #include <vector>
 #include <string>
 
+//
+// Squares are stored as planes, row major: a byte of type and flag bits, an
+// int8 player id plane each for hills, ants and moved ants, and the ant
+// pointers apart from those.  operator() hands out a Square viewing one
+// square across them, while reset and updatePriority walk the planes
+// directly.  Each priority type has a float plane of its own, with rows
+// padded to a whole number of SIMD widths.  diffusePriority reads a land
+// mask plane, refreshed from the flags at the start of each call.
+//
+// Plane rows carry a halo column on either side holding a copy of the
+// opposite edge, so the diffusion stencil wraps east-west without edge
+// cases.  It runs branch free over precomputed land masks and reciprocal
+// neighbor counts, split into row bands over threads on large maps.
+//
+// With the INFLUENCE solver diffusePriority instead makes one Dijkstra pass
+// over the land from every non-zero square, decaying by a constant factor
+// per step, which reaches across the map in the time of a few Jacobi steps.
+//
+// Walking distances come from a DistanceOracle over the non-water squares,
+// refreshed by updateDistanceOracle as water is revealed.  Unknown squares
+// count as passable, so its distances never overestimate the true ones.
+//
 
 
 class Map
@@ -24,11 +47,15 @@ public:
         NUM_PRIORITY_TYPES
     };
 
+    enum DiffusionSolver
+    {
+        JACOBI=0,          // iterations of the averaging stencil
+        INFLUENCE          // strongest decayed source, see propagateInfluence
+    };
+
     Map();
     Map( unsigned height, unsigned width);
 
-    ~Map();
-
     void resize( unsigned height, unsigned width);
 
     // Reset all squares to empty state.  Leave water as is
@@ -51,33 +78,56 @@ public:
     float distance         ( const Location& loc0, const Location& loc1 )const;
     int   distance2        ( const Location& loc0, const Location& loc1 )const;
 
+    // Fold newly seen water into the distance oracle, building it on the
+    // first call after a resize
+    void updateDistanceOracle();
+
+    // Walking distance lower bound, no less than manhattanDistance, in
+    // O(landmarks).  Very large if no path exists
+    int distanceLowerBound( const Location& loc0, const Location& loc1 )const;
+
+    // Exact walking distance, a lookup for recently queried destinations
+    int pathDistance( const Location& loc0, const Location& loc1 );
+
     void makeMove( const Location &loc, Direction direction );
     void makeMove( const Location &loc0, const Location& loc1 );
 
 
     void setPriority( PriorityType type, const Location& loc, float priority )
-    { rangeCheck( loc.row, loc.col ); m_priorities[ type ][ loc.row ][ loc.col ] = priority; }
+    { rangeCheck( loc.row, loc.col ); m_priorities[ type ][ planeIndex( loc.row, loc.col ) ] = priority; }
     
     float getPriority( PriorityType type, const Location& loc )const
-    { rangeCheck( loc.row, loc.col ); return m_priorities[ type ][ loc.row ][ loc.col ]; }
+    { rangeCheck( loc.row, loc.col ); return m_priorities[ type ][ planeIndex( loc.row, loc.col ) ]; }
 
-    void updatePriority( PriorityType type, float amount, SquarePredicate pred );
+    // Add amount to the priority of every square whose flags, masked by mask,
+    // equal value, e.g. Square::VISIBLE and 0 for the squares out of view
+    void updatePriority( PriorityType type, float amount, unsigned char mask, unsigned char value );
     void diffusePriority( PriorityType type, unsigned iterations );
 
+    // Choose how diffusePriority spreads priorities.  decay is the per step
+    // falloff of the INFLUENCE solver, in (0, 1)
+    void setDiffusionSolver( DiffusionSolver solver, float decay = 0.9f );
+    DiffusionSolver getDiffusionSolver()const { return m_diffusion_solver; }
+
+    // Number of row bands the JACOBI solver runs on, each on its own thread.
+    // 0, the default, uses every hardware thread on large maps and one
+    // otherwise
+    void setDiffusionThreads( unsigned threads ) { m_diffusion_threads = threads; }
+
     void setDistanceTarget( PriorityType type, const Location& loc, int max_depth );
     void computeDistanceMap( PriorityType type );
 
-    Square& operator()( const Location& loc )
-    { rangeCheck( loc.row, loc.col ); return m_grid[loc.row][loc.col]; }
+    Square operator()( const Location& loc )
+    { rangeCheck( loc.row, loc.col ); return square( loc.row*m_width + loc.col ); }
 
-    const Square& operator()( const Location& loc )const
-    { rangeCheck( loc.row, loc.col ); return m_grid[loc.row][loc.col]; }
+    const Square operator()( const Location& loc )const
+    { rangeCheck( loc.row, loc.col ); return const_cast<Map*>( this )->square( loc.row*m_width + loc.col ); }
 
-    Square& operator()( unsigned row, unsigned col )
-    { rangeCheck( row, col ); return m_grid[row][col]; }
+    Square operator()( unsigned row, unsigned col )
+    { rangeCheck( row, col ); return square( row*m_width + col ); }
 
-    const Square& operator()( unsigned row, unsigned col )const
-    { rangeCheck( row, col ); return m_grid[row][col]; }
+    const Square operator()( unsigned row, unsigned col )const
+    { rangeCheck( row, col ); return const_cast<Map*>( this )->square( row*m_width + col ); }
 
     void rangeCheck( unsigned row, unsigned col )const
     { assert( row < m_height &&  col < m_width ); }
@@ -90,14 +140,52 @@ public:
     friend std::ostream& operator<<(std::ostream& os, const Map& map);
 
 private:
+    // Floats per SIMD register; plane rows are padded to a multiple of this
+    static const unsigned PLANE_ALIGNMENT = 8;
+
+    // Maps with at least this many squares diffuse on several threads unless
+    // setDiffusionThreads says otherwise
+    static const unsigned PARALLEL_DIFFUSE_SQUARES = 256*256;
+
+    // Skip the west halo column
+    unsigned planeIndex( unsigned row, unsigned col )const
+    { return row*m_stride + col + 1; }
+
+    Square square( unsigned index )
+    { return Square( m_flags[ index ], m_hill_ids[ index ], m_ant_ids[ index ], m_new_ant_ids[ index ], m_ants[ index ] ); }
+
     void getDxDy( const Location& loc0, const Location& loc1, int& dx, int& dy )const;
 
+    // Refresh the land mask and diffusion scale planes from the flags
+    void updatePlanes();
+
+    // One Jacobi step of the stencil over rows [begin, end), from in to out
+    void diffuseRows( const float* in, float* out, unsigned begin, unsigned end )const;
+
+    // Replace each land square's priority by the strongest positive plus the
+    // strongest negative priority reaching it, scaled by decay per step
+    void propagateInfluence( PriorityType type );
+
     unsigned m_height;
     unsigned m_width;
-    Square** m_grid;
+    unsigned m_stride;                               ///< Row pitch of the planes, halo included
+
+    std::vector<unsigned char> m_flags;              ///< Square::Type and Square::Flag bits, m_height x m_width
+    std::vector<int8_t>        m_hill_ids;           ///< Player ids, -1 if none, m_height x m_width
+    std::vector<int8_t>        m_ant_ids;
+    std::vector<int8_t>        m_new_ant_ids;
+    std::vector<SquareAnts>    m_ants;               ///< m_height x m_width
+    std::vector<float>         m_land_mask;          ///< 1 for land, 0 otherwise, m_stride per row
+    std::vector<float>         m_diffuse_scale;      ///< 1/(1+land neighbors) for land
+
+    std::vector<float>         m_priorities[ NUM_PRIORITY_TYPES ];
+    std::vector<float>         m_scratch;
+
+    DiffusionSolver            m_diffusion_solver;
+    float                      m_influence_decay;
+    unsigned                   m_diffusion_threads;  ///< 0 to choose from the map size
 
-    float**  m_priorities[ NUM_PRIORITY_TYPES ];
-    float**  m_scratch;
+    DistanceOracle             m_distance_oracle;
 
     typedef std::vector< std::pair<Location, int> > DistanceTargets;
     DistanceTargets m_attack_targets;
@@ -109,16 +197,16 @@ template<class Predicate>
 void Map::getNeighbors( const Location& loc, Predicate predicate, std::vector<Location>& neighbors )const
 {
     Location nloc = getLocation( loc, NORTH );
-    if( predicate( m_grid[ nloc.row ][ nloc.col ] ) ) neighbors.push_back( nloc );
+    if( predicate( (*this)( nloc ) ) ) neighbors.push_back( nloc );
     
     nloc = getLocation( loc, EAST );
-    if( predicate( m_grid[ nloc.row ][ nloc.col ] ) ) neighbors.push_back( nloc );
+    if( predicate( (*this)( nloc ) ) ) neighbors.push_back( nloc );
 
     nloc = getLocation( loc, SOUTH );
-    if( predicate( m_grid[ nloc.row ][ nloc.col ] ) ) neighbors.push_back( nloc );
+    if( predicate( (*this)( nloc ) ) ) neighbors.push_back( nloc );
 
     nloc = getLocation( loc, WEST );
-    if( predicate( m_grid[ nloc.row ][ nloc.col ] ) ) neighbors.push_back( nloc );
+    if( predicate( (*this)( nloc ) ) ) neighbors.push_back( nloc );
 }
 
 #endif // MAP_H_
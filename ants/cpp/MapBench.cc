@@ -0,0 +1,133 @@
+#include "BenchMap.h"
+#include "LatencyHistogram.h"
+#include "Map.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//
+// Times the per turn Map work of Bot::makeMoves on a synthetic map: reset,
+// vision, the attack distance map, defense and explore diffusion and the
+// explore priority update.  Prints mean ms per phase, the turn time
+// percentiles, turns per second and a checksum of the priorities, which
+// should not change with the storage layout.
+//
+// Usage: mapbench [turns, default 50] [size, default 200]
+//
+
+namespace
+{
+
+const int   NUM_ANTS     = 100;
+const int   NUM_FOOD     = 40;
+const int   NUM_HILLS    = 4;
+
+
+enum Phase
+{
+    RESET=0,
+    VISION,
+    DISTANCE,
+    DEFENSE,
+    EXPLORE,
+    NUM_PHASES
+};
+
+const char* PHASE_NAMES[ NUM_PHASES ] = { "reset", "vision", "distance", "defense", "explore" };
+
+
+void moveAnts( Map& map, std::vector<Location>& ants )
+{
+    for( std::vector<Location>::iterator it = ants.begin(); it != ants.end(); ++it )
+    {
+        Location next = map.getLocation( *it, static_cast<Direction>( rand() % NUM_DIRECTIONS ) );
+        if( map( next ).isLand() )
+            *it = next;
+    }
+}
+
+
+double checksum( const Map& map )
+{
+    double sum = 0.0;
+    for( unsigned i = 0; i < map.height(); ++i )
+        for( unsigned j = 0; j < map.width(); ++j )
+            for( int p = 0; p < Map::NUM_PRIORITY_TYPES; ++p )
+                sum += map.getPriority( static_cast<Map::PriorityType>( p ), Location( i, j ) );
+    return sum;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const int turns = argc > 1 ? atoi( argv[1] ) : 50;
+    const int size  = argc > 2 ? atoi( argv[2] ) : 200;
+
+    srand( 1234 );
+    Map map( size, size );
+    makeTerrain( map );
+
+    std::vector<Location> ants;
+    for( int i = 0; i < NUM_ANTS; ++i )
+        ants.push_back( randomLand( map ) );
+    std::vector<Location> hills;
+    for( int i = 0; i < NUM_HILLS; ++i )
+        hills.push_back( randomLand( map ) );
+
+    LatencyHistogram turn_times( "turn" );
+    double phase_ms[ NUM_PHASES ] = { 0.0 };
+
+    Timer turn_timer;
+    Timer timer;
+    for( int turn = 0; turn < turns; ++turn )
+    {
+        moveAnts( map, ants );
+        turn_timer.start();
+
+        timer.start();
+        map.reset();
+        phase_ms[ RESET ] += timer.getTime();
+
+        timer.start();
+        updateVision( map, ants );
+        for( int i = 0; i < NUM_FOOD; ++i )
+            map( randomLand( map ) ).food = true;
+        phase_ms[ VISION ] += timer.getTime();
+
+        timer.start();
+        for( std::vector<Location>::iterator it = hills.begin()+1; it != hills.end(); ++it )
+            map.setDistanceTarget( Map::ATTACK, *it, 0 );
+        map.computeDistanceMap( Map::ATTACK );
+        phase_ms[ DISTANCE ] += timer.getTime();
+
+        timer.start();
+        map.setPriority( Map::DEFENSE, map.getLocation( hills[0], NORTH ), 100 );
+        map.diffusePriority( Map::DEFENSE, 12 );
+        phase_ms[ DEFENSE ] += timer.getTime();
+
+        timer.start();
+        map.updatePriority( Map::EXPLORE, 100, Square::VISIBLE, 0 );
+        for( std::vector<Location>::iterator it = ants.begin(); it != ants.end(); ++it )
+            map.setPriority( Map::EXPLORE, *it, -100 );
+        map.diffusePriority( Map::EXPLORE, std::max( map.height(), map.width() ) );
+        phase_ms[ EXPLORE ] += timer.getTime();
+
+        turn_times.record( turn_timer.getTime()*1.0e-3 );
+    }
+
+    std::cout << size << "x" << size << " map, " << turns << " turns" << std::endl;
+    for( int p = 0; p < NUM_PHASES; ++p )
+        std::cout << std::setw( 10 ) << PHASE_NAMES[ p ]
+                  << std::setw( 10 ) << std::fixed << std::setprecision( 3 )
+                  << phase_ms[ p ] / turns << " ms" << std::endl;
+    turn_times.print( std::cout );
+    std::cout << "turns/sec: " << std::setprecision( 1 ) << 1.0 / turn_times.getMean() << std::endl;
+    std::cout << "checksum: " << std::setprecision( 6 ) << checksum( map ) << std::endl;
+    return 0;
+}
@@ -4,9 +4,10 @@
 
 #include "Ant.h"
 
-#include <vector>
-#include <string>
 #include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
 
 /*
     struct for representing a square in the grid.
@@ -28,6 +29,27 @@ bool hasFood( const Square& s );
 
 std::ostream& operator<<( std::ostream& os, const Square& s );
 
+//
+// The fields of a square only the ants themselves need, kept out of the
+// planes the per turn scans walk
+//
+struct SquareAnts
+{
+    SquareAnts() : ant( NULL ), new_ant( NULL ) {}
+
+    Ant*  ant;                  ///< Ant data if present, NULL otherwise
+    Ant*  new_ant;              ///< Ant data if present, NULL otherwise
+
+    std::vector<int> deadAnts; ///< List of present dead ant's player ids
+};
+
+
+//
+// A view of one square of a Map.  The type and boolean fields share a flags
+// byte and the player ids are int8, each in a plane of its own held by the
+// Map; the members below read and write through to them, so a Square is
+// only ever made by the Map and copying it copies the view, not the square.
+//
 struct Square
 {
     //
@@ -39,15 +61,76 @@ struct Square
         LAND,
         UNKNOWN
     };
-    
+
+    //
+    // Bits of the flags byte.  The type sits in the low bits
+    //
+    enum Flag
+    {
+        TYPE_MASK      = 0x03,
+        VISIBLE        = 0x04,
+        FOOD           = 0x08,
+        ASSIGNED       = 0x10,
+        IN_ENEMY_RANGE = 0x20
+    };
+
+    class TypeRef
+    {
+    public:
+        explicit TypeRef( unsigned char& flags ) : m_flags( flags ) {}
+
+        operator Type()const { return static_cast<Type>( m_flags & TYPE_MASK ); }
+
+        TypeRef& operator=( Type type )
+        { m_flags = ( m_flags & ~TYPE_MASK ) | type; return *this; }
+
+        TypeRef& operator=( const TypeRef& other )
+        { return *this = static_cast<Type>( other ); }
+
+    private:
+        unsigned char& m_flags;
+    };
+
+    template<unsigned char BIT>
+    class FlagRef
+    {
+    public:
+        explicit FlagRef( unsigned char& flags ) : m_flags( flags ) {}
+
+        operator bool()const { return ( m_flags & BIT ) != 0; }
+
+        FlagRef& operator=( bool value )
+        { m_flags = value ? m_flags | BIT : m_flags & ~BIT; return *this; }
+
+        FlagRef& operator=( const FlagRef& other )
+        { return *this = static_cast<bool>( other ); }
+
+    private:
+        unsigned char& m_flags;
+    };
+
+    class IdRef
+    {
+    public:
+        explicit IdRef( int8_t& id ) : m_id( id ) {}
+
+        operator int()const { return m_id; }
+
+        IdRef& operator=( int id )
+        { m_id = static_cast<int8_t>( id ); return *this; }
+
+        IdRef& operator=( const IdRef& other )
+        { return *this = static_cast<int>( other ); }
+
+    private:
+        int8_t& m_id;
+    };
+
     //
     // Methods
     //
     
-    Square();
-
-    /// Resets the information for the square except type information
-    void reset();
+    Square( unsigned char& flags, int8_t& hill_id, int8_t& ant_id, int8_t& new_ant_id, SquareAnts& ants );
 
     void setVisible();
 
@@ -63,53 +146,38 @@ struct Square
     // Members
     //
     
-    Type  type;                 ///< What type of square is this 
-    int   hill_id;              ///< Hill player id, -1 if none
-    int   ant_id;               ///< Ant player id, -1 if none
-    int   new_ant_id;           ///< Ant player id, -1 if none
-    Ant*  ant;                  ///< Ant data if present, NULL otherwise
-    Ant*  new_ant;              ///< Ant data if present, NULL otherwise
-    bool  assigned;
-    bool  visible;              ///< Is this square visible to any ants?
-    bool  food;                 ///< Does this square contain food 
-    bool  in_enemy_range;
-
-    std::vector<int> deadAnts; ///< List of present dead ant's player ids
+    TypeRef                    type;            ///< What type of square is this 
+    IdRef                      hill_id;         ///< Hill player id, -1 if none
+    IdRef                      ant_id;          ///< Ant player id, -1 if none
+    IdRef                      new_ant_id;      ///< Ant player id, -1 if none
+    Ant*&                      ant;             ///< Ant data if present, NULL otherwise
+    Ant*&                      new_ant;         ///< Ant data if present, NULL otherwise
+    FlagRef<ASSIGNED>          assigned;
+    FlagRef<VISIBLE>           visible;         ///< Is this square visible to any ants?
+    FlagRef<FOOD>              food;            ///< Does this square contain food 
+    FlagRef<IN_ENEMY_RANGE>    in_enemy_range;
+
+    std::vector<int>&          deadAnts;        ///< List of present dead ant's player ids
 };
 
     
-inline Square::Square()
-    : type( UNKNOWN ),
-      hill_id( -1 ),
-      ant_id( -1 ),
-      new_ant_id( -1 ),
-      ant( NULL ),
-      new_ant( NULL ),
-      assigned( false ),
-      visible( false ),
-      food( false ),
-      in_enemy_range( false )
+inline Square::Square( unsigned char& flags, int8_t& hill_id, int8_t& ant_id, int8_t& new_ant_id,
+                       SquareAnts& ants )
+    : type( flags ),
+      hill_id( hill_id ),
+      ant_id( ant_id ),
+      new_ant_id( new_ant_id ),
+      ant( ants.ant ),
+      new_ant( ants.new_ant ),
+      assigned( flags ),
+      visible( flags ),
+      food( flags ),
+      in_enemy_range( flags ),
+      deadAnts( ants.deadAnts )
 {
 }
 
 
-inline void Square::reset()
-{
-    // Leave type alone as this is static between turns
-    hill_id     = -1;
-    ant_id      = -1;
-    new_ant_id  = -1;
-    ant         = NULL;
-    new_ant     = NULL;
-    assigned    = false;
-    visible     = false;
-    food        = false;
-    in_enemy_range = false;
-
-    deadAnts.clear();
-};
-
-
 inline void Square::setVisible()
 {
     visible = true;
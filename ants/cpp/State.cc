@@ -8,6 +8,17 @@
 
 using namespace std;
 
+
+namespace
+{
+    /// Same test as Map::distance( loc0, loc1 ) <= radius
+    bool inView( const Location& offset, float radius )
+    {
+        return sqrtf( static_cast<float>( offset.row*offset.row ) +
+                      static_cast<float>( offset.col*offset.col ) ) <= radius;
+    }
+}
+
 State::State()
     : m_rows(0),
       m_cols(0),
@@ -32,6 +43,49 @@ State::~State()
 
 void State::setup()
 {
+    //
+    // View stencils.  Distances are computed as Map::distance does so the
+    // stencil matches the server's euclidean view exactly.
+    //
+    const int r = static_cast<int>( m_view_radius ) + 1;
+    m_view_stencil.clear();
+    m_view_ring.clear();
+    for( int i = 0; i < NONE; ++i )
+    {
+        m_view_enter[ i ].clear();
+        m_view_leave[ i ].clear();
+    }
+
+    for( int dr = -r-1; dr <= r+1; ++dr )
+        for( int dc = -r-1; dc <= r+1; ++dc )
+        {
+            const Location offset( dr, dc );
+            if( inView( offset, m_view_radius ) )
+            {
+                m_view_stencil.push_back( offset );
+                for( int d = 0; d < NONE; ++d )
+                {
+                    const int* step = DIRECTION_OFFSET[ d ];
+                    if( !inView( Location( dr+step[0], dc+step[1] ), m_view_radius ) )
+                        m_view_enter[ d ].push_back( offset );
+                    if( !inView( Location( dr-step[0], dc-step[1] ), m_view_radius ) )
+                        m_view_leave[ d ].push_back( offset );
+                }
+                continue;
+            }
+
+            for( int d = 0; d < NONE; ++d )
+                if( inView( Location( dr+DIRECTION_OFFSET[d][0], dc+DIRECTION_OFFSET[d][1] ), m_view_radius ) )
+                {
+                    m_view_ring.push_back( offset );
+                    break;
+                }
+        }
+
+    const unsigned num_squares = m_rows*m_cols;
+    m_vision_counts.assign( num_squares, 0u );
+    m_visible_bits.assign( ( num_squares+63 ) / 64, 0u );
+    m_frontier_bits.assign( ( num_squares+63 ) / 64, 0u );
 }
 
 
@@ -53,7 +107,7 @@ void State::makeMove( Ant* ant, Direction direction )
 {
     if( direction == NONE )
     {
-        m_my_prev_ants[ ant->location ] = ant;
+        rememberAnt( ant->location, ant );
         Debug::stream() << " setting my_prev_ants[ " << ant->location << "] to " << *ant << std::endl;
         return;
     }
@@ -62,7 +116,7 @@ void State::makeMove( Ant* ant, Direction direction )
     m_map.makeMove( ant->location, direction );
     
     Location new_loc = m_map.getLocation( ant->location, direction );
-    m_my_prev_ants[ new_loc ] = ant;
+    rememberAnt( new_loc, ant );
     ant->location = new_loc;
     
     Debug::stream() << " setting my_prev_ants[ " << new_loc << "] to " << *ant << std::endl;
@@ -74,7 +128,7 @@ void State::makeMove( Ant* ant, const Location& loc )
     Direction dir = m_map.getDirection( ant->location, loc );
     if( dir == NONE )
     {
-        m_my_prev_ants[ ant->location ] = ant;
+        rememberAnt( ant->location, ant );
         Debug::stream() << " setting my_prev_ants[ " << ant->location << "] to " << *ant << std::endl;
         return;
     }
@@ -82,67 +136,137 @@ void State::makeMove( Ant* ant, const Location& loc )
     cout << "o " << ant->location.row << " " << ant->location.col << " " << DIRECTION_CHAR[dir] << endl;
     m_map.makeMove( ant->location, loc );
 
-    m_my_prev_ants[ loc ] = ant;
+    rememberAnt( loc, ant );
     ant->location = loc;
     
     Debug::stream() << " setting my_prev_ants[ " << loc << "] to " << *ant << std::endl;
 }
 
 
-void State::updateVisionInformation()
+void State::rememberAnt( const Location& loc, Ant* ant )
 {
-    // This function will update update the lastSeen value for any squares currently
-    // visible by one of your live ants.
+    // Ants ordered onto the same square collide, so the one already there
+    // will not be seen again.  Its view would otherwise stay counted.
+    Ant*& prev_ant = m_my_prev_ants[ loc ];
+    if( prev_ant && prev_ant != ant )
+        removeVision( prev_ant );
+    prev_ant = ant;
+}
 
-    // BE VERY CAREFUL IF YOU ARE GOING TO TRY AND MAKE THIS FUNCTION MORE EFFICIENT,
-    // THE OBVIOUS WAY OF TRYING TO IMPROVE IT BREAKS USING THE EUCLIDEAN METRIC, FOR
-    // A CORRECT MORE EFFICIENT IMPLEMENTATION, TAKE A LOOK AT THE GET_VISION FUNCTION
-    // IN ANTS.PY ON THE CONTESTS GITHUB PAGE.
-    
-    std::queue<Location> locQueue;
-    Location sLoc, cLoc, nLoc;
 
-    for(int a=0; a<(int) m_my_ants.size(); a++)
+void State::updateVisionInformation()
+{
+    // The view is a disc in the euclidean metric, see get_vision in ants.py.
+    // Each square counts the ants seeing it.  An ant that stepped since the
+    // last turn only moves the edges of its view in and out of the counts.
+    std::vector<Ant*> moved;
+    for( Ants::iterator it = m_my_ants.begin(); it != m_my_ants.end(); ++it )
     {
-        sLoc = m_my_ants[a]->location;
-        locQueue.push(sLoc);
+        Ant* ant = *it;
+        if( ant->has_vision && ant->vision == ant->location ) continue;
 
-        std::vector<std::vector<bool> > visited( m_rows, std::vector<bool>(m_cols, 0));
-        m_map( sLoc ).setVisible();
-        visited[sLoc.row][sLoc.col] = 1;
+        int step = NONE;
+        if( ant->has_vision )
+            for( int d = 0; d < NONE; ++d )
+                if( m_map.getLocation( ant->vision, static_cast<Direction>( d ) ) == ant->location )
+                    step = d;
 
-        while(!locQueue.empty())
+        if( step != NONE )
+        {
+            removeVision( ant->vision, m_view_leave[ step ] );
+            addVision( ant->location, m_view_enter[ step ] );
+        }
+        else
         {
-            cLoc = locQueue.front();
-            locQueue.pop();
+            removeVision( ant );
+            addVision( ant->location, m_view_stencil );
+        }
+        ant->has_vision = true;
+        ant->vision     = ant->location;
+        moved.push_back( ant );
+    }
 
-            for( int d = 0; d< NUM_DIRECTIONS; ++d )
-            {
-                nLoc = m_map.getLocation( cLoc, static_cast<Direction>( d ) );
+    // Squares seen this turn are known, so only the rings of moved views
+    // can add to the frontier
+    for( std::vector<Ant*>::iterator it = moved.begin(); it != moved.end(); ++it )
+        updateFrontier( ( *it )->location );
 
-                if(!visited[nLoc.row][nLoc.col] )
-                {
-                    if( m_map.distance(sLoc, nLoc) <= m_view_radius )
-                    {
-                        m_map( nLoc ).setVisible();
-                        locQueue.push(nLoc);
-                        m_frontier.erase( nLoc );
-                    }
-                    else
-                    {
-                        if( m_map( nLoc ).isUnknown() )
-                        {
-                            m_frontier.insert( nLoc );
-                        }
-                    }
-                }
-                visited[nLoc.row][nLoc.col] = 1;
-            }
+    // Map::reset cleared the visible flags
+    m_frontier.clear();
+    for( unsigned w = 0; w < m_visible_bits.size(); ++w )
+    {
+        for( uint64_t bits = m_visible_bits[ w ]; bits; bits &= bits-1 )
+        {
+            const unsigned i = w*64 + __builtin_ctzll( bits );
+            m_map( i / m_cols, i % m_cols ).setVisible();
+        }
+        for( uint64_t bits = m_frontier_bits[ w ]; bits; bits &= bits-1 )
+        {
+            const unsigned i = w*64 + __builtin_ctzll( bits );
+            m_frontier.push_back( Location( i / m_cols, i % m_cols ) );
+        }
+    }
+}
+
+
+void State::addVision( const Location& center, const Locations& stencil )
+{
+    for( Locations::const_iterator it = stencil.begin(); it != stencil.end(); ++it )
+    {
+        const unsigned i = index( wrap( center, *it ) );
+        if( m_vision_counts[ i ]++ == 0u )
+        {
+            m_visible_bits [ i / 64 ] |=   uint64_t( 1 ) << ( i % 64 );
+            m_frontier_bits[ i / 64 ] &= ~( uint64_t( 1 ) << ( i % 64 ) );
         }
     }
 }
 
 
+void State::removeVision( const Location& center, const Locations& stencil )
+{
+    for( Locations::const_iterator it = stencil.begin(); it != stencil.end(); ++it )
+    {
+        const unsigned i = index( wrap( center, *it ) );
+        assert( m_vision_counts[ i ] > 0u );
+        if( --m_vision_counts[ i ] == 0u )
+            m_visible_bits[ i / 64 ] &= ~( uint64_t( 1 ) << ( i % 64 ) );
+    }
+}
+
+
+void State::removeVision( Ant* ant )
+{
+    if( !ant->has_vision ) return;
+    removeVision( ant->vision, m_view_stencil );
+    ant->has_vision = false;
+}
+
+
+void State::updateFrontier( const Location& center )
+{
+    for( Locations::const_iterator it = m_view_ring.begin(); it != m_view_ring.end(); ++it )
+    {
+        const Location loc = wrap( center, *it );
+        const unsigned i   = index( loc );
+        if( !( m_visible_bits[ i / 64 ] & ( uint64_t( 1 ) << ( i % 64 ) ) ) && m_map( loc ).isUnknown() )
+            m_frontier_bits[ i / 64 ] |= uint64_t( 1 ) << ( i % 64 );
+    }
+}
+
+
+Location State::wrap( const Location& center, const Location& offset )const
+{
+    int row = center.row + offset.row;
+    int col = center.col + offset.col;
+    while( row <  0      ) row += m_rows;
+    while( row >= m_rows ) row -= m_rows;
+    while( col <  0      ) col += m_cols;
+    while( col >= m_cols ) col -= m_cols;
+    return Location( row, col );
+}
+
+
 ostream& operator<<(ostream &os, const State &state)
 {
     os << "Game state:\n"
@@ -162,7 +286,7 @@ ostream& operator<<(ostream &os, const State &state)
     {
         for( int j = 0; j < state.m_cols; ++j )
         {
-            if( state.m_frontier.find( Location( i, j ) ) != state.m_frontier.end() )
+            if( std::find( state.m_frontier.begin(), state.m_frontier.end(), Location( i, j ) ) != state.m_frontier.end() )
                 os << "* ";
 
             else
@@ -327,6 +451,7 @@ istream& operator>>(istream &is, State &state)
     for( State::AntHash::iterator it = state.m_my_prev_ants.begin(); it != state.m_my_prev_ants.end(); ++it )
     {
         Debug::stream() << "deleting ant " << it->first << " -- " << it->second << std::endl;
+        state.removeVision( it->second );
         delete it->second;
     }
     state.m_my_prev_ants.clear();
@@ -37,6 +37,9 @@ public:
     void makeMove( Ant* ant, Direction direction);
     void makeMove( Ant* ant, const Location& location );
     
+    // Mark the squares seen by our ants visible and update the frontier
+    // of unknown squares just outside their view.  Only ants which moved
+    // since the last call are re-counted.
     void updateVisionInformation();
 
     Timer&                timer()                  { return m_timer;         }
@@ -49,7 +52,7 @@ public:
     const Locations&      myHills()const           { return m_my_hills;      }
     const Locations&      enemyHills()const        { return m_enemy_hills;   }
     const Locations&      food()const              { return m_food;          }
-    const LocationSet&    frontier()const          { return m_frontier;      }
+    const Locations&      frontier()const          { return m_frontier;      }
     int                   turn() const             { return m_turn;          }
 
     // Per game constants
@@ -64,6 +67,21 @@ public:
     friend std::ostream& operator<<(std::ostream &os, const State &state);
     friend std::istream& operator>>(std::istream &is, State &state);
 private:
+    typedef std::vector<uint64_t> Bitset;
+
+    // Count an ants view in or out of m_vision_counts.  Keeps the visible
+    // and frontier bits in step.
+    void addVision( const Location& center, const Locations& stencil );
+    void removeVision( const Location& center, const Locations& stencil );
+    void removeVision( Ant* ant );
+
+    void updateFrontier( const Location& center );
+
+    // Record ant as standing on loc next turn
+    void rememberAnt( const Location& loc, Ant* ant );
+
+    Location wrap( const Location& center, const Location& offset )const;
+    unsigned index( const Location& loc )const { return loc.row*m_cols + loc.col; }
 
     int                       m_rows;
     int                       m_cols;
@@ -87,7 +105,15 @@ private:
     Locations                 m_my_hills;
     Locations                 m_enemy_hills;
     Locations                 m_food;
-    LocationSet               m_frontier;
+    Locations                 m_frontier;
+
+    Locations                 m_view_stencil;          ///< Offsets within view
+    Locations                 m_view_ring;             ///< Offsets just outside view
+    Locations                 m_view_enter[ NONE ];    ///< View gained by a step
+    Locations                 m_view_leave[ NONE ];    ///< View lost by a step, from the old center
+    std::vector<uint16_t>     m_vision_counts;         ///< Ants seeing each square
+    Bitset                    m_visible_bits;
+    Bitset                    m_frontier_bits;
 
     //LocationSet               m_destinations;
 
@@ -0,0 +1,207 @@
+#include "LatencyHistogram.h"
+#include "State.h"
+#include "Timer.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <vector>
+
+//
+// Times State::updateVisionInformation for 50, 200 and 1000 ants wandering
+// a 200x200 map, fed through State's input parser the way Bot does, against
+// the per ant flood fill it replaced.  Every turn the visible squares and
+// the frontier are checked to match the flood fill's.
+//
+// Usage: visionbench [turns, default 100]
+//
+
+namespace
+{
+
+const int SIZE       = 200;
+const int NUM_COUNTS = 3;
+const int ANT_COUNTS[ NUM_COUNTS ] = { 50, 200, 1000 };
+
+
+//
+// The original flood fill from every ant, keeping its own record of which
+// squares are known.  The original left an ant's own square on the
+// frontier if an earlier ant's flood put it there; this one erases it.
+//
+class FloodFillVision
+{
+public:
+    FloodFillVision( const Map& map, float view_radius )
+        : m_map( map ),
+          m_view_radius( view_radius ),
+          m_known( map.height()*map.width(), false ),
+          m_visible( map.height()*map.width(), false )
+    {}
+
+    void update( const std::vector<Location>& ants )
+    {
+        const int rows = m_map.height();
+        const int cols = m_map.width();
+        std::fill( m_visible.begin(), m_visible.end(), false );
+
+        std::queue<Location> locQueue;
+        Location sLoc, cLoc, nLoc;
+        for( unsigned a = 0; a < ants.size(); ++a )
+        {
+            sLoc = ants[ a ];
+            locQueue.push( sLoc );
+
+            std::vector<std::vector<bool> > visited( rows, std::vector<bool>( cols, 0 ) );
+            setVisible( sLoc );
+            m_frontier.erase( sLoc );
+            visited[ sLoc.row ][ sLoc.col ] = 1;
+
+            while( !locQueue.empty() )
+            {
+                cLoc = locQueue.front();
+                locQueue.pop();
+
+                for( int d = 0; d < NUM_DIRECTIONS; ++d )
+                {
+                    nLoc = m_map.getLocation( cLoc, static_cast<Direction>( d ) );
+                    if( !visited[ nLoc.row ][ nLoc.col ] )
+                    {
+                        if( m_map.distance( sLoc, nLoc ) <= m_view_radius )
+                        {
+                            setVisible( nLoc );
+                            locQueue.push( nLoc );
+                            m_frontier.erase( nLoc );
+                        }
+                        else if( !m_known[ nLoc.row*cols + nLoc.col ] )
+                        {
+                            m_frontier.insert( nLoc );
+                        }
+                    }
+                    visited[ nLoc.row ][ nLoc.col ] = 1;
+                }
+            }
+        }
+    }
+
+    bool visible( const Location& loc )const           { return m_visible[ loc.row*m_map.width() + loc.col ]; }
+    const std::set<Location>& frontier()const          { return m_frontier; }
+
+private:
+    void setVisible( const Location& loc )
+    {
+        m_visible[ loc.row*m_map.width() + loc.col ] = true;
+        m_known  [ loc.row*m_map.width() + loc.col ] = true;
+    }
+
+    const Map&          m_map;
+    float               m_view_radius;
+    std::vector<bool>   m_known;
+    std::vector<bool>   m_visible;
+    std::set<Location>  m_frontier;
+};
+
+
+bool matches( const State& state, const FloodFillVision& reference )
+{
+    for( int i = 0; i < state.rows(); ++i )
+        for( int j = 0; j < state.cols(); ++j )
+            if( state.map()( i, j ).visible != reference.visible( Location( i, j ) ) )
+                return false;
+
+    return state.frontier().size() == reference.frontier().size() &&
+           std::equal( state.frontier().begin(), state.frontier().end(), reference.frontier().begin() );
+}
+
+
+/// Step each ant in a random direction unless the square is taken.  Orders
+/// State writes to cout are discarded.
+void moveAnts( State& state )
+{
+    std::ostringstream orders;
+    std::streambuf* cout_buf = std::cout.rdbuf( orders.rdbuf() );
+    for( State::Ants::iterator it = state.myAnts().begin(); it != state.myAnts().end(); ++it )
+    {
+        Direction dir     = static_cast<Direction>( rand() % NUM_DIRECTIONS );
+        const Square to   = state.map()( state.map().getLocation( ( *it )->location, dir ) );
+        if( dir != NONE && ( to.ant_id >= 0 || to.new_ant_id >= 0 ) )
+            dir = NONE;
+        state.makeMove( *it, dir );
+    }
+    std::cout.rdbuf( cout_buf );
+}
+
+
+bool run( int num_ants, int turns )
+{
+    std::ostringstream params;
+    params << "turn 0\nloadtime 3000\nturntime 1000\nrows " << SIZE << "\ncols " << SIZE
+           << "\nturns 1000\nviewradius2 77\nattackradius2 5\nspawnradius2 1\nplayer_seed 7\nready\n";
+    std::istringstream params_in( params.str() );
+
+    State state;
+    params_in >> state;
+    state.setup();
+
+    std::set<Location> start;
+    while( static_cast<int>( start.size() ) < num_ants )
+        start.insert( Location( rand() % SIZE, rand() % SIZE ) );
+    std::vector<Location> ants( start.begin(), start.end() );
+
+    FloodFillVision  reference( state.map(), state.viewRadius() );
+    LatencyHistogram incremental_times( "incremental" );
+    LatencyHistogram flood_fill_times( "flood fill" );
+    Timer            timer;
+    bool             ok = true;
+    for( int turn = 1; turn <= turns; ++turn )
+    {
+        std::ostringstream input;
+        input << "turn " << turn << "\n";
+        for( std::vector<Location>::iterator it = ants.begin(); it != ants.end(); ++it )
+            input << "a " << it->row << " " << it->col << " 0\n";
+        input << "go\n";
+        std::istringstream turn_in( input.str() );
+        state.reset();
+        turn_in >> state;
+
+        timer.start();
+        state.updateVisionInformation();
+        incremental_times.record( timer.getTime()*1.0e-3 );
+
+        timer.start();
+        reference.update( ants );
+        flood_fill_times.record( timer.getTime()*1.0e-3 );
+
+        ok = ok && matches( state, reference );
+
+        moveAnts( state );
+        ants.clear();
+        for( State::Ants::const_iterator it = state.myAnts().begin(); it != state.myAnts().end(); ++it )
+            ants.push_back( ( *it )->location );
+    }
+
+    std::cout << std::setw( 5 ) << num_ants << " ants  "
+              << "incremental " << std::fixed << std::setprecision( 3 ) << std::setw( 8 )
+              << incremental_times.getMean()*1.0e3 << " ms  "
+              << "flood fill " << std::setw( 8 ) << flood_fill_times.getMean()*1.0e3 << " ms  "
+              << "frontier " << std::setw( 5 ) << state.frontier().size()
+              << ( ok ? "  match" : "  MISMATCH" ) << std::endl;
+    return ok;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const int turns = argc > 1 ? atoi( argv[1] ) : 100;
+
+    srand( 1234 );
+    bool ok = true;
+    for( int i = 0; i < NUM_COUNTS; ++i )
+        ok = run( ANT_COUNTS[ i ], turns ) && ok;
+    return ok ? 0 : 1;
+}
@@ -415,8 +415,11 @@ namespace
 MCTSAI::MCTSAI()
     : AI(),
       m_root( 0 ),
-      m_time_budget( 0.75 ) // seconds
+      m_time_budget( 0.75 ), // seconds
+      m_budget( m_time_budget ),
+      m_move_times( "MCTSAI move", m_time_budget )
 {
+    m_move_times.printAtExit();
 }
 
 
@@ -433,6 +436,9 @@ MCTSAI::~MCTSAI()
 
 void MCTSAI::doGetMove( Move& move )
 {
+    AutoTimerRef<LatencyHistogram> move_timer( m_move_times );
+    Deadline deadline = m_budget.start();
+
     // If this is our first move, we need to create root node
     if( !m_root )
     {
@@ -458,14 +464,10 @@ void MCTSAI::doGetMove( Move& move )
     for( int i = 0; i < NUM_GRID_CELLS; ++i )
         expansion_seeds[i] = i;
 
-    Timer timer;
-    timer.start();
-    
     unsigned iter_count = 0u;
     unsigned max_depth = 0u;
 
-    //while( timer.getTimeElapsed() < m_time_budget )
-    while( iter_count < 5000 )
+    while( !deadline.expired() )
     {
         iter_count++;
         LDEBUG << " Iteration: " << iter_count << std::endl;
@@ -595,6 +597,8 @@ void MCTSAI::doGetMove( Move& move )
     
     delete m_root;
     m_root = new_root;
+
+    m_budget.finish( deadline );
 }
 
 
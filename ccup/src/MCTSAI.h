@@ -27,6 +27,8 @@
 
 #include "AI.h"
 #include "Board.h"
+#include "Deadline.h"
+#include "LatencyHistogram.h"
 
 //------------------------------------------------------------------------------
 //
@@ -47,8 +49,10 @@ protected:
     void doGetMove( Move& move );
     void updateTreeWithOppMove( const Move& move );
 
-    Node*  m_root;
-    double m_time_budget;
+    Node*            m_root;
+    double           m_time_budget;
+    Budget           m_budget;
+    LatencyHistogram m_move_times;
 };
 
 
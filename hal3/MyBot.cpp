@@ -1,9 +1,12 @@
 #include "hlt/game.hpp"
 #include "hlt/constants.hpp"
 #include "hlt/log.hpp"
+#include "LatencyHistogram.h"
 
+#include <chrono>
 #include <random>
 #include <ctime>
+#include <sstream>
 
 using namespace std;
 using namespace hlt;
@@ -25,8 +28,13 @@ int main(int argc, char* argv[]) {
 
     log::log("Successfully created bot! My Player ID is " + to_string(game.my_id) + ". Bot rng seed is " + to_string(rng_seed) + ".");
 
+    // Turn time from reading the frame to sending commands, against the
+    // 2 second limit
+    LatencyHistogram turn_times("turn", 2.0);
+
     for (;;) {
         game.update_frame();
+        const auto turn_start = chrono::steady_clock::now();
         shared_ptr<Player> me = game.me;
         unique_ptr<GameMap>& game_map = game.game_map;
 
@@ -50,6 +58,15 @@ int main(int argc, char* argv[]) {
             command_queue.push_back(me->shipyard->spawn());
         }
 
+        turn_times.record(chrono::duration<double>(chrono::steady_clock::now() - turn_start).count());
+
+        // The engine kills the bot after the last turn, so report before it
+        if (game.turn_number == constants::MAX_TURNS) {
+            ostringstream turn_report;
+            turn_times.print(turn_report);
+            log::log(turn_report.str());
+        }
+
         if (!game.end_turn(command_queue)) {
             break;
         }
@@ -0,0 +1,216 @@
+#ifndef KLIB_ASTAR_BATCH_H_
+#define KLIB_ASTAR_BATCH_H_
+
+//
+// Solves batches of independent A* queries against a shared graph on a pool
+// of worker threads.  See AStar.h for the Graph requirements.
+//
+// Each worker owns an AStarContext which is reused across queries and
+// batches, so a warmed up AStarBatch does not allocate beyond the returned
+// paths.  The calling thread acts as one of the workers.
+//
+// Usage:
+//   AStarBatch<Graph> batch( graph, num_threads );
+//   AStarBatch<Graph>::QueryVec queries;
+//   queries.push_back( std::make_pair( origin, destination ) );
+//   ...
+//   AStarBatch<Graph>::PathVec paths;
+//   batch.solve( queries, paths );   // paths[i] answers queries[i]
+//
+// Graph
+//     - The const Graph interface is called concurrently from all workers
+//       and must be safe for that
+//     - Logging in the search should be disabled (KLOG_MAX_LEVEL below DEBUG)
+//       since Log writes to a shared stream
+//
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AStarContext.h"
+
+
+template <typename Graph>
+class AStarBatch
+{
+public:
+    typedef typename Graph::Node                    GraphNode;
+    typedef std::vector<GraphNode>                  GraphNodeVec;
+    typedef std::pair<GraphNode, GraphNode>         Query;  ///< origin, dest
+    typedef std::vector<Query>                      QueryVec;
+    typedef std::vector<GraphNodeVec>               PathVec;
+
+    /// num_threads of 0 uses one thread per hardware thread
+    explicit AStarBatch( const Graph& graph,
+                         unsigned     num_threads = 0,
+                         unsigned     max_depth   = AStarContext<Graph>::NO_MAX_DEPTH );
+
+    ~AStarBatch();
+
+    unsigned getNumThreads()const  { return m_contexts.size(); }
+
+    /// Solve all queries.  paths is resized to queries.size() and paths[i]
+    /// receives the path for queries[i] in AStarContext::getPath() form.  An
+    /// empty path means no path was found or origin == destination; pass
+    /// found to distinguish the two (found[i] is non-zero on success).
+    void solve( const QueryVec&    queries,
+                PathVec&           paths,
+                std::vector<char>* found = 0 );
+
+private:
+    //
+    // Uncopyable
+    //
+    AStarBatch( const AStarBatch& );
+    AStarBatch& operator=( const AStarBatch& );
+
+    typedef AStarContext<Graph> Context;
+
+    void workerLoop( unsigned worker );
+    void process( Context& context );
+
+
+    std::vector<Context*>    m_contexts;    ///< One per worker, [0] is caller
+    std::vector<std::thread> m_threads;
+
+    std::mutex               m_mutex;
+    std::condition_variable  m_work_cv;     ///< Signals a new batch or exit
+    std::condition_variable  m_done_cv;     ///< Signals a worker finished
+    unsigned                 m_batch_id;
+    unsigned                 m_num_busy;
+    bool                     m_exit;
+
+    // Current batch
+    const QueryVec*          m_queries;
+    PathVec*                 m_paths;
+    std::vector<char>*       m_found;
+    std::atomic<unsigned>    m_next_query;
+};
+
+
+template <typename Graph>
+AStarBatch<Graph>::AStarBatch( const Graph& graph,
+                               unsigned     num_threads,
+                               unsigned     max_depth )
+    : m_batch_id( 0 ),
+      m_num_busy( 0 ),
+      m_exit( false ),
+      m_queries( 0 ),
+      m_paths( 0 ),
+      m_found( 0 ),
+      m_next_query( 0 )
+{
+    if( num_threads == 0 )
+        num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    for( unsigned i = 0; i < num_threads; ++i )
+        m_contexts.push_back( new Context( graph, max_depth ) );
+
+    for( unsigned i = 1; i < num_threads; ++i )
+        m_threads.push_back( std::thread( &AStarBatch::workerLoop, this, i ) );
+}
+
+
+template <typename Graph>
+AStarBatch<Graph>::~AStarBatch()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_exit = true;
+    }
+    m_work_cv.notify_all();
+
+    for( unsigned i = 0; i < m_threads.size(); ++i )
+        m_threads[ i ].join();
+
+    for( unsigned i = 0; i < m_contexts.size(); ++i )
+        delete m_contexts[ i ];
+}
+
+
+template <typename Graph>
+void AStarBatch<Graph>::solve( const QueryVec&    queries,
+                               PathVec&           paths,
+                               std::vector<char>* found )
+{
+    paths.resize( queries.size() );
+    if( found )
+        found->resize( queries.size() );
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_queries    = &queries;
+        m_paths      = &paths;
+        m_found      = found;
+        m_next_query = 0;
+        m_num_busy   = m_threads.size();
+        ++m_batch_id;
+    }
+    m_work_cv.notify_all();
+
+    process( *m_contexts[ 0 ] );
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+    while( m_num_busy != 0 )
+        m_done_cv.wait( lock );
+
+    m_queries = 0;
+    m_paths   = 0;
+    m_found   = 0;
+}
+
+
+template <typename Graph>
+void AStarBatch<Graph>::workerLoop( unsigned worker )
+{
+    unsigned batch_id = 0;
+    for( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            while( !m_exit && m_batch_id == batch_id )
+                m_work_cv.wait( lock );
+            if( m_exit )
+                return;
+            batch_id = m_batch_id;
+        }
+
+        process( *m_contexts[ worker ] );
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            --m_num_busy;
+        }
+        m_done_cv.notify_one();
+    }
+}
+
+
+template <typename Graph>
+void AStarBatch<Graph>::process( Context& context )
+{
+    const QueryVec& queries = *m_queries;
+    const unsigned  num_queries = queries.size();
+
+    for( unsigned i = m_next_query++; i < num_queries; i = m_next_query++ )
+    {
+        GraphNodeVec& path = ( *m_paths )[ i ];
+        path.clear();
+
+        const bool success = context.search( queries[ i ].first,
+                                             queries[ i ].second );
+        if( success )
+            context.getPath( path );
+        if( m_found )
+            ( *m_found )[ i ] = success;
+    }
+}
+
+
+#endif // KLIB_ASTAR_BATCH_H_
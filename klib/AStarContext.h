@@ -0,0 +1,562 @@
+#ifndef KLIB_ASTAR_CONTEXT_H_
+#define KLIB_ASTAR_CONTEXT_H_
+
+//
+// Reusable A* search engine.  See AStar.h for the Graph requirements.
+//
+// An AStarContext may run any number of searches against the same graph.
+// The node store, open heap and neighbor scratch space are kept between
+// searches, so once the context has seen its largest search it runs further
+// queries without touching the allocator.
+//
+// Usage:
+//   AStarContext<Graph> context( graph );
+//   for( ... )
+//   {
+//       if( context.search( origin, destination ) )
+//       {
+//           path.clear();
+//           context.getPath( path );
+//       }
+//   }
+//
+// Results (getPath, getNumSteps, ...) refer to the most recent search and
+// are invalidated by the next one.  A context must not be shared between
+// threads; use one context per thread.
+//
+// Search modes:
+//   - search() is plain A*, or weighted A* when setHeuristicWeight() is given
+//     an epsilon > 1: nodes are ordered by g + epsilon*h, which expands far
+//     fewer nodes on long routes at the price of paths up to epsilon times
+//     the optimal cost
+//   - searchBidirectional() runs A* from both ends and stops once the best
+//     meeting point can no longer be improved.  Optimal for epsilon == 1
+//     given a consistent heuristic.  The graph must be undirected in the
+//     sense that m is a neighbor of n iff n is a neighbor of m; the backward
+//     search charges getCost( neighbor, node ) for each edge it walks
+//
+
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include "GraphNodeStore.h"
+#include "IndexedHeap.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+
+template <typename Graph>
+class AStarContext
+{
+public:
+    typedef typename Graph::Node       GraphNode;
+    typedef std::vector<GraphNode>     GraphNodeVec;
+
+    static const unsigned NO_MAX_DEPTH = ~0u;
+
+    explicit AStarContext( const Graph& graph,
+                           unsigned     max_depth = NO_MAX_DEPTH );
+
+    ~AStarContext();
+
+    /// Limit on path cost explored by subsequent searches
+    void setMaxDepth( unsigned max_depth ) { m_max_depth = max_depth; }
+
+    /// Heuristic weight epsilon >= 1 for subsequent searches
+    void  setHeuristicWeight( float epsilon );
+    float getHeuristicWeight()const        { return m_weight; }
+
+    /// Find a path from origin to destination.  Returns false if none exists
+    /// within max_depth.
+    bool search( const GraphNode& origin, const GraphNode& destination );
+
+    /// Find a path to destination from the nearest of several origins
+    template <typename Iter>
+    bool search( Iter             origins_begin,
+                 Iter             origins_end,
+                 const GraphNode& destination );
+
+    /// Find a path from origin to destination searching from both ends
+    bool searchBidirectional( const GraphNode& origin,
+                              const GraphNode& destination );
+
+    /// Append path from the origin (exclusive) to the destination (inclusive)
+    void getPath ( GraphNodeVec& path )const;
+
+    /// Cost of the path found by the last successful search
+    float getPathCost()const { return m_path_cost; }
+
+    /// Number of nodes expanded by the last search
+    int getNumSteps()const   { return m_steps;   }
+
+    /// Number of decrease-key operations on open nodes by the last search
+    int getNumUpdates()const { return m_updates; }
+
+private:
+    //
+    // Uncopyable
+    //
+    AStarContext( const AStarContext& );
+    AStarContext& operator=( const AStarContext& );
+
+    enum Direction
+    {
+        FORWARD=0,      // from origin, g is cost from origin
+        BACKWARD        // from destination, g is cost to destination
+    };
+
+    //
+    // A candidate node in the search.
+    //
+    struct Node
+    {
+        Node()
+            : g( 0.0f ),
+              h( 0.0f ),
+              f( 0.0f ),
+              prev( 0 ),
+              id( 0 ),
+              heap_index( ~0u )
+        {
+        }
+
+        Node( const GraphNode& graph_node,
+              float g,
+              float h,
+              float f,
+              Node* prev,
+              int id )
+            : graph_node( graph_node ),
+              g( g ),
+              h( h ),
+              f( f ),
+              prev( prev ),
+              id( id ),
+              heap_index( ~0u )
+        {
+        }
+
+        GraphNode graph_node;
+        float g;
+        float h;              ///< Unweighted heuristic
+        float f;              ///< Priority: g + weight*h
+        Node* prev;
+        int id;
+        unsigned heap_index;  ///< Position in open heap, owned by IndexedHeap
+    };
+
+
+    /// For heap sorting our open set
+    struct HeapCompare
+    {
+        bool operator()( const Node* n0, const Node* n1 )const
+        {
+            return ( n0->f >  n1->f ) ||
+                   ( n0->f == n1->f && n0->h > n1->h );
+            //return ( n0->f >  n1->f ) ||
+            //       ( n0->f == n1->f && n0->id < n1->id );
+            //return n0->f >  n1->f;
+        }
+    };
+
+
+    typedef IndexedHeap<Node, HeapCompare>                  NodeHeap;
+    typedef typename NodeStoreSelector<Graph, Node>::Type   NodeStore;
+
+    /// Open heap and node records for one search direction
+    struct Frontier
+    {
+        explicit Frontier( const Graph& graph ) : nodes( graph ) {}
+
+        void clear()
+        {
+            // Heap first: clearing it touches the records owned by the store
+            open.clear();
+            nodes.clear();
+        }
+
+        NodeHeap  open;    ///< Candidate nodes, addressable
+        NodeStore nodes;   ///< All visited nodes, open or closed
+    };
+
+
+    void reset( const GraphNode& origin, const GraphNode& destination );
+    void pushOrigin( Frontier& frontier, Direction dir, const GraphNode& node );
+    bool run();
+    bool runBidirectional();
+
+    float heuristic( Direction dir, const GraphNode& node )const;
+
+    Node* pushNode( Frontier& frontier,
+                    const GraphNode& graph_node,
+                    float g,
+                    float h,
+                    Node* prev);
+    Node* popNode( Frontier& frontier );
+
+    bool step();
+    void expand( Frontier& frontier, Direction dir, Node* current );
+    void checkMeeting( Direction dir, Node* node );
+
+
+    Frontier              m_forward;
+    Frontier*             m_backward;    ///< Created on first bidirectional use
+    bool                  m_bidirectional;
+
+    GraphNodeVec          m_neighbors;
+
+    const Graph&          m_graph;       ///< Map to be searched
+    GraphNode             m_origin;      ///< Start location (bidirectional)
+    GraphNode             m_destination; ///< Goal location
+
+    unsigned              m_max_depth;   ///< Max depth on each search
+    float                 m_weight;      ///< Heuristic weight epsilon
+
+    Node*                 m_destination_node;  ///< Forward end of the path
+    Node*                 m_meeting_node;      ///< Backward half, if any
+    float                 m_path_cost;
+
+    int                   m_steps;
+    int                   m_updates;
+};
+
+
+
+template <typename Graph>
+AStarContext<Graph>::AStarContext( const Graph& graph, unsigned max_depth )
+    : m_forward( graph ),
+      m_backward( 0 ),
+      m_bidirectional( false ),
+      m_graph( graph),
+      m_max_depth( max_depth ),
+      m_weight( 1.0f ),
+      m_destination_node( 0 ),
+      m_meeting_node( 0 ),
+      m_path_cost( 0.0f ),
+      m_steps( 0 ),
+      m_updates( 0 )
+{
+}
+
+
+template <typename Graph>
+AStarContext<Graph>::~AStarContext()
+{
+    delete m_backward;
+}
+
+
+template <typename Graph>
+void AStarContext<Graph>::setHeuristicWeight( float epsilon )
+{
+    assert( epsilon >= 1.0f );
+    m_weight = epsilon;
+}
+
+
+template <typename Graph>
+bool AStarContext<Graph>::search( const GraphNode& origin,
+                                  const GraphNode& destination )
+{
+    KPROFILE_SCOPE( "AStarContext::search" );
+    reset( origin, destination );
+    pushOrigin( m_forward, FORWARD, origin );
+    return run();
+}
+
+
+template <typename Graph>
+template <typename Iter>
+bool AStarContext<Graph>::search( Iter             origins_begin,
+                                  Iter             origins_end,
+                                  const GraphNode& destination )
+{
+    KPROFILE_SCOPE( "AStarContext::search" );
+    reset( destination, destination );
+    for( Iter it = origins_begin; it != origins_end; ++it )
+        pushOrigin( m_forward, FORWARD, *it );
+    return run();
+}
+
+
+template <typename Graph>
+bool AStarContext<Graph>::searchBidirectional( const GraphNode& origin,
+                                               const GraphNode& destination )
+{
+    KPROFILE_SCOPE( "AStarContext::searchBidirectional" );
+    if( !m_backward )
+        m_backward = new Frontier( m_graph );
+
+    reset( origin, destination );
+    m_bidirectional = true;
+    m_backward->clear();
+
+    pushOrigin( m_forward, FORWARD, origin );
+    if( origin == destination )
+    {
+        m_destination_node = popNode( m_forward );
+        m_path_cost        = m_destination_node->g;
+        return true;
+    }
+    pushOrigin( *m_backward, BACKWARD, destination );
+
+    return runBidirectional();
+}
+
+
+template <typename Graph>
+void AStarContext<Graph>::reset( const GraphNode& origin,
+                                 const GraphNode& destination )
+{
+    m_forward.clear();
+    m_bidirectional = false;
+
+    m_origin           = origin;
+    m_destination      = destination;
+    m_destination_node = 0;
+    m_meeting_node     = 0;
+    m_path_cost        = std::numeric_limits<float>::max();
+    m_steps            = 0;
+    m_updates          = 0;
+}
+
+
+template <typename Graph>
+void AStarContext<Graph>::pushOrigin( Frontier&        frontier,
+                                      Direction        dir,
+                                      const GraphNode& node )
+{
+    if( frontier.nodes.find( node ) )
+        return;
+
+    const float g = 0.0f;
+    const float h = heuristic( dir, node );
+    pushNode( frontier, node, g, h, 0 );
+}
+
+
+template <typename Graph>
+float AStarContext<Graph>::heuristic( Direction dir, const GraphNode& node )const
+{
+    return dir == FORWARD ? m_graph.getCostHeuristic( node, m_destination ) :
+                            m_graph.getCostHeuristic( m_origin, node );
+}
+
+
+template <typename Graph>
+bool AStarContext<Graph>::run()
+{
+    while( !m_forward.open.empty() )
+    {
+        if( step() )
+        {
+            m_path_cost = m_destination_node->g;
+            KLOG( Log::DEBUG ) << "FOUND GOAL.  Steps   : " << m_steps;
+            KLOG( Log::DEBUG ) << "             updates : " << m_updates;
+            KLOG( Log::DEBUG ) << "             path len: " << m_path_cost;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template <typename Graph>
+bool AStarContext<Graph>::runBidirectional()
+{
+    Frontier& backward = *m_backward;
+
+    while( !m_forward.open.empty() && !backward.open.empty() )
+    {
+        //
+        // Any cheaper path must pass through an open node on each side, and
+        // each side's top f is a lower bound on such a path
+        //
+        if( m_forward.open.top()->f >= m_path_cost ||
+            backward.open.top()->f  >= m_path_cost )
+            break;
+
+        // Expand the smaller frontier to keep the two balanced
+        m_steps++;
+        if( m_forward.open.size() <= backward.open.size() )
+            expand( m_forward, FORWARD, popNode( m_forward ) );
+        else
+            expand( backward, BACKWARD, popNode( backward ) );
+    }
+
+    if( !m_destination_node )
+        return false;
+
+    KLOG( Log::DEBUG ) << "MET IN MIDDLE.  Steps   : " << m_steps;
+    KLOG( Log::DEBUG ) << "                updates : " << m_updates;
+    KLOG( Log::DEBUG ) << "                path len: " << m_path_cost;
+    return true;
+}
+
+
+template <typename Graph>
+typename AStarContext<Graph>::Node*
+AStarContext<Graph>::pushNode( Frontier&        frontier,
+                               const GraphNode& graph_node,
+                               float            g,
+                               float            h,
+                               Node*            prev)
+{
+    Node* node = frontier.nodes.create(
+            graph_node,
+            Node( graph_node, g, h, g + m_weight*h, prev, frontier.nodes.size() ) );
+    frontier.open.push( node );
+
+    KLOG( Log::DEBUG3 ) << "pushing: " << node->graph_node;
+    KLOG( Log::DEBUG3 ) << "       : " << node->g;
+    KLOG( Log::DEBUG3 ) << "       : " << node->h;
+    KLOG( Log::DEBUG3 ) << "       : " << node->prev;
+    return node;
+}
+
+
+template <typename Graph>
+typename AStarContext<Graph>::Node*
+AStarContext<Graph>::popNode( Frontier& frontier )
+{
+    Node* current = frontier.open.pop();
+
+    KLOG( Log::DEBUG2 ) << "current: " << current->graph_node;
+    KLOG( Log::DEBUG2 ) << "         " << current->g;
+    KLOG( Log::DEBUG2 ) << "         " << current->h;
+    KLOG( Log::DEBUG2 ) << "         " << current->prev;
+    KLOG( Log::DEBUG2 ) << "         " << current;
+    return current;
+}
+
+
+template <typename Graph>
+bool AStarContext<Graph>::step()
+{
+    m_steps++;
+
+    Node* current = popNode( m_forward );
+
+    //
+    // Check to see if we have reached our destination
+    //
+    if( current->graph_node == m_destination )
+    {
+        m_destination_node = current;
+        return true;
+    }
+
+    expand( m_forward, FORWARD, current );
+
+    //
+    // Indicate the search is not finished
+    //
+    return false;
+}
+
+
+template <typename Graph>
+void AStarContext<Graph>::expand( Frontier& frontier,
+                                  Direction dir,
+                                  Node*     current )
+{
+    if( current->g + current->h >= m_max_depth )
+        return;
+
+    //
+    // Process neighbors
+    //
+    m_neighbors.clear();
+    m_graph.getNeighbors( current->graph_node, m_neighbors );
+
+    for( typename GraphNodeVec::iterator neighbor = m_neighbors.begin();
+         neighbor != m_neighbors.end();
+         ++neighbor )
+    {
+        const float cost = dir == FORWARD ?
+                           m_graph.getCost( current->graph_node, *neighbor ) :
+                           m_graph.getCost( *neighbor, current->graph_node );
+        float neighbor_g = current->g + cost;
+
+        //
+        // Search open and closed lists for this neighbor
+        //
+        Node* visited_node = frontier.nodes.find( *neighbor );
+        if( visited_node )
+        {
+            if( frontier.open.contains( visited_node ) &&
+                neighbor_g < visited_node->g )
+            {
+                // We found a better path to this location -- update heap
+                m_updates++;
+                visited_node->f   += neighbor_g - visited_node->g;
+                visited_node->g    = neighbor_g;
+                visited_node->prev = current;
+                frontier.open.update( visited_node );
+
+                if( m_bidirectional )
+                    checkMeeting( dir, visited_node );
+            }
+            continue;
+        }
+
+        //
+        // Add this neighbor to open list as a search candidate
+        //
+        float neighbor_h = heuristic( dir, *neighbor );
+        // Below check for h < m_max_depth assumes admissable heuristic
+        if( neighbor_h + neighbor_g < m_max_depth )
+        {
+            Node* node = pushNode( frontier, *neighbor, neighbor_g, neighbor_h, current );
+            if( m_bidirectional )
+                checkMeeting( dir, node );
+        }
+    }
+}
+
+
+template <typename Graph>
+void AStarContext<Graph>::checkMeeting( Direction dir, Node* node )
+{
+    Frontier& other = dir == FORWARD ? *m_backward : m_forward;
+    Node* other_node = other.nodes.find( node->graph_node );
+    if( !other_node || node->g + other_node->g >= m_path_cost )
+        return;
+
+    m_path_cost        = node->g + other_node->g;
+    m_destination_node = dir == FORWARD ? node : other_node;
+    m_meeting_node     = dir == FORWARD ? other_node : node;
+}
+
+
+template <typename Graph>
+void AStarContext<Graph>::getPath( GraphNodeVec& path )const
+{
+    if( !m_destination_node )
+        return;
+
+    //
+    // Forward half, walking back to the origin
+    //
+    const size_t begin = path.size();
+    for( Node* current = m_destination_node; current->prev != 0; current = current->prev )
+        path.push_back( current->graph_node );
+
+    std::reverse( path.begin() + begin, path.end() );
+
+    //
+    // Backward half, already ordered towards the destination.  The meeting
+    // node itself was emitted by the forward half.
+    //
+    if( m_meeting_node )
+    {
+        for( Node* current = m_meeting_node->prev; current != 0; current = current->prev )
+            path.push_back( current->graph_node );
+    }
+}
+
+
+#endif // KLIB_ASTAR_CONTEXT_H_
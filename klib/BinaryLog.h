@@ -0,0 +1,759 @@
+
+#ifndef KLIB_BINARY_LOG_H_
+#define KLIB_BINARY_LOG_H_
+
+//
+// Binary logging for hot paths, companion to Logger.h.  Rather than
+// formatting text, each event stores a call-site id, a raw cycle counter
+// reading and the argument bytes into a memory mapped file.  Formatting is
+// deferred to BinaryLog::decode() (the klog-decode tool), which renders
+// records in KLOG's text layout.
+//
+// Usage:
+//   - BinaryLog::open( "run.klog" ) maps the file.  Until then, and after
+//     close(), KLOG_BINARY is a cheap no-op
+//   - KLOG_BINARY( Log::DEBUG, "expanded {} nodes in {} ms", steps, ms );
+//     Each {} is replaced by the next argument, rendered as operator<< would.
+//     Arguments may be integers, bools, chars, floats, doubles, enums,
+//     pointers, C strings and std::strings
+//   - Compile-time and runtime level filtering is the same as KLOG's
+//   - Records which do not fit in the file are dropped and counted
+//
+// File layout, little endian:
+//   FileHeader, then records of RecordHeader + payload, each padded to 8
+//   bytes.  A record with site 0 defines a call site; its payload is the
+//   site id, indent and line (uint32 each) then NUL terminated level name,
+//   file, format and argument type codes.  Any other record is an event at
+//   that site, its payload the encoded arguments.  A zero length ends the
+//   file, which is how the decoder finds the end of a log whose process
+//   died before close().
+//
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#   include <x86intrin.h>
+#endif
+
+
+#define KLOG_BINARY( level, ... )                                              \
+    do                                                                         \
+    {                                                                          \
+        if( level > KLOG_MAX_LEVEL )                 ;                         \
+        else if( level > Log::getReportingLevel() )  ;                         \
+        else if( !BinaryLog::isOpen() )              ;                         \
+        else                                                                   \
+        {                                                                      \
+            static const uint32_t klog_site = BinaryLog::registerSite(         \
+                Log::toString( level ),                                        \
+                level > Log::INFO ? level - Log::INFO : 0,                     \
+                __FILE__, __LINE__, __VA_ARGS__ );                             \
+            BinaryLog::write( klog_site, __VA_ARGS__ );                        \
+        }                                                                      \
+    } while( 0 )
+
+
+//
+// Encoding of one argument type: a type code for the decoder, the encoded
+// size and the encoder.  Unsupported types fail to compile.
+//
+template <typename T, typename Enable = void>
+struct BinaryLogArg;
+
+
+class BinaryLog
+{
+public:
+    struct FileHeader
+    {
+        char     magic[8];            // "KLOGBIN"
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t ticks_start;         // Cycle counter at open()
+        int64_t  wall_start;          // Nanoseconds since the epoch at open()
+        double   ticks_per_second;    // Calibrated at open()
+        uint64_t ticks_end;           // Written by close(), zero before
+        int64_t  wall_end;
+        uint64_t size;                // Bytes used, written by close()
+    };
+
+    struct RecordHeader
+    {
+        uint32_t length;              // Including header and padding
+        uint32_t site;                // 0 for a site definition
+        uint64_t ticks;
+    };
+
+    /// Create path and map capacity bytes of it for records.  Returns false
+    /// if the file cannot be created or mapped.
+    static bool          open( const char* path, size_t capacity = 64u << 20 );
+
+    /// Record the end time, unmap and trim the file to the bytes used.  Must
+    /// not race with threads still logging.
+    static void          close();
+
+    static bool          isOpen();
+
+    /// Events which did not fit in the file
+    static unsigned long getNumDropped();
+
+    /// Render a log written by open()/close() in KLOG's text layout.
+    /// Returns false if the file cannot be read or is not a binary log.
+    static bool          decode( const char* path, std::ostream& out );
+
+    /// Cycle counter on x86, steady_clock nanoseconds elsewhere
+    static uint64_t      ticks();
+
+    //**************************************************************************
+    // INFO: Do not use this public interface directly: use KLOG_BINARY macro
+    template <typename... Args>
+    static uint32_t registerSite( const std::string& level_name, int indent,
+                                  const char* file, int line,
+                                  const char* format, const Args&... args );
+
+    template <typename... Args>
+    static void     write( uint32_t site, const char* format, const Args&... args );
+    //
+    //**************************************************************************
+
+private:
+    BinaryLog();
+
+    struct Site
+    {
+        std::string level_name;
+        uint32_t    indent;
+        std::string file;
+        uint32_t    line;
+        std::string format;
+        std::string types;
+    };
+
+    struct State
+    {
+        State() : open( false ), writers( 0 ), cursor( 0 ), dropped( 0 ),
+                  base( 0 ), capacity( 0 ), fd( -1 ) {}
+
+        std::atomic<bool>          open;
+        std::atomic<unsigned>      writers;     // writes in flight
+        std::atomic<size_t>        cursor;
+        std::atomic<unsigned long> dropped;
+        char*                      base;
+        size_t                     capacity;
+        int                        fd;
+
+        std::mutex                 mutex;       // guards sites and open/close
+        std::vector<Site>          sites;
+    };
+
+    static State& state();
+
+    static char*  reserve( State& s, size_t length );
+    static void   commit( char* record, uint32_t length, uint32_t site, uint64_t ticks );
+    static void   writeSite( State& s, uint32_t id );
+
+    static size_t padded( size_t length ) { return ( length + 7u ) & ~size_t( 7u ); }
+
+    template <typename T, typename... Rest>
+    static size_t argSize( const T& arg, const Rest&... rest );
+    static size_t argSize() { return 0; }
+
+    template <typename T, typename... Rest>
+    static char*  encode( char* p, const T& arg, const Rest&... rest );
+    static char*  encode( char* p ) { return p; }
+
+    static const char* renderArg( std::ostream& out, char type, const char* p, const char* end );
+    static void        renderEvent( std::ostream& out, const Site& site,
+                                    const char* p, const char* end );
+};
+
+
+//------------------------------------------------------------------------------
+//
+// Argument encodings
+//
+//------------------------------------------------------------------------------
+
+template <>
+struct BinaryLogArg<bool>
+{
+    static const char type = 'b';
+    static size_t size( bool )               { return 1; }
+    static char*  encode( char* p, bool v )  { *p = v ? 1 : 0; return p+1; }
+};
+
+
+template <typename T>
+struct BinaryLogArg<T, typename std::enable_if<
+    std::is_same<T, char>::value ||
+    std::is_same<T, signed char>::value ||
+    std::is_same<T, unsigned char>::value >::type>
+{
+    static const char type = 'c';
+    static size_t size( T )                  { return 1; }
+    static char*  encode( char* p, T v )     { *p = static_cast<char>( v ); return p+1; }
+};
+
+
+template <typename T>
+struct BinaryLogArg<T, typename std::enable_if<
+    ( std::is_integral<T>::value && sizeof( T ) > 1 ) || std::is_enum<T>::value >::type>
+{
+    static const bool is_signed = std::is_enum<T>::value || std::is_signed<T>::value;
+    static const char type = is_signed ? 'i' : 'u';
+    static size_t size( T )                  { return 8; }
+    static char*  encode( char* p, T v )
+    {
+        const uint64_t x = is_signed ? static_cast<uint64_t>( static_cast<int64_t>( v ) )
+                                     : static_cast<uint64_t>( v );
+        std::memcpy( p, &x, 8 );
+        return p+8;
+    }
+};
+
+
+template <typename T>
+struct BinaryLogArg<T, typename std::enable_if<
+    std::is_floating_point<T>::value >::type>
+{
+    // Floats are widened for output by operator<< too
+    static const char type = sizeof( T ) == sizeof( float ) ? 'f' : 'd';
+    static size_t size( T )                  { return type == 'f' ? 4 : 8; }
+    static char*  encode( char* p, T v )
+    {
+        if( type == 'f' )
+        {
+            const float x = static_cast<float>( v );
+            std::memcpy( p, &x, 4 );
+            return p+4;
+        }
+        const double x = static_cast<double>( v );
+        std::memcpy( p, &x, 8 );
+        return p+8;
+    }
+};
+
+
+/// Strings are a uint32 length and the characters
+template <typename T>
+struct BinaryLogArg<T, typename std::enable_if<
+    std::is_same<T, const char*>::value || std::is_same<T, char*>::value >::type>
+{
+    static const char type = 's';
+    static size_t size( const char* s )      { return 4 + std::strlen( s ); }
+    static char*  encode( char* p, const char* s )
+    {
+        const uint32_t length = static_cast<uint32_t>( std::strlen( s ) );
+        std::memcpy( p, &length, 4 );
+        std::memcpy( p+4, s, length );
+        return p+4+length;
+    }
+};
+
+
+template <>
+struct BinaryLogArg<std::string>
+{
+    static const char type = 's';
+    static size_t size( const std::string& s ) { return 4 + s.size(); }
+    static char*  encode( char* p, const std::string& s )
+    {
+        const uint32_t length = static_cast<uint32_t>( s.size() );
+        std::memcpy( p, &length, 4 );
+        std::memcpy( p+4, s.data(), length );
+        return p+4+length;
+    }
+};
+
+
+/// Other pointers print as addresses
+template <typename T>
+struct BinaryLogArg<T, typename std::enable_if<
+    std::is_pointer<T>::value &&
+    !std::is_same<T, const char*>::value && !std::is_same<T, char*>::value >::type>
+{
+    static const char type = 'p';
+    static size_t size( T )                  { return 8; }
+    static char*  encode( char* p, T v )
+    {
+        const uint64_t x = reinterpret_cast<uintptr_t>( v );
+        std::memcpy( p, &x, 8 );
+        return p+8;
+    }
+};
+
+
+//------------------------------------------------------------------------------
+//
+// BinaryLog
+//
+//------------------------------------------------------------------------------
+
+inline BinaryLog::State& BinaryLog::state()
+{
+    static State s;
+    return s;
+}
+
+
+inline uint64_t BinaryLog::ticks()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+
+inline bool BinaryLog::isOpen()
+{
+    return state().open.load( std::memory_order_relaxed );
+}
+
+
+inline unsigned long BinaryLog::getNumDropped()
+{
+    return state().dropped.load();
+}
+
+
+inline bool BinaryLog::open( const char* path, size_t capacity )
+{
+    close();
+
+    State& s = state();
+    std::lock_guard<std::mutex> lock( s.mutex );
+
+    capacity = padded( std::max( capacity, sizeof( FileHeader ) + 4096 ) );
+    const int fd = ::open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if( fd < 0 )
+        return false;
+    if( ftruncate( fd, capacity ) != 0 )
+    {
+        ::close( fd );
+        return false;
+    }
+    void* base = mmap( 0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if( base == MAP_FAILED )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    //
+    // Calibrate the cycle counter against the wall clock
+    //
+    typedef std::chrono::steady_clock Clock;
+    double ticks_per_second = 1.0e9;
+#if defined( __x86_64__ ) || defined( __i386__ )
+    {
+        const Clock::time_point start = Clock::now();
+        const uint64_t ticks_start = ticks();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        const uint64_t ticks_end = ticks();
+        const double seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+        ticks_per_second = ( ticks_end - ticks_start ) / seconds;
+    }
+#endif
+
+    FileHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.magic, "KLOGBIN", 8 );
+    header.version          = 1;
+    header.header_size      = sizeof( FileHeader );
+    header.ticks_start      = ticks();
+    header.wall_start       = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch() ).count();
+    header.ticks_per_second = ticks_per_second;
+    std::memcpy( base, &header, sizeof( header ) );
+
+    s.base     = static_cast<char*>( base );
+    s.capacity = capacity;
+    s.fd       = fd;
+    s.cursor.store( padded( sizeof( FileHeader ) ) );
+    s.dropped.store( 0 );
+
+    // Sites registered by an earlier log are already in use
+    for( uint32_t id = 1; id <= s.sites.size(); ++id )
+        writeSite( s, id );
+
+    s.open.store( true );
+    return true;
+}
+
+
+inline void BinaryLog::close()
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock( s.mutex );
+
+    if( !s.open.exchange( false ) )
+        return;
+    while( s.writers.load() != 0 )
+        std::this_thread::yield();
+
+    const size_t size = std::min( s.cursor.load(), s.capacity );
+
+    FileHeader header;
+    std::memcpy( &header, s.base, sizeof( header ) );
+    header.ticks_end = ticks();
+    header.wall_end  = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch() ).count();
+    header.size      = size;
+    std::memcpy( s.base, &header, sizeof( header ) );
+
+    munmap( s.base, s.capacity );
+    if( ftruncate( s.fd, size ) != 0 )
+    {
+        // The zero tail still marks the end of the records
+    }
+    ::close( s.fd );
+
+    s.base     = 0;
+    s.capacity = 0;
+    s.fd       = -1;
+}
+
+
+/// Claim length bytes for a record.  Returns 0, counting a drop, if the log
+/// is closed or full.  Caller must hold a writers count.
+inline char* BinaryLog::reserve( State& s, size_t length )
+{
+    if( !s.open.load() )
+        return 0;
+
+    const size_t offset = s.cursor.fetch_add( length, std::memory_order_relaxed );
+    if( offset + length > s.capacity )
+    {
+        s.dropped.fetch_add( 1, std::memory_order_relaxed );
+        return 0;
+    }
+    return s.base + offset;
+}
+
+
+/// Header goes in last, length last of all, so a record cut short by a
+/// crash reads as the end of the log
+inline void BinaryLog::commit( char* record, uint32_t length, uint32_t site, uint64_t ticks )
+{
+    std::memcpy( record + offsetof( RecordHeader, site ),  &site,  sizeof( site ) );
+    std::memcpy( record + offsetof( RecordHeader, ticks ), &ticks, sizeof( ticks ) );
+    std::atomic_signal_fence( std::memory_order_release );
+    std::memcpy( record + offsetof( RecordHeader, length ), &length, sizeof( length ) );
+}
+
+
+/// Caller holds s.mutex
+inline void BinaryLog::writeSite( State& s, uint32_t id )
+{
+    const Site& site = s.sites[ id-1 ];
+    const size_t length = padded( sizeof( RecordHeader ) + 12 +
+                                  site.level_name.size() + 1 +
+                                  site.file.size()       + 1 +
+                                  site.format.size()     + 1 +
+                                  site.types.size()      + 1 );
+
+    s.writers.fetch_add( 1 );
+    char* record = reserve( s, length );
+    if( record )
+    {
+        char* p = record + sizeof( RecordHeader );
+        const uint32_t fields[] = { id, site.indent, site.line };
+        std::memcpy( p, fields, sizeof( fields ) );
+        p += sizeof( fields );
+
+        const std::string* strings[] = { &site.level_name, &site.file, &site.format, &site.types };
+        for( int i = 0; i < 4; ++i )
+        {
+            std::memcpy( p, strings[ i ]->c_str(), strings[ i ]->size() + 1 );
+            p += strings[ i ]->size() + 1;
+        }
+        commit( record, static_cast<uint32_t>( length ), 0, 0 );
+    }
+    s.writers.fetch_sub( 1 );
+}
+
+
+template <typename... Args>
+uint32_t BinaryLog::registerSite(
+        const std::string& level_name,
+        int indent,
+        const char* file,
+        int line,
+        const char* format,
+        const Args&... )
+{
+    const char types[] = { BinaryLogArg<typename std::decay<Args>::type>::type..., '\0' };
+
+    Site site;
+    site.level_name = level_name;
+    site.indent     = indent;
+    site.file       = file;
+    site.line       = line;
+    site.format     = format;
+    site.types      = types;
+
+    State& s = state();
+    std::lock_guard<std::mutex> lock( s.mutex );
+    s.sites.push_back( site );
+    const uint32_t id = static_cast<uint32_t>( s.sites.size() );
+    if( s.open.load() )
+        writeSite( s, id );
+    return id;
+}
+
+
+template <typename T, typename... Rest>
+size_t BinaryLog::argSize( const T& arg, const Rest&... rest )
+{
+    return BinaryLogArg<typename std::decay<T>::type>::size( arg ) + argSize( rest... );
+}
+
+
+template <typename T, typename... Rest>
+char* BinaryLog::encode( char* p, const T& arg, const Rest&... rest )
+{
+    return encode( BinaryLogArg<typename std::decay<T>::type>::encode( p, arg ), rest... );
+}
+
+
+template <typename... Args>
+void BinaryLog::write( uint32_t site, const char*, const Args&... args )
+{
+    const uint64_t now    = ticks();
+    const size_t   length = padded( sizeof( RecordHeader ) + argSize( args... ) );
+
+    State& s = state();
+    s.writers.fetch_add( 1 );
+    char* record = reserve( s, length );
+    if( record )
+    {
+        encode( record + sizeof( RecordHeader ), args... );
+        commit( record, static_cast<uint32_t>( length ), site, now );
+    }
+    s.writers.fetch_sub( 1 );
+}
+
+
+//------------------------------------------------------------------------------
+//
+// Decoding
+//
+//------------------------------------------------------------------------------
+
+/// Returns the end of the argument, or 0 if it runs past end
+inline const char* BinaryLog::renderArg(
+        std::ostream& out,
+        char type,
+        const char* p,
+        const char* end )
+{
+    switch( type )
+    {
+        case 'b':
+            if( p+1 > end ) return 0;
+            out << ( *p != 0 );
+            return p+1;
+        case 'c':
+            if( p+1 > end ) return 0;
+            out << *p;
+            return p+1;
+        case 'i':
+        case 'u':
+        case 'p':
+        {
+            if( p+8 > end ) return 0;
+            uint64_t x;
+            std::memcpy( &x, p, 8 );
+            if( type == 'i' )
+                out << static_cast<long long>( x );
+            else if( type == 'u' )
+                out << static_cast<unsigned long long>( x );
+            else
+                out << reinterpret_cast<const void*>( static_cast<uintptr_t>( x ) );
+            return p+8;
+        }
+        case 'f':
+        {
+            if( p+4 > end ) return 0;
+            float x;
+            std::memcpy( &x, p, 4 );
+            out << x;
+            return p+4;
+        }
+        case 'd':
+        {
+            if( p+8 > end ) return 0;
+            double x;
+            std::memcpy( &x, p, 8 );
+            out << x;
+            return p+8;
+        }
+        case 's':
+        {
+            if( p+4 > end ) return 0;
+            uint32_t length;
+            std::memcpy( &length, p, 4 );
+            if( p+4+length > end ) return 0;
+            out.write( p+4, length );
+            return p+4+length;
+        }
+        default:
+            return 0;
+    }
+}
+
+
+/// Message text of one event: the format with each {} replaced by the next
+/// argument.  Arguments left over are appended, separated by spaces.
+inline void BinaryLog::renderEvent(
+        std::ostream& out,
+        const Site& site,
+        const char* p,
+        const char* end )
+{
+    const std::string& format = site.format;
+    size_t arg = 0;
+    size_t pos = 0;
+    for( ;; )
+    {
+        const size_t next = format.find( "{}", pos );
+        if( next == std::string::npos || arg == site.types.size() )
+            break;
+        out.write( format.data() + pos, next - pos );
+        if( !( p = renderArg( out, site.types[ arg++ ], p, end ) ) )
+            return;
+        pos = next + 2;
+    }
+    out.write( format.data() + pos, format.size() - pos );
+
+    for( ; arg < site.types.size(); ++arg )
+    {
+        out << ' ';
+        if( !( p = renderArg( out, site.types[ arg ], p, end ) ) )
+            return;
+    }
+}
+
+
+inline bool BinaryLog::decode( const char* path, std::ostream& out )
+{
+    const int fd = ::open( path, O_RDONLY );
+    if( fd < 0 )
+        return false;
+    struct stat st;
+    if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < sizeof( FileHeader ) )
+    {
+        ::close( fd );
+        return false;
+    }
+    const size_t file_size = st.st_size;
+    void* mapped = mmap( 0, file_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if( mapped == MAP_FAILED )
+        return false;
+    const char* base = static_cast<const char*>( mapped );
+
+    FileHeader header;
+    std::memcpy( &header, base, sizeof( header ) );
+    if( std::memcmp( header.magic, "KLOGBIN", 8 ) != 0 || header.version != 1 )
+    {
+        munmap( mapped, file_size );
+        return false;
+    }
+
+    // Prefer the rate over the whole run when close() recorded one
+    double seconds_per_tick = 1.0 / header.ticks_per_second;
+    if( header.ticks_end > header.ticks_start && header.wall_end > header.wall_start )
+        seconds_per_tick = ( header.wall_end - header.wall_start ) * 1.0e-9 /
+                           ( header.ticks_end - header.ticks_start );
+
+    const char* end = base + ( header.size != 0 ? std::min<size_t>( header.size, file_size )
+                                                : file_size );
+    std::vector<Site> sites;
+    std::ostringstream message;
+    for( const char* p = base + padded( header.header_size ); p + sizeof( RecordHeader ) <= end; )
+    {
+        RecordHeader record;
+        std::memcpy( &record, p, sizeof( record ) );
+        if( record.length < sizeof( RecordHeader ) || p + record.length > end )
+            break;
+        const char* payload     = p + sizeof( RecordHeader );
+        const char* payload_end = p + record.length;
+        p = payload_end;
+
+        if( record.site == 0 )
+        {
+            uint32_t fields[3];
+            if( payload + sizeof( fields ) > payload_end )
+                break;
+            std::memcpy( fields, payload, sizeof( fields ) );
+
+            // Ids count up from 1, one definition record each, so a corrupt
+            // id is skipped rather than sizing sites from it
+            if( fields[0] == 0 || fields[0] > static_cast<size_t>( end - base ) / sizeof( RecordHeader ) )
+                continue;
+
+            Site site;
+            site.indent = fields[1];
+            site.line   = fields[2];
+            std::string* strings[] = { &site.level_name, &site.file, &site.format, &site.types };
+            const char* s = payload + sizeof( fields );
+            for( int i = 0; i < 4 && s < payload_end; ++i )
+            {
+                const char* nul = static_cast<const char*>( std::memchr( s, 0, payload_end - s ) );
+                if( !nul )
+                    break;
+                strings[ i ]->assign( s, nul );
+                s = nul + 1;
+            }
+            if( sites.size() < fields[0] )
+                sites.resize( fields[0] );
+            sites[ fields[0]-1 ] = site;
+            continue;
+        }
+
+        if( record.site > sites.size() )
+            continue;
+        const Site& site = sites[ record.site-1 ];
+
+        const double elapsed = ( static_cast<int64_t>( record.ticks - header.ticks_start ) ) *
+                               seconds_per_tick;
+        const int64_t wall = header.wall_start + static_cast<int64_t>( elapsed * 1.0e9 );
+        timeval tv;
+        tv.tv_sec  = wall / 1000000000;
+        tv.tv_usec = ( wall % 1000000000 ) / 1000;
+
+        message.str( "" );
+        renderEvent( message, site, payload, payload_end );
+        out << "[" << Log::time( tv ) << "] " << site.level_name << ": "
+            << std::string( site.indent, '\t' ) << message.str() << "\n";
+    }
+
+    munmap( mapped, file_size );
+    return true;
+}
+
+
+#endif // KLIB_BINARY_LOG_H_
@@ -0,0 +1,381 @@
+#ifndef KLIB_DSTAR_LITE_H_
+#define KLIB_DSTAR_LITE_H_
+
+//
+// Incremental path planner (D* Lite, Koenig & Likhachev 2002).  Uses the same
+// Graph interface as AStar.h.
+//
+// D* Lite searches backward from the destination and keeps its cost-to-go
+// estimates between searches.  When edge costs change the caller reports
+// each changed edge with edgeCostChanged() and the next search() repairs only
+// the part of the previous solution the change affects, instead of
+// re-searching the whole space.  The origin may also move (an agent walking
+// the path) via setOrigin() without invalidating anything.
+//
+// Usage:
+//   DStarLite<Graph> planner( graph, origin, destination );
+//   planner.search();
+//   planner.getPath( path );
+//   ...
+//   // cell c of a grid became blocked: report its edges in both directions
+//   for( each neighbor n of c ) planner.edgeCostChanged( c, n );
+//   planner.setOrigin( agent_position );
+//   planner.search();
+//
+// Graph
+//     - Same requirements as AStar.h.  Additionally the neighbor relation
+//       must be symmetric (m is a neighbor of n iff n is a neighbor of m);
+//       getNeighbors() doubles as the predecessor list.  Costs may be
+//       asymmetric.
+//     - A removed edge is one which getNeighbors() no longer reports.  Adding
+//       or removing an edge is reported through edgeCostChanged() like any
+//       other cost change.
+//     - getCostHeuristic() must remain admissible after every change
+//
+// Graph::Node
+//     - Must additionally implement operator==
+//
+
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "GraphNodeStore.h"
+#include "IndexedHeap.h"
+#include "Logger.h"
+
+
+template <typename Graph>
+class DStarLite
+{
+public:
+    typedef typename Graph::Node       GraphNode;
+    typedef std::vector<GraphNode>     GraphNodeVec;
+
+    DStarLite( const Graph&     graph,
+               const GraphNode& origin,
+               const GraphNode& destination );
+
+    /// Move the origin, eg, after the agent has stepped along the path
+    void setOrigin( const GraphNode& origin );
+
+    /// Report a change to the cost (or existence) of the edge between u and v
+    /// in either direction.  Call after the graph has been updated.
+    void edgeCostChanged( const GraphNode& u, const GraphNode& v );
+
+    /// Bring the solution up to date.  Returns false if no path exists.
+    bool search();
+
+    /// Append path from the origin (exclusive) to the destination (inclusive).
+    /// Only valid after search() has brought the solution up to date.
+    void getPath( GraphNodeVec& path );
+
+    /// Cost of the path found by the last successful search
+    float getPathCost()const;
+
+    /// Number of nodes expanded by the last search
+    int getNumSteps()const    { return m_steps; }
+
+private:
+    //
+    // Uncopyable
+    //
+    DStarLite( const DStarLite& );
+    DStarLite& operator=( const DStarLite& );
+
+    //
+    // Per node state, kept for the lifetime of the planner.
+    //
+    struct Node
+    {
+        Node()
+            : g( INF ), rhs( INF ), k1( 0.0f ), k2( 0.0f ), heap_index( ~0u ) {}
+
+        explicit Node( const GraphNode& graph_node )
+            : graph_node( graph_node ),
+              g( INF ), rhs( INF ), k1( 0.0f ), k2( 0.0f ), heap_index( ~0u ) {}
+
+        GraphNode graph_node;
+        float     g;      ///< Cost to destination as of the last expansion
+        float     rhs;    ///< One step lookahead of g
+        float     k1, k2; ///< Priority while in the open heap
+        unsigned  heap_index;
+    };
+
+    /// Lexicographic order on ( k1, k2 ), smallest on top
+    struct HeapCompare
+    {
+        bool operator()( const Node* n0, const Node* n1 )const
+        {
+            return ( n0->k1 >  n1->k1 ) ||
+                   ( n0->k1 == n1->k1 && n0->k2 > n1->k2 );
+        }
+    };
+
+    static const float INF;
+
+    Node* getNode( const GraphNode& graph_node );
+
+    void  calculateKey( Node* node )const;
+    bool  topKeyLess( const Node* node )const;
+    void  updateVertex( Node* node );
+    void  computeShortestPath();
+
+
+    typedef IndexedHeap<Node, HeapCompare>                 NodeHeap;
+    typedef typename NodeStoreSelector<Graph, Node>::Type  NodeStore;
+
+    const Graph&   m_graph;
+    NodeHeap       m_open_heap;
+    NodeStore      m_nodes;
+
+    GraphNodeVec   m_predecessors;  ///< Scratch for computeShortestPath()
+    GraphNodeVec   m_successors;    ///< Scratch for updateVertex()/getPath()
+
+    GraphNode      m_origin;
+    GraphNode      m_last_origin;   ///< Origin when m_key_modifier last changed
+    Node*          m_origin_node;
+    Node*          m_destination_node;
+    float          m_key_modifier;  ///< Sum of heuristic shifts from moving origin
+
+    int            m_steps;
+};
+
+
+template <typename Graph>
+const float DStarLite<Graph>::INF = std::numeric_limits<float>::infinity();
+
+
+template <typename Graph>
+DStarLite<Graph>::DStarLite( const Graph&     graph,
+                             const GraphNode& origin,
+                             const GraphNode& destination )
+    : m_graph( graph ),
+      m_nodes( graph ),
+      m_origin( origin ),
+      m_last_origin( origin ),
+      m_key_modifier( 0.0f ),
+      m_steps( 0 )
+{
+    m_origin_node      = getNode( origin );
+    m_destination_node = getNode( destination );
+
+    m_destination_node->rhs = 0.0f;
+    calculateKey( m_destination_node );
+    m_open_heap.push( m_destination_node );
+}
+
+
+template <typename Graph>
+void DStarLite<Graph>::setOrigin( const GraphNode& origin )
+{
+    m_origin      = origin;
+    m_origin_node = getNode( origin );
+}
+
+
+template <typename Graph>
+void DStarLite<Graph>::edgeCostChanged( const GraphNode& u, const GraphNode& v )
+{
+    //
+    // Keys already in the heap were computed against m_last_origin; shifting
+    // the modifier keeps them valid lower bounds for the new origin
+    //
+    if( !( m_origin == m_last_origin ) )
+    {
+        m_key_modifier += m_graph.getCostHeuristic( m_last_origin, m_origin );
+        m_last_origin   = m_origin;
+    }
+
+    updateVertex( getNode( u ) );
+    updateVertex( getNode( v ) );
+}
+
+
+template <typename Graph>
+bool DStarLite<Graph>::search()
+{
+    m_steps = 0;
+    computeShortestPath();
+
+    KLOG( Log::DEBUG ) << "D* Lite steps: " << m_steps
+                       << " cost: " << m_origin_node->g;
+    return m_origin_node->g != INF;
+}
+
+
+template <typename Graph>
+float DStarLite<Graph>::getPathCost()const
+{
+    return m_origin_node->g;
+}
+
+
+template <typename Graph>
+void DStarLite<Graph>::getPath( GraphNodeVec& path )
+{
+    if( m_origin_node->g == INF )
+        return;
+
+    //
+    // Descend g from the origin.  g strictly decreases along the way so this
+    // terminates at the destination.
+    //
+    Node* current = m_origin_node;
+    while( current != m_destination_node )
+    {
+        m_successors.clear();
+        m_graph.getNeighbors( current->graph_node, m_successors );
+
+        Node* next      = 0;
+        float next_cost = INF;
+        for( typename GraphNodeVec::iterator it = m_successors.begin();
+             it != m_successors.end();
+             ++it )
+        {
+            Node* successor = getNode( *it );
+            const float cost = m_graph.getCost( current->graph_node, *it ) +
+                               successor->g;
+            if( cost < next_cost )
+            {
+                next      = successor;
+                next_cost = cost;
+            }
+        }
+
+        if( !next )
+            return;
+
+        path.push_back( next->graph_node );
+        current = next;
+    }
+}
+
+
+template <typename Graph>
+typename DStarLite<Graph>::Node* DStarLite<Graph>::getNode(
+        const GraphNode& graph_node )
+{
+    Node* node = m_nodes.find( graph_node );
+    return node ? node : m_nodes.create( graph_node, Node( graph_node ) );
+}
+
+
+template <typename Graph>
+void DStarLite<Graph>::calculateKey( Node* node )const
+{
+    node->k2 = std::min( node->g, node->rhs );
+    node->k1 = node->k2 +
+               m_graph.getCostHeuristic( m_origin, node->graph_node ) +
+               m_key_modifier;
+}
+
+
+/// True if node sorts before the origin in the open heap
+template <typename Graph>
+bool DStarLite<Graph>::topKeyLess( const Node* node )const
+{
+    Node origin_key( *m_origin_node );
+    calculateKey( &origin_key );
+    return HeapCompare()( &origin_key, node );
+}
+
+
+template <typename Graph>
+void DStarLite<Graph>::updateVertex( Node* node )
+{
+    if( node != m_destination_node )
+    {
+        m_successors.clear();
+        m_graph.getNeighbors( node->graph_node, m_successors );
+
+        float rhs = INF;
+        for( typename GraphNodeVec::iterator it = m_successors.begin();
+             it != m_successors.end();
+             ++it )
+        {
+            const Node* successor = m_nodes.find( *it );
+            if( successor )
+                rhs = std::min( rhs, m_graph.getCost( node->graph_node, *it ) +
+                                     successor->g );
+        }
+        node->rhs = rhs;
+    }
+
+    const bool consistent = node->g == node->rhs;
+    if( m_open_heap.contains( node ) )
+    {
+        if( consistent )
+        {
+            m_open_heap.remove( node );
+        }
+        else
+        {
+            calculateKey( node );
+            m_open_heap.update( node );
+        }
+    }
+    else if( !consistent )
+    {
+        calculateKey( node );
+        m_open_heap.push( node );
+    }
+}
+
+
+template <typename Graph>
+void DStarLite<Graph>::computeShortestPath()
+{
+    if( !( m_origin == m_last_origin ) )
+    {
+        m_key_modifier += m_graph.getCostHeuristic( m_last_origin, m_origin );
+        m_last_origin   = m_origin;
+    }
+
+    while( !m_open_heap.empty() &&
+           ( topKeyLess( m_open_heap.top() ) ||
+             m_origin_node->rhs != m_origin_node->g ) )
+    {
+        Node* current = m_open_heap.top();
+
+        //
+        // Key is stale from before the origin moved: requeue with the new one
+        //
+        const float old_k1 = current->k1;
+        const float old_k2 = current->k2;
+        calculateKey( current );
+        if( old_k1 < current->k1 || ( old_k1 == current->k1 && old_k2 < current->k2 ) )
+        {
+            m_open_heap.update( current );
+            continue;
+        }
+
+        m_steps++;
+        m_open_heap.pop();
+
+        if( current->g > current->rhs )
+        {
+            // Overconsistent: settle it
+            current->g = current->rhs;
+        }
+        else
+        {
+            // Underconsistent: cost went up, invalidate and re-derive
+            current->g = INF;
+            updateVertex( current );
+        }
+
+        m_predecessors.clear();
+        m_graph.getNeighbors( current->graph_node, m_predecessors );
+        for( typename GraphNodeVec::iterator it = m_predecessors.begin();
+             it != m_predecessors.end();
+             ++it )
+        {
+            updateVertex( getNode( *it ) );
+        }
+    }
+}
+
+
+#endif // KLIB_DSTAR_LITE_H_
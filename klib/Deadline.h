@@ -0,0 +1,313 @@
+
+#ifndef KLIB_DEADLINE_H_
+#define KLIB_DEADLINE_H_
+
+//
+// Time budgets for anytime searches: iterate until the next batch of
+// iterations might not finish in time, or until cancelled.
+//
+// Usage:
+//   Budget budget( 0.75 );                 // Per move, kept across moves
+//   ...
+//   Deadline deadline = budget.start();
+//   while( !deadline.expired() )
+//       iterate();
+//   ...                                    // Use the result
+//   budget.finish( deadline );
+//
+//   - expired() only reads the clock every getStride() calls.  The stride is
+//     recalibrated at each read from the measured iteration cost, aiming for
+//     one read per check period (budget / 1000 by default)
+//   - Between reads the search runs blind, so the deadline expires once the
+//     time left is under a safety margin: a stride's worth of iterations at
+//     the mean cost plus four mean deviations, or the longest recent stride
+//     for long-tailed costs, plus the reserve
+//   - Budget carries the cost estimate from one deadline to the next and
+//     learns the reserve from how long callers run on after expiry (and any
+//     overrun), plus a quarter for luck, so later searches use nearly the
+//     full budget without going over it
+//   - CancellationToken lets another thread stop a search; it is seen at
+//     the next clock read.  Copies share the same flag
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+
+///
+/// Shared flag for cooperative cancellation
+///
+class CancellationToken
+{
+public:
+    CancellationToken() : m_flag( std::make_shared< std::atomic<bool> >( false ) ) {}
+
+    void cancel()const            { m_flag->store( true, std::memory_order_relaxed ); }
+    void reset()const             { m_flag->store( false, std::memory_order_relaxed ); }
+    bool isCancelled()const       { return m_flag->load( std::memory_order_relaxed ); }
+
+private:
+    std::shared_ptr< std::atomic<bool> > m_flag;
+};
+
+
+///
+/// A point in time a search must stop by
+///
+class Deadline
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Running estimate of the time per iteration in seconds
+    struct Estimate
+    {
+        Estimate() : mean( 0.0 ), deviation( 0.0 ), peak( 0.0 ) {}
+        double mean;
+        double deviation;
+        double peak;          ///< Decaying max time between clock reads
+    };
+
+    /// Deadline seconds from now, keeping reserve seconds spare
+    explicit Deadline( double                   seconds,
+                       double                   reserve  = 0.0,
+                       const CancellationToken& token    = CancellationToken(),
+                       const Estimate&          estimate = Estimate() );
+
+    /// Target time between clock reads
+    void   setCheckPeriod( double seconds );
+
+    /// Counts one iteration.  True once another stride of iterations might
+    /// overrun, or on cancellation, and from then on.
+    bool   expired();
+
+    /// Read the clock now rather than waiting for the stride
+    bool   expiredNow();
+
+    double getBudget()const                  { return m_budget;     }
+    double getReserve()const                 { return m_reserve;    }
+    double getElapsed()const;
+    double getRemaining()const               { return m_budget - getElapsed(); }
+
+    /// Elapsed time when expiry was noticed, or zero if it hasn't expired
+    double getExpiredAt()const               { return m_expired_at; }
+
+    unsigned long long getNumIterations()const { return m_count;    }
+    unsigned long long getNumChecks()const   { return m_num_checks; }
+    unsigned           getStride()const      { return m_stride;     }
+    const Estimate&    getEstimate()const    { return m_estimate;   }
+    double             getMargin()const;
+
+    const CancellationToken& getToken()const { return m_token;      }
+
+private:
+    bool check();
+
+    static const unsigned MAX_STRIDE = 1u << 20;
+
+    CancellationToken   m_token;
+    Clock::time_point   m_start;
+    double              m_budget;
+    double              m_reserve;
+    double              m_check_period;
+
+    Estimate            m_estimate;
+    unsigned            m_stride;
+    unsigned long long  m_count;
+    unsigned long long  m_next_check;
+    unsigned long long  m_last_count;
+    double              m_last_elapsed;
+    unsigned long long  m_num_checks;
+    double              m_expired_at;
+    bool                m_expired;
+};
+
+
+///
+/// A recurring time budget, such as per turn, which learns its safety
+/// margins from the deadlines it starts
+///
+class Budget
+{
+public:
+    /// At least min_reserve seconds are kept spare for work after expiry
+    explicit Budget( double seconds, double min_reserve = 0.0 );
+
+    Deadline start( const CancellationToken& token = CancellationToken() )const;
+
+    /// Learn from a deadline returned by start() once its turn is done
+    void     finish( const Deadline& deadline );
+
+    double   getSeconds()const               { return m_seconds;    }
+    double   getReserve()const               { return m_min_reserve + 1.25*m_tail; }
+    void     setSeconds( double seconds )    { m_seconds = seconds; }
+
+    unsigned getNumOverruns()const           { return m_num_overruns; }
+
+private:
+    double             m_seconds;
+    double             m_min_reserve;
+    double             m_tail;           ///< Decaying max of work after expiry
+    Deadline::Estimate m_estimate;
+    unsigned           m_num_overruns;
+};
+
+
+//------------------------------------------------------------------------------
+//
+// Deadline
+//
+//------------------------------------------------------------------------------
+
+inline Deadline::Deadline(
+        double                   seconds,
+        double                   reserve,
+        const CancellationToken& token,
+        const Estimate&          estimate )
+    : m_token( token ),
+      m_start( Clock::now() ),
+      m_budget( seconds ),
+      m_reserve( reserve ),
+      m_check_period( seconds / 1000.0 ),
+      m_estimate( estimate ),
+      m_stride( 1 ),
+      m_count( 0 ),
+      m_next_check( 1 ),
+      m_last_count( 0 ),
+      m_last_elapsed( 0.0 ),
+      m_num_checks( 0 ),
+      m_expired_at( 0.0 ),
+      m_expired( false )
+{
+    setCheckPeriod( m_check_period );
+}
+
+
+inline void Deadline::setCheckPeriod( double seconds )
+{
+    m_check_period = seconds;
+    if( m_estimate.mean > 0.0 )
+    {
+        const double stride = m_check_period / m_estimate.mean;
+        m_stride = static_cast<unsigned>( std::max( 1.0, std::min( stride, double( MAX_STRIDE ) ) ) );
+    }
+}
+
+
+inline bool Deadline::expired()
+{
+    if( m_expired )
+        return true;
+    if( ++m_count < m_next_check )
+        return false;
+    return check();
+}
+
+
+inline bool Deadline::expiredNow()
+{
+    return m_expired || check();
+}
+
+
+inline double Deadline::getElapsed()const
+{
+    return std::chrono::duration<double>( Clock::now() - m_start ).count();
+}
+
+
+inline double Deadline::getMargin()const
+{
+    return std::max( m_stride*( m_estimate.mean + 4.0*m_estimate.deviation ),
+                     m_estimate.peak ) + m_reserve;
+}
+
+
+//
+// Fold the iterations since the last read into the cost estimate, pick the
+// stride to the next read and test the remaining time against the margin.
+// The first read only marks the start of the first iteration, since the
+// caller may have done other work since construction.
+//
+inline bool Deadline::check()
+{
+    const double elapsed = getElapsed();
+
+    const unsigned long long iterations = m_count - m_last_count;
+    if( m_num_checks++ > 0 && iterations > 0 )
+    {
+        const double batch = elapsed - m_last_elapsed;
+        const double cost  = batch / iterations;
+        m_estimate.peak    = std::max( batch, m_estimate.peak*0.99 );
+        if( m_estimate.mean <= 0.0 )
+        {
+            m_estimate.mean      = cost;
+            m_estimate.deviation = cost;
+        }
+        else
+        {
+            const double alpha = 0.25;
+            m_estimate.deviation += alpha*( std::fabs( cost - m_estimate.mean ) - m_estimate.deviation );
+            m_estimate.mean      += alpha*( cost - m_estimate.mean );
+        }
+        setCheckPeriod( m_check_period );
+    }
+    m_last_count   = m_count;
+    m_last_elapsed = elapsed;
+    m_next_check   = m_count + m_stride;
+
+    if( m_token.isCancelled() || m_budget - elapsed <= getMargin() )
+    {
+        m_expired    = true;
+        m_expired_at = elapsed;
+    }
+    return m_expired;
+}
+
+
+//------------------------------------------------------------------------------
+//
+// Budget
+//
+//------------------------------------------------------------------------------
+
+inline Budget::Budget( double seconds, double min_reserve )
+    : m_seconds( seconds ),
+      m_min_reserve( min_reserve ),
+      m_tail( 0.0 ),
+      m_num_overruns( 0 )
+{
+}
+
+
+inline Deadline Budget::start( const CancellationToken& token )const
+{
+    return Deadline( m_seconds, getReserve(), token, m_estimate );
+}
+
+
+//
+// The tail is the time from expiry to finish.  An overrun means the reserve
+// was short by that much, whatever the cause.  It decays slowly so a single
+// slow turn is remembered for a while.
+//
+inline void Budget::finish( const Deadline& deadline )
+{
+    const double used = deadline.getElapsed();
+    if( used > deadline.getBudget() )
+        ++m_num_overruns;
+
+    double tail = m_tail + std::max( 0.0, used - deadline.getBudget() );
+    if( deadline.getExpiredAt() > 0.0 )
+        tail = std::max( tail, used - deadline.getExpiredAt() );
+    m_tail = std::max( tail, m_tail*0.9 );
+
+    if( deadline.getEstimate().mean > 0.0 )
+        m_estimate = deadline.getEstimate();
+}
+
+
+#endif // KLIB_DEADLINE_H_
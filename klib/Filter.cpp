@@ -0,0 +1,73 @@
+#include "Filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace legion;
+
+
+namespace
+{
+
+/// Inverse CDF of the 1D tent filter on [-1,1]
+inline float warpTent( float u )
+{
+    u *= 2.0f;
+    return u < 1.0f ? sqrtf( u ) - 1.0f : 1.0f - sqrtf( 2.0f - u );
+}
+
+
+//
+// Cubic B-spline on [-2,2]:
+//     f(x) = ( 3|x|^3 - 6x^2 + 4 ) / 6    |x| < 1
+//            ( 2 - |x| )^3 / 6            1 <= |x| < 2
+//
+// Sample |x| from the half kernel, whose CDF on [0,2] is
+//     H(t) = ( 3t^4/4 - 2t^3 + 4t ) / 3   t < 1, H(1) = 11/12
+//            1 - ( 2 - t )^4 / 12         t >= 1
+// and pick the sign with the leading bit of u.
+//
+inline float warpCubicSpline( float u )
+{
+    const float sign = u < 0.5f ? -1.0f : 1.0f;
+    const float w    = u < 0.5f ? 1.0f - 2.0f*u : 2.0f*u - 1.0f;
+
+    static const float H1 = 11.0f / 12.0f;
+    if( w >= H1 )
+        return sign * ( 2.0f - sqrtf( sqrtf( 12.0f*( 1.0f - w ) ) ) );
+
+    //
+    // Inner segment is a quartic: Newton from a linear guess, which
+    // converges in a handful of steps since H is smooth and monotonic here
+    //
+    float t = w / H1;
+    for( int i = 0; i < 5; ++i )
+    {
+        const float t2 = t*t;
+        const float h  = ( 0.75f*t2*t2 - 2.0f*t2*t + 4.0f*t ) / 3.0f - w;
+        const float dh = ( 3.0f*t2*t - 6.0f*t2 + 4.0f ) / 3.0f;
+        t -= h / dh;
+    }
+    return sign * std::min( std::max( t, 0.0f ), 1.0f );
+}
+
+}
+
+
+Vector2 legion::warpSampleByBoxFilter( const Vector2& in_sample )
+{
+    return Vector2( in_sample.x - 0.5f, in_sample.y - 0.5f );
+}
+
+
+Vector2 legion::warpSampleByTentFilter( const Vector2& in_sample )
+{
+    return Vector2( warpTent( in_sample.x ), warpTent( in_sample.y ) );
+}
+
+
+Vector2 legion::warpSampleByCubicSplineFilter( const Vector2& in_sample )
+{
+    return Vector2( warpCubicSpline( in_sample.x ),
+                    warpCubicSpline( in_sample.y ) );
+}
@@ -1,27 +1,34 @@
 
-/// \file Util.hpp
-/// Utility functions and macros
+/// \file Filter.hpp
+/// Warping of uniform samples to pixel reconstruction filter kernels
 
 #ifndef LEGION_COMMON_MATH_FILTER_HPP_
 #define LEGION_COMMON_MATH_FILTER_HPP_
 
-#include <Legion/Common/Math/Vector.hpp>
-
 namespace legion 
 {
 
+/// Minimal 2D vector used by the filter warps
+struct Vector2
+{
+    Vector2() : x( 0.0f ), y( 0.0f ) {}
+    Vector2( float x, float y ) : x( x ), y( y ) {}
+
+    float x, y;
+};
+
 /// Warp the uniformly chosen 2D sample to fit a Box filter kernel.
-/// \param in_sample  The input  sample in [0,2]^2
+/// \param in_sample  The input  sample in [0,1]^2
 /// \returns          The warped sample in [-0.5,0.5]^2
 Vector2 warpSampleByBoxFilter        ( const Vector2& in_sample );
 
 /// Warp the uniformly chosen 2D sample to fit a Tent filter kernel.
-///   \param in_sample  The input  sample in [0,2]^2
+///   \param in_sample  The input  sample in [0,1]^2
 ///   \returns          The warped sample in [-1,1]^2
 Vector2 warpSampleByTentFilter       ( const Vector2& in_sample );
 
 /// Warp the uniformly chosen 2D sample to fit a Cubic Spline filter kernel.
-///   \param in_sample  The input  sample in [0,2]^2
+///   \param in_sample  The input  sample in [0,1]^2
 ///   \returns          The warped sample in [-2,2]^2
 Vector2 warpSampleByCubicSplineFilter( const Vector2& in_sample );
 
@@ -0,0 +1,116 @@
+#ifndef KLIB_FREE_LIST_POOL_H_
+#define KLIB_FREE_LIST_POOL_H_
+
+//
+// Recycling allocator for node based containers (std::map, std::set, ...).
+//
+// Memory handed back to a FreeListPool is kept on a free list rather than
+// being returned to the system, so a container that is repeatedly filled and
+// cleared stops allocating once it has reached its high water mark.
+//
+// The pool recycles chunks of a single size -- the size of the first
+// allocation it sees, which for node based containers is the node size.  All
+// other requests fall through to operator new.
+//
+// Usage:
+//   FreeListPool pool;
+//   std::map<K, V, std::less<K>, PoolAllocator< std::pair<const K, V> > >
+//       map( std::less<K>(), PoolAllocator< std::pair<const K, V> >( &pool ) );
+//
+// The pool must outlive every container using it.
+//
+
+
+#include <cstddef>
+#include <new>
+
+
+class FreeListPool
+{
+public:
+    FreeListPool() : m_chunk_size( 0 ), m_free( 0 ) {}
+
+    ~FreeListPool()
+    {
+        while( m_free )
+        {
+            FreeChunk* next = m_free->next;
+            ::operator delete( m_free );
+            m_free = next;
+        }
+    }
+
+    void* allocate( size_t size )
+    {
+        if( m_chunk_size == 0 && size >= sizeof( FreeChunk ) )
+            m_chunk_size = size;
+
+        if( size == m_chunk_size && m_free )
+        {
+            FreeChunk* chunk = m_free;
+            m_free = chunk->next;
+            return chunk;
+        }
+        return ::operator new( size );
+    }
+
+    void deallocate( void* p, size_t size )
+    {
+        if( size == m_chunk_size )
+        {
+            FreeChunk* chunk = static_cast<FreeChunk*>( p );
+            chunk->next = m_free;
+            m_free      = chunk;
+            return;
+        }
+        ::operator delete( p );
+    }
+
+private:
+    FreeListPool( const FreeListPool& );
+    FreeListPool& operator=( const FreeListPool& );
+
+    struct FreeChunk
+    {
+        FreeChunk* next;
+    };
+
+    size_t     m_chunk_size;
+    FreeChunk* m_free;
+};
+
+
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit PoolAllocator( FreeListPool* pool ) : m_pool( pool ) {}
+
+    template <typename U>
+    PoolAllocator( const PoolAllocator<U>& other ) : m_pool( other.pool() ) {}
+
+    T* allocate( size_t n )
+    { return static_cast<T*>( m_pool->allocate( n*sizeof( T ) ) ); }
+
+    void deallocate( T* p, size_t n )
+    { m_pool->deallocate( p, n*sizeof( T ) ); }
+
+    FreeListPool* pool()const  { return m_pool; }
+
+private:
+    FreeListPool* m_pool;
+};
+
+
+template <typename T, typename U>
+bool operator==( const PoolAllocator<T>& a, const PoolAllocator<U>& b )
+{ return a.pool() == b.pool(); }
+
+template <typename T, typename U>
+bool operator!=( const PoolAllocator<T>& a, const PoolAllocator<U>& b )
+{ return a.pool() != b.pool(); }
+
+
+#endif // KLIB_FREE_LIST_POOL_H_
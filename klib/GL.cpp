@@ -23,6 +23,8 @@
 #include <Legion/Common/Util/Assert.hpp>
 #include <Legion/Common/Util/GL.hpp>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -68,7 +70,6 @@ const char* getGLErrorString( GLenum error )
 void GL::checkError()
 {
     GLenum err = GL::GetError();
-    std::cerr << "ERROR: " << err << std::endl;
     if( err != GL_NO_ERROR )
     {
         std::ostringstream oss;
@@ -105,18 +106,25 @@ GL::GL()
 #    define GET_PROC_ADDR( name ) ( ( void* (*)(const GLubyte*))( getProcAddress ) )( (const GLubyte*)#name )
 
 
-//  if( !m_gl_lib.open( "libGL.so" ) )
-  if( !m_gl_lib.open( "/usr/lib/x86_64-linux-gnu/libGL.so" ) )
-      throw legion::AssertionFailure( "Failed to open GL lib: 'libGL.so'" );
+  // LEGION_GL_LIBRARY selects another GL, eg libOSMesa.so or libEGL.so for
+  // a headless software context
+  const char* env_gl_path = getenv( "LEGION_GL_LIBRARY" );
+  const std::string gl_path = env_gl_path ? env_gl_path : "/usr/lib/x86_64-linux-gnu/libGL.so";
+  if( !m_gl_lib.open( gl_path.c_str() ) )
+      throw legion::AssertionFailure( "Failed to open GL lib: '" + gl_path + "'" );
 
-  const void* getProcAddress = m_gl_lib.getSymbol( "glXGetProcAddressARB" );
+  const char* get_proc_names[] = { "glXGetProcAddressARB", "OSMesaGetProcAddress", "eglGetProcAddress" };
+  const void* getProcAddress = 0;
+  for( unsigned i = 0; i < 3 && !getProcAddress; ++i )
+      getProcAddress = m_gl_lib.getSymbol( get_proc_names[i] );
   if( !getProcAddress )
-      throw legion::AssertionFailure( "Failed to load 'glXGetProcAddressARB'" );
+      throw legion::AssertionFailure( "Failed to load a GetProcAddress from '" + gl_path + "'" );
 #else  // MAC
 #    define GET_PROC_ADDR( name ) (::name )
 #endif
 
       p_glGetError        = ( glGetError_t )( GET_PROC_ADDR( glGetError ) );
+      p_glGetString       = ( glGetString_t )( GET_PROC_ADDR( glGetString ) );
 
       p_glGenTextures     = ( glGenTextures_t   )( GET_PROC_ADDR( glGenTextures   ) );
       p_glTexParameteri   = ( glTexParameteri_t )( GET_PROC_ADDR( glTexParameteri ) );
@@ -127,6 +135,20 @@ GL::GL()
       p_glGenBuffers      = ( glGenBuffers_t    )( GET_PROC_ADDR( glGenBuffers    ) );
       p_glBindBuffer      = ( glBindBuffer_t    )( GET_PROC_ADDR( glBindBuffer    ) );
       p_glBufferData      = ( glBufferData_t    )( GET_PROC_ADDR( glBufferData    ) );
+      p_glDeleteBuffers   = ( glDeleteBuffers_t )( GET_PROC_ADDR( glDeleteBuffers ) );
+      p_glBufferStorage   = ( glBufferStorage_t )( GET_PROC_ADDR( glBufferStorage ) );
+      p_glMapBufferRange  = ( glMapBufferRange_t)( GET_PROC_ADDR( glMapBufferRange) );
+      p_glUnmapBuffer     = ( glUnmapBuffer_t   )( GET_PROC_ADDR( glUnmapBuffer   ) );
+
+      p_glFenceSync       = ( glFenceSync_t     )( GET_PROC_ADDR( glFenceSync     ) );
+      p_glClientWaitSync  = ( glClientWaitSync_t)( GET_PROC_ADDR( glClientWaitSync) );
+      p_glDeleteSync      = ( glDeleteSync_t    )( GET_PROC_ADDR( glDeleteSync    ) );
+
+      p_glEnableClientState  = ( glEnableClientState_t  )( GET_PROC_ADDR( glEnableClientState  ) );
+      p_glDisableClientState = ( glDisableClientState_t )( GET_PROC_ADDR( glDisableClientState ) );
+      p_glVertexPointer      = ( glVertexPointer_t      )( GET_PROC_ADDR( glVertexPointer      ) );
+      p_glTexCoordPointer    = ( glTexCoordPointer_t    )( GET_PROC_ADDR( glTexCoordPointer    ) );
+      p_glDrawArrays         = ( glDrawArrays_t         )( GET_PROC_ADDR( glDrawArrays         ) );
 
       p_glEnable          = ( glEnable_t        )( GET_PROC_ADDR( glEnable        ) );
       p_glDisable         = ( glDisable_t       )( GET_PROC_ADDR( glDisable       ) );
@@ -151,6 +173,27 @@ GLenum GL::GetError()
 }
 
 
+const GLubyte* GL::GetString( GLenum name )
+{
+    const GLubyte* result = instance().p_glGetString( name );
+    GL::checkError();
+    return result;
+}
+
+
+bool GL::hasBufferStorage()
+{
+    const char* version = reinterpret_cast<const char*>( GetString( GL_VERSION ) );
+    int major = 0, minor = 0;
+    if( version && sscanf( version, "%d.%d", &major, &minor ) == 2 &&
+        ( major > 4 || ( major == 4 && minor >= 4 ) ) )
+        return true;
+
+    const char* extensions = reinterpret_cast<const char*>( GetString( GL_EXTENSIONS ) );
+    return extensions && strstr( extensions, "GL_ARB_buffer_storage" ) != 0;
+}
+
+
 void GL::GenTextures( GLsizei n, GLuint* ids )
 {
     GL_CHECK_CALL( instance().p_glGenTextures( n, ids ) );
@@ -193,10 +236,7 @@ void GL::PixelStorei( GLenum pname, GLint param )
 
 void GL::GenBuffers( GLsizei n, GLuint* ids )
 {
-    std::cerr << "Call glGenBuffers: " << (void*)(instance().p_glGenBuffers) << std::endl;
-//    GL_CHECK_CALL( instance().p_glGenBuffers( -1, 0 ) );
     GL_CHECK_CALL( instance().p_glGenBuffers( n, ids ) );
-    std::cerr << "IDs: " << *ids << std::endl;
 }
 
 
@@ -211,6 +251,86 @@ void GL::BufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum
     GL_CHECK_CALL( instance().p_glBufferData( target, size, data, usage ) );
 }
 
+
+void GL::DeleteBuffers( GLsizei n, const GLuint* ids )
+{
+    GL_CHECK_CALL( instance().p_glDeleteBuffers( n, ids ) );
+}
+
+
+void GL::BufferStorage( GLenum target, GLsizeiptr size, const GLvoid* data, GLbitfield flags )
+{
+    GL_CHECK_CALL( instance().p_glBufferStorage( target, size, data, flags ) );
+}
+
+
+void* GL::MapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+    void* result = instance().p_glMapBufferRange( target, offset, length, access );
+    GL::checkError();
+    return result;
+}
+
+
+GLboolean GL::UnmapBuffer( GLenum target )
+{
+    GLboolean result = instance().p_glUnmapBuffer( target );
+    GL::checkError();
+    return result;
+}
+
+
+GLsync GL::FenceSync( GLenum condition, GLbitfield flags )
+{
+    GLsync result = instance().p_glFenceSync( condition, flags );
+    GL::checkError();
+    return result;
+}
+
+
+GLenum GL::ClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+    GLenum result = instance().p_glClientWaitSync( sync, flags, timeout );
+    GL::checkError();
+    return result;
+}
+
+
+void GL::DeleteSync( GLsync sync )
+{
+    GL_CHECK_CALL( instance().p_glDeleteSync( sync ) );
+}
+
+
+void GL::EnableClientState( GLenum array )
+{
+    GL_CHECK_CALL( instance().p_glEnableClientState( array ) );
+}
+
+
+void GL::DisableClientState( GLenum array )
+{
+    GL_CHECK_CALL( instance().p_glDisableClientState( array ) );
+}
+
+
+void GL::VertexPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer )
+{
+    GL_CHECK_CALL( instance().p_glVertexPointer( size, type, stride, pointer ) );
+}
+
+
+void GL::TexCoordPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer )
+{
+    GL_CHECK_CALL( instance().p_glTexCoordPointer( size, type, stride, pointer ) );
+}
+
+
+void GL::DrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+    GL_CHECK_CALL( instance().p_glDrawArrays( mode, first, count ) );
+}
+
     
 void GL::Enable( GLenum cap )
 {
@@ -224,9 +344,12 @@ void GL::Disable( GLenum cap )
 }
 
 
+// glGetError is itself an invalid operation between glBegin and glEnd, so
+// errors from Begin and the vertex calls are picked up by End
+
 void GL::Begin( GLenum mode )
 {
-    GL_CHECK_CALL( instance().p_glBegin( mode ) );
+    instance().p_glBegin( mode );
 }
 
 
@@ -238,5 +361,177 @@ void GL::End()
 
 void GL::TexCoord2f( GLfloat s, GLfloat t )
 {
-    GL_CHECK_CALL( instance().p_glTexCoord2f( s, t ) );
+    instance().p_glTexCoord2f( s, t );
+}
+
+
+void GL::Vertex2f( GLfloat x, GLfloat y )
+{
+    instance().p_glVertex2f( x, y );
+}
+
+
+//------------------------------------------------------------------------------
+//
+// GL::DrawBatch
+//
+//------------------------------------------------------------------------------
+
+GL::DrawBatch::DrawBatch( size_t segment_size, bool persistent )
+    : m_buffer( 0 ),
+      m_mapped( 0 ),
+      m_segment_size( segment_size ),
+      m_segment( 0 ),
+      m_vertices( 0 ),
+      m_first( 0 ),
+      m_count( 0 ),
+      m_limit( 0 ),
+      m_mode( GL_TRIANGLES ),
+      m_vertices_per_primitive( 3 ),
+      m_s( 0.0f ),
+      m_t( 0.0f ),
+      m_num_draws( 0 )
+{
+    if( segment_size < 4 )
+        throw legion::AssertionFailure( "GL::DrawBatch segment must hold a quad" );
+    for( unsigned i = 0; i < NUM_SEGMENTS; ++i )
+        m_fences[ i ] = 0;
+
+    GL::GenBuffers( 1, &m_buffer );
+    GL::BindBuffer( GL_ARRAY_BUFFER, m_buffer );
+    if( persistent && GL::hasBufferStorage() )
+    {
+        const GLsizeiptr size  = NUM_SEGMENTS * m_segment_size * sizeof( Vertex );
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GL::BufferStorage( GL_ARRAY_BUFFER, size, 0, flags );
+        m_mapped   = static_cast<Vertex*>( GL::MapBufferRange( GL_ARRAY_BUFFER, 0, size, flags ) );
+        m_vertices = m_mapped;
+    }
+    else
+    {
+        m_staging.resize( m_segment_size );
+        m_vertices = &m_staging[0];
+    }
+    GL::BindBuffer( GL_ARRAY_BUFFER, 0 );
+    setLimit();
+}
+
+
+GL::DrawBatch::~DrawBatch()
+{
+    for( unsigned i = 0; i < NUM_SEGMENTS; ++i )
+        if( m_fences[ i ] )
+            GL::DeleteSync( m_fences[ i ] );
+
+    if( m_mapped )
+    {
+        GL::BindBuffer( GL_ARRAY_BUFFER, m_buffer );
+        GL::UnmapBuffer( GL_ARRAY_BUFFER );
+        GL::BindBuffer( GL_ARRAY_BUFFER, 0 );
+    }
+    GL::DeleteBuffers( 1, &m_buffer );
+}
+
+
+void GL::DrawBatch::begin( GLenum mode )
+{
+    switch( mode )
+    {
+        case GL_POINTS:    m_vertices_per_primitive = 1; break;
+        case GL_LINES:     m_vertices_per_primitive = 2; break;
+        case GL_TRIANGLES: m_vertices_per_primitive = 3; break;
+        case GL_QUADS:     m_vertices_per_primitive = 4; break;
+        default:
+            throw legion::AssertionFailure( "GL::DrawBatch only supports independent primitives" );
+    }
+    m_mode = mode;
+    setLimit();
+}
+
+
+void GL::DrawBatch::end()
+{
+    draw();
+}
+
+
+/// The batch may only split where a primitive ends
+void GL::DrawBatch::setLimit()
+{
+    const size_t room = m_segment_size - m_first;
+    m_limit = m_first + room - room % m_vertices_per_primitive;
+}
+
+
+//
+// Draw the vertices written since the last draw.  The persistent buffer
+// keeps filling the same segment; the staging copy is uploaded and reused.
+//
+void GL::DrawBatch::draw()
+{
+    const size_t count = m_count - m_first;
+    if( count == 0 )
+        return;
+
+    GL::BindBuffer( GL_ARRAY_BUFFER, m_buffer );
+
+    size_t offset = 0;
+    if( m_mapped )
+        offset = ( m_segment*m_segment_size + m_first ) * sizeof( Vertex );
+    else
+        GL::BufferData( GL_ARRAY_BUFFER, count*sizeof( Vertex ), &m_staging[ m_first ], GL_STREAM_DRAW );
+
+    const char* base = reinterpret_cast<const char*>( offset );
+    GL::VertexPointer(   3, GL_FLOAT, sizeof( Vertex ), base + offsetof( Vertex, x ) );
+    GL::TexCoordPointer( 2, GL_FLOAT, sizeof( Vertex ), base + offsetof( Vertex, s ) );
+    GL::EnableClientState( GL_VERTEX_ARRAY );
+    GL::EnableClientState( GL_TEXTURE_COORD_ARRAY );
+    GL::DrawArrays( m_mode, 0, static_cast<GLsizei>( count ) );
+    GL::DisableClientState( GL_TEXTURE_COORD_ARRAY );
+    GL::DisableClientState( GL_VERTEX_ARRAY );
+
+    GL::BindBuffer( GL_ARRAY_BUFFER, 0 );
+    ++m_num_draws;
+
+    if( m_mapped )
+        m_first = m_count;
+    else
+        m_first = m_count = 0;
+    setLimit();
+}
+
+
+//
+// The segment is full: draw it, fence it and move on to the next, waiting
+// for the GPU to finish with that one first
+//
+void GL::DrawBatch::wrap()
+{
+    draw();
+    if( !m_mapped )
+        return;
+
+    m_fences[ m_segment ] = GL::FenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    m_segment = ( m_segment + 1 ) % NUM_SEGMENTS;
+
+    if( GLsync fence = m_fences[ m_segment ] )
+    {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for( ;; )
+        {
+            const GLenum status = GL::ClientWaitSync( fence, flags, 1000000000u );
+            if( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED )
+                break;
+            if( status == GL_WAIT_FAILED )
+                throw legion::AssertionFailure( "GL::DrawBatch fence wait failed" );
+            flags = 0;
+        }
+        GL::DeleteSync( fence );
+        m_fences[ m_segment ] = 0;
+    }
+
+    m_vertices = m_mapped + m_segment*m_segment_size;
+    m_first    = 0;
+    m_count    = 0;
+    setLimit();
 }
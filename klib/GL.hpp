@@ -26,10 +26,15 @@
 #include <Legion/Common/Util/SharedObject.hpp>
 #include <Legion/Common/Util/Singleton.hpp>
 
+#include <cstddef>
+#include <vector>
+
 #ifdef __APPLE__
 #    include <OpenGL/gl.h>
+#    include <OpenGL/glext.h>
 #else
 #    include <GL/gl.h>
+#    include <GL/glext.h>
 #endif
 
 
@@ -42,12 +47,19 @@ class LCLASSAPI GL : public Singleton<GL>
     friend class Singleton<GL>;
 
 public:
+    class DrawBatch;
+
     LAPI ~GL();
 
     static void   checkError();
 
+    /// True if the context supports persistently mapped buffers (GL 4.4 or
+    /// ARB_buffer_storage)
+    LAPI static bool hasBufferStorage();
+
     // GL API entries
     LAPI static GLenum GetError();
+    LAPI static const GLubyte* GetString( GLenum name );
 
     LAPI static void GenTextures( GLsizei n, GLuint* ids );
     LAPI static void TexParameteri( GLenum target, GLenum pname, GLint param );
@@ -68,6 +80,20 @@ public:
     LAPI static void GenBuffers( GLsizei n, GLuint* ids );
     LAPI static void BindBuffer( GLenum target, GLuint buffer );
     LAPI static void BufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage );
+    LAPI static void DeleteBuffers( GLsizei n, const GLuint* ids );
+    LAPI static void BufferStorage( GLenum target, GLsizeiptr size, const GLvoid* data, GLbitfield flags );
+    LAPI static void* MapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+    LAPI static GLboolean UnmapBuffer( GLenum target );
+
+    LAPI static GLsync FenceSync( GLenum condition, GLbitfield flags );
+    LAPI static GLenum ClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout );
+    LAPI static void DeleteSync( GLsync sync );
+
+    LAPI static void EnableClientState( GLenum array );
+    LAPI static void DisableClientState( GLenum array );
+    LAPI static void VertexPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+    LAPI static void TexCoordPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+    LAPI static void DrawArrays( GLenum mode, GLint first, GLsizei count );
 
     LAPI static void Enable( GLenum cap );
     LAPI static void Disable( GLenum cap );
@@ -78,6 +104,7 @@ public:
 
 private:
     typedef GLenum ( *glGetError_t   )();
+    typedef const GLubyte* ( *glGetString_t )( GLenum name );
 
     typedef void ( *glGenTextures_t )( GLsizei n, GLuint* ids );
     typedef void ( *glTexParameteri_t )( GLenum target, GLenum pname, GLint param );
@@ -98,6 +125,20 @@ private:
     typedef void ( *glGenBuffers_t )( GLsizei n, GLuint* ids );
     typedef void ( *glBindBuffer_t )( GLenum target, GLuint buffer );
     typedef void ( *glBufferData_t )( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage );
+    typedef void ( *glDeleteBuffers_t )( GLsizei n, const GLuint* ids );
+    typedef void ( *glBufferStorage_t )( GLenum target, GLsizeiptr size, const GLvoid* data, GLbitfield flags );
+    typedef void* ( *glMapBufferRange_t )( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+    typedef GLboolean ( *glUnmapBuffer_t )( GLenum target );
+
+    typedef GLsync ( *glFenceSync_t )( GLenum condition, GLbitfield flags );
+    typedef GLenum ( *glClientWaitSync_t )( GLsync sync, GLbitfield flags, GLuint64 timeout );
+    typedef void ( *glDeleteSync_t )( GLsync sync );
+
+    typedef void ( *glEnableClientState_t  )( GLenum array );
+    typedef void ( *glDisableClientState_t )( GLenum array );
+    typedef void ( *glVertexPointer_t   )( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+    typedef void ( *glTexCoordPointer_t )( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+    typedef void ( *glDrawArrays_t      )( GLenum mode, GLint first, GLsizei count );
 
     typedef void ( *glEnable_t     )( GLenum cap );
     typedef void ( *glDisable_t    )( GLenum cap );
@@ -108,6 +149,7 @@ private:
 
 
     glGetError_t        p_glGetError        = 0;
+    glGetString_t       p_glGetString       = 0;
 
     glGenTextures_t     p_glGenTextures     = 0;
     glTexParameteri_t   p_glTexParameteri   = 0;
@@ -118,6 +160,20 @@ private:
     glGenBuffers_t      p_glGenBuffers      = 0;
     glBindBuffer_t      p_glBindBuffer      = 0;
     glBufferData_t      p_glBufferData      = 0;
+    glDeleteBuffers_t   p_glDeleteBuffers   = 0;
+    glBufferStorage_t   p_glBufferStorage   = 0;
+    glMapBufferRange_t  p_glMapBufferRange  = 0;
+    glUnmapBuffer_t     p_glUnmapBuffer     = 0;
+
+    glFenceSync_t       p_glFenceSync       = 0;
+    glClientWaitSync_t  p_glClientWaitSync  = 0;
+    glDeleteSync_t      p_glDeleteSync      = 0;
+
+    glEnableClientState_t  p_glEnableClientState  = 0;
+    glDisableClientState_t p_glDisableClientState = 0;
+    glVertexPointer_t      p_glVertexPointer      = 0;
+    glTexCoordPointer_t    p_glTexCoordPointer    = 0;
+    glDrawArrays_t         p_glDrawArrays         = 0;
 
     glEnable_t          p_glEnable          = 0;
     glDisable_t         p_glDisable         = 0;
@@ -131,5 +187,87 @@ private:
     GL();
 };
 
+
+///
+/// Replacement for Begin/TexCoord2f/Vertex2f/End which writes vertices
+/// straight into a vertex buffer and draws each begin()/end() pair with a
+/// single DrawArrays, through the fixed function vertex arrays so existing
+/// state (textures, color, matrices) applies as before.
+///
+/// With buffer storage the buffer is mapped persistently once and used as a
+/// ring of segments, each fenced after its last draw and waited on before
+/// it is written again.  Otherwise vertices are staged in memory and
+/// uploaded per batch with an orphaning BufferData.
+///
+/// Only independent primitives (points, lines, triangles, quads) are
+/// supported, so a batch larger than a segment can be split between draws.
+///
+class LCLASSAPI GL::DrawBatch
+{
+public:
+    /// segment_size vertices are available to each batch before it splits.
+    /// persistent = false forces the staged path.
+    LAPI explicit DrawBatch( size_t segment_size = 1u << 16, bool persistent = true );
+    LAPI ~DrawBatch();
+
+    LAPI void begin( GLenum mode );
+    LAPI void end();
+
+    void texCoord2f( GLfloat s, GLfloat t )         { m_s = s; m_t = t; }
+    void vertex2f( GLfloat x, GLfloat y )           { vertex3f( x, y, 0.0f ); }
+    void vertex3f( GLfloat x, GLfloat y, GLfloat z );
+
+    bool     isPersistent()const                    { return m_mapped != 0; }
+    unsigned getNumDraws()const                     { return m_num_draws;  }
+
+private:
+    struct Vertex
+    {
+        GLfloat x, y, z;
+        GLfloat s, t;
+    };
+
+    static const unsigned NUM_SEGMENTS = 3;
+
+    DrawBatch( const DrawBatch& );
+    DrawBatch& operator=( const DrawBatch& );
+
+    LAPI void wrap();
+    void      draw();
+    void      setLimit();
+
+    GLuint              m_buffer;
+    Vertex*             m_mapped;          ///< Persistent mapping, or null
+    std::vector<Vertex> m_staging;         ///< Fallback storage
+    GLsync              m_fences[ NUM_SEGMENTS ];
+
+    size_t              m_segment_size;
+    unsigned            m_segment;
+    Vertex*             m_vertices;        ///< Start of the current segment
+    size_t              m_first;           ///< First vertex of this draw
+    size_t              m_count;           ///< Vertices used in segment
+    size_t              m_limit;           ///< Split point for this mode
+
+    GLenum              m_mode;
+    unsigned            m_vertices_per_primitive;
+    GLfloat             m_s;
+    GLfloat             m_t;
+    unsigned            m_num_draws;
+};
+
+
+inline void GL::DrawBatch::vertex3f( GLfloat x, GLfloat y, GLfloat z )
+{
+    if( m_count == m_limit )
+        wrap();
+
+    Vertex& v = m_vertices[ m_count++ ];
+    v.x = x;
+    v.y = y;
+    v.z = z;
+    v.s = m_s;
+    v.t = m_t;
+}
+
 }
 
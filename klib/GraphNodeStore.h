@@ -0,0 +1,164 @@
+#ifndef KLIB_GRAPH_NODE_STORE_H_
+#define KLIB_GRAPH_NODE_STORE_H_
+
+//
+// Bookkeeping for per-node search records (AStar::Node et al) keyed by
+// Graph::Node.  Two implementations with identical interfaces:
+//
+// SparseNodeStore
+//     - Works with any Graph.  Records live in a std::map keyed by
+//       Graph::Node.  Map nodes are recycled through a FreeListPool so a
+//       store which is cleared and refilled stops allocating once it reaches
+//       its high water mark
+//
+// DenseNodeStore
+//     - Requires the optional dense index trait on Graph:
+//
+//       unsigned Graph::index( const Graph::Node& node )const
+//           - returns a unique index in [0, numNodes())
+//
+//       unsigned Graph::numNodes()const
+//
+//     - Records live in a flat array indexed by Graph::index().  Each slot is
+//       stamped with the generation it was written in, so clear() is O(1):
+//       bumping the generation invalidates every record at once.
+//
+// Record
+//     - Must be default constructible, copyable and assignable
+//     - Record addresses are stable until clear()
+//
+// Use NodeStoreSelector<Graph, Record>::Type to pick the dense store when
+// Graph provides the index trait and the sparse store otherwise.
+//
+
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "FreeListPool.h"
+
+
+template <typename Graph, typename Record>
+class SparseNodeStore
+{
+public:
+    typedef typename Graph::Node GraphNode;
+
+    explicit SparseNodeStore( const Graph& )
+        : m_records( std::less<GraphNode>(), Allocator( &m_pool ) )
+    {
+    }
+
+    /// Returns the record for graph_node, or 0 if not yet created
+    Record* find( const GraphNode& graph_node )
+    {
+        typename GraphNodeToRecord::iterator it = m_records.find( graph_node );
+        return it == m_records.end() ? 0 : &it->second;
+    }
+
+    /// Create a record for graph_node, which must not already have one
+    Record* create( const GraphNode& graph_node, const Record& record )
+    {
+        return &m_records.insert( std::make_pair( graph_node, record ) ).first->second;
+    }
+
+    unsigned size()const  { return m_records.size(); }
+
+    void clear()          { m_records.clear(); }
+
+private:
+    SparseNodeStore( const SparseNodeStore& );
+    SparseNodeStore& operator=( const SparseNodeStore& );
+
+    typedef PoolAllocator< std::pair<const GraphNode, Record> > Allocator;
+    typedef std::map<GraphNode, Record, std::less<GraphNode>, Allocator>
+                                                      GraphNodeToRecord;
+
+    FreeListPool      m_pool;     ///< Must precede m_records
+    GraphNodeToRecord m_records;
+};
+
+
+template <typename Graph, typename Record>
+class DenseNodeStore
+{
+public:
+    typedef typename Graph::Node GraphNode;
+
+    explicit DenseNodeStore( const Graph& graph )
+        : m_graph( graph ),
+          m_records( graph.numNodes() ),
+          m_generations( graph.numNodes(), 0u ),
+          m_generation( 1u ),
+          m_size( 0u )
+    {
+    }
+
+    Record* find( const GraphNode& graph_node )
+    {
+        const unsigned index = m_graph.index( graph_node );
+        return m_generations[ index ] == m_generation ? &m_records[ index ] : 0;
+    }
+
+    Record* create( const GraphNode& graph_node, const Record& record )
+    {
+        const unsigned index = m_graph.index( graph_node );
+        m_records[ index ]     = record;
+        m_generations[ index ] = m_generation;
+        ++m_size;
+        return &m_records[ index ];
+    }
+
+    unsigned size()const  { return m_size; }
+
+    void clear()
+    {
+        m_size = 0u;
+        if( ++m_generation == 0u )
+        {
+            // Stamps wrapped -- pay for a real clear once every 2^32 searches
+            std::fill( m_generations.begin(), m_generations.end(), 0u );
+            m_generation = 1u;
+        }
+    }
+
+private:
+    DenseNodeStore( const DenseNodeStore& );
+    DenseNodeStore& operator=( const DenseNodeStore& );
+
+    const Graph&          m_graph;
+    std::vector<Record>   m_records;
+    std::vector<unsigned> m_generations;  ///< Stamp per slot, valid if current
+    unsigned              m_generation;
+    unsigned              m_size;
+};
+
+
+/// Detects the optional Graph::index()/Graph::numNodes() trait
+template <typename Graph, typename Enable = void>
+struct HasDenseIndex : std::false_type {};
+
+template <typename Graph>
+struct HasDenseIndex<
+    Graph,
+    decltype( (void)std::declval<const Graph&>().index(
+                  std::declval<const typename Graph::Node&>() ),
+              (void)std::declval<const Graph&>().numNodes() ) >
+    : std::true_type {};
+
+
+template <typename Graph, typename Record>
+struct NodeStoreSelector
+{
+    typedef typename std::conditional< HasDenseIndex<Graph>::value,
+                                       DenseNodeStore<Graph, Record>,
+                                       SparseNodeStore<Graph, Record>
+                                     >::type Type;
+};
+
+
+#endif // KLIB_GRAPH_NODE_STORE_H_
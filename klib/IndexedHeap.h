@@ -0,0 +1,178 @@
+#ifndef KLIB_INDEXED_HEAP_H_
+#define KLIB_INDEXED_HEAP_H_
+
+//
+// Addressable binary heap of pointers.  Each element records its own position
+// in the heap which allows O(log n) decrease-key via update() and O(1)
+// membership tests via contains().
+//
+// T
+//     - Must have an unsigned data member named heap_index.  It is owned by
+//       the heap while the element is in the heap.
+//
+// Compare
+//     - Same semantics as the comparator for std::push_heap et al:
+//       Compare( a, b ) returns true if a should sit below b in the heap.  Use
+//       a 'greater than' comparison to get a min-heap.
+//
+
+
+#include <cassert>
+#include <vector>
+
+
+template <typename T, typename Compare>
+class IndexedHeap
+{
+public:
+    static const unsigned INVALID_INDEX = ~0u;
+
+    IndexedHeap() {}
+    explicit IndexedHeap( Compare compare ) : m_compare( compare ) {}
+
+    bool     empty()const   { return m_heap.empty(); }
+    unsigned size()const    { return m_heap.size();  }
+
+    /// Remove all elements.  Storage is retained for reuse.
+    void clear();
+
+    /// Reserve storage for n elements
+    void reserve( unsigned n )  { m_heap.reserve( n ); }
+
+    T*   top()const             { assert( !empty() ); return m_heap.front(); }
+
+    void push( T* elem );
+    T*   pop();
+
+    /// Restore heap order after elem's key has changed
+    void update( T* elem );
+
+    /// Remove elem, which must be in the heap
+    void remove( T* elem );
+
+    bool contains( const T* elem )const
+    {
+        return elem->heap_index < m_heap.size() &&
+               m_heap[ elem->heap_index ] == elem;
+    }
+
+private:
+    void siftUp( unsigned index );
+    void siftDown( unsigned index );
+
+    void place( T* elem, unsigned index )
+    {
+        m_heap[ index ]   = elem;
+        elem->heap_index  = index;
+    }
+
+    std::vector<T*> m_heap;
+    Compare         m_compare;
+};
+
+
+template <typename T, typename Compare>
+void IndexedHeap<T, Compare>::clear()
+{
+    for( unsigned i = 0; i < m_heap.size(); ++i )
+        m_heap[ i ]->heap_index = INVALID_INDEX;
+    m_heap.clear();
+}
+
+
+template <typename T, typename Compare>
+void IndexedHeap<T, Compare>::push( T* elem )
+{
+    m_heap.push_back( elem );
+    elem->heap_index = m_heap.size() - 1;
+    siftUp( elem->heap_index );
+}
+
+
+template <typename T, typename Compare>
+T* IndexedHeap<T, Compare>::pop()
+{
+    assert( !empty() );
+
+    T* result = m_heap.front();
+    T* last   = m_heap.back();
+    m_heap.pop_back();
+
+    if( !m_heap.empty() )
+    {
+        place( last, 0 );
+        siftDown( 0 );
+    }
+
+    result->heap_index = INVALID_INDEX;
+    return result;
+}
+
+
+template <typename T, typename Compare>
+void IndexedHeap<T, Compare>::update( T* elem )
+{
+    assert( contains( elem ) );
+    siftUp( elem->heap_index );
+    siftDown( elem->heap_index );
+}
+
+
+template <typename T, typename Compare>
+void IndexedHeap<T, Compare>::remove( T* elem )
+{
+    assert( contains( elem ) );
+
+    const unsigned index = elem->heap_index;
+    T* last = m_heap.back();
+    m_heap.pop_back();
+
+    if( last != elem )
+    {
+        place( last, index );
+        siftUp( index );
+        siftDown( last->heap_index );
+    }
+
+    elem->heap_index = INVALID_INDEX;
+}
+
+
+template <typename T, typename Compare>
+void IndexedHeap<T, Compare>::siftUp( unsigned index )
+{
+    T* elem = m_heap[ index ];
+    while( index > 0 )
+    {
+        const unsigned parent = ( index - 1 ) / 2;
+        if( !m_compare( m_heap[ parent ], elem ) )
+            break;
+        place( m_heap[ parent ], index );
+        index = parent;
+    }
+    place( elem, index );
+}
+
+
+template <typename T, typename Compare>
+void IndexedHeap<T, Compare>::siftDown( unsigned index )
+{
+    const unsigned size = m_heap.size();
+    T* elem = m_heap[ index ];
+    for( ;; )
+    {
+        unsigned child = 2*index + 1;
+        if( child >= size )
+            break;
+        if( child + 1 < size && m_compare( m_heap[ child ], m_heap[ child+1 ] ) )
+            ++child;
+        if( !m_compare( elem, m_heap[ child ] ) )
+            break;
+        place( m_heap[ child ], index );
+        index = child;
+    }
+    place( elem, index );
+}
+
+
+#endif // KLIB_INDEXED_HEAP_H_
@@ -0,0 +1,350 @@
+#ifndef KLIB_JUMP_POINT_SEARCH_H_
+#define KLIB_JUMP_POINT_SEARCH_H_
+
+//
+// Jump point search for 4-connected, uniform cost grids.  Finds paths with
+// the same cost as AStarContext on the same graph while expanding only jump
+// points -- cells where an optimal path may have to turn -- instead of every
+// cell on the way.
+//
+// Uses the horizontal-first canonical ordering: a path may turn from
+// horizontal to vertical anywhere, but from vertical to horizontal only where
+// an obstacle forces it.  Horizontal jumps therefore probe vertically from
+// every cell they cross, much as diagonal jumps do in the 8-connected
+// formulation.
+//
+// GridGraph
+//     - Must have Graph::Node typename
+//     - Must implement
+//
+//       int  Graph::width()const
+//       int  Graph::height()const
+//
+//       bool Graph::isPassable( int x, int y )const
+//           - must return false for coordinates outside the grid
+//
+//     - Every move between 4-adjacent passable cells costs 1
+//
+// Graph::Node
+//     - Must be constructible from ( int x, int y ) and expose int members
+//       x and y
+//
+// Usage matches AStarContext: construct once per graph, then call search()
+// and getPath() repeatedly.  getPath() returns every cell on the path, not
+// just the jump points.
+//
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "GraphNodeStore.h"
+#include "IndexedHeap.h"
+#include "Logger.h"
+
+
+template <typename Graph>
+class JumpPointSearch
+{
+public:
+    typedef typename Graph::Node       GraphNode;
+    typedef std::vector<GraphNode>     GraphNodeVec;
+
+    explicit JumpPointSearch( const Graph& graph );
+
+    /// Find a path from origin to destination.  Returns false if none exists.
+    bool search( const GraphNode& origin, const GraphNode& destination );
+
+    /// Append path from the origin (exclusive) to the destination (inclusive)
+    void getPath( GraphNodeVec& path )const;
+
+    /// Cost of the path found by the last search, FLT_MAX if none was found
+    float getPathCost()const
+    { return m_destination_node ? m_destination_node->g : std::numeric_limits<float>::max(); }
+
+    /// Number of jump points expanded by the last search
+    int getNumSteps()const    { return m_steps;   }
+
+    /// Number of decrease-key operations by the last search
+    int getNumUpdates()const  { return m_updates; }
+
+private:
+    //
+    // Uncopyable
+    //
+    JumpPointSearch( const JumpPointSearch& );
+    JumpPointSearch& operator=( const JumpPointSearch& );
+
+    //
+    // A jump point in the search.
+    //
+    struct Node
+    {
+        Node() : x( 0 ), y( 0 ), g( 0.0f ), h( 0.0f ), prev( 0 ), heap_index( ~0u ) {}
+
+        Node( int x, int y, float g, float h, Node* prev )
+            : x( x ), y( y ), g( g ), h( h ), prev( prev ), heap_index( ~0u ) {}
+
+        float f()const { return g+h; }
+
+        int   x, y;
+        float g;
+        float h;
+        Node* prev;
+        unsigned heap_index;  ///< Position in open heap, owned by IndexedHeap
+    };
+
+    /// For heap sorting our open set
+    struct HeapCompare
+    {
+        bool operator()( const Node* n0, const Node* n1 )const
+        {
+            return ( n0->f() >  n1->f() ) ||
+                   ( n0->f() == n1->f() && n0->h > n1->h );
+        }
+    };
+
+    /// Provides the dense index trait over grid coordinates for the store
+    struct GridIndex
+    {
+        typedef GraphNode Node;
+
+        explicit GridIndex( const Graph& graph ) : graph( graph ) {}
+
+        unsigned index( const GraphNode& node )const
+        { return node.y*graph.width() + node.x; }
+
+        unsigned numNodes()const
+        { return graph.width()*graph.height(); }
+
+        const Graph& graph;
+    };
+
+
+    bool passable( int x, int y )const { return m_graph.isPassable( x, y ); }
+
+    bool isDestination( int x, int y )const
+    { return x == m_destination.x && y == m_destination.y; }
+
+    float heuristic( int x, int y )const
+    {
+        return static_cast<float>( abs( x - m_destination.x ) +
+                                   abs( y - m_destination.y ) );
+    }
+
+    bool jumpHorizontal( int x, int y, int dx, int& jx )const;
+    bool jumpVertical  ( int x, int y, int dy, int& jy )const;
+
+    void expand( Node* current );
+    void addJumpPoint( Node* current, int x, int y );
+
+
+    typedef IndexedHeap<Node, HeapCompare>   NodeHeap;
+    typedef DenseNodeStore<GridIndex, Node>  NodeStore;
+
+    const Graph&   m_graph;
+    GridIndex      m_grid_index;  ///< Must precede m_nodes
+    NodeHeap       m_open_heap;
+    NodeStore      m_nodes;
+
+    GraphNode      m_destination;
+    Node*          m_destination_node;
+
+    int            m_steps;
+    int            m_updates;
+};
+
+
+template <typename Graph>
+JumpPointSearch<Graph>::JumpPointSearch( const Graph& graph )
+    : m_graph( graph ),
+      m_grid_index( graph ),
+      m_nodes( m_grid_index ),
+      m_destination_node( 0 ),
+      m_steps( 0 ),
+      m_updates( 0 )
+{
+}
+
+
+template <typename Graph>
+bool JumpPointSearch<Graph>::search( const GraphNode& origin,
+                                     const GraphNode& destination )
+{
+    m_open_heap.clear();
+    m_nodes.clear();
+    m_destination      = destination;
+    m_destination_node = 0;
+    m_steps            = 0;
+    m_updates          = 0;
+
+    Node* node = m_nodes.create( origin, Node( origin.x, origin.y, 0.0f,
+                                               heuristic( origin.x, origin.y ),
+                                               0 ) );
+    m_open_heap.push( node );
+
+    while( !m_open_heap.empty() )
+    {
+        m_steps++;
+        Node* current = m_open_heap.pop();
+
+        if( isDestination( current->x, current->y ) )
+        {
+            m_destination_node = current;
+            KLOG( Log::DEBUG ) << "FOUND GOAL.  Steps   : " << m_steps;
+            KLOG( Log::DEBUG ) << "             path len: " << current->g;
+            return true;
+        }
+
+        expand( current );
+    }
+    return false;
+}
+
+
+//
+// Scan from ( x, y ) in direction dx.  Stops at the destination or at a cell
+// from which a vertical jump finds something.  Returns false if the scan runs
+// into a wall first.
+//
+template <typename Graph>
+bool JumpPointSearch<Graph>::jumpHorizontal( int x, int y, int dx, int& jx )const
+{
+    for( ;; )
+    {
+        x += dx;
+        if( !passable( x, y ) )
+            return false;
+
+        int jy;
+        if( isDestination( x, y )           ||
+            jumpVertical( x, y, +1, jy )    ||
+            jumpVertical( x, y, -1, jy ) )
+        {
+            jx = x;
+            return true;
+        }
+    }
+}
+
+
+//
+// Scan from ( x, y ) in direction dy.  Stops at the destination or at a cell
+// with a forced horizontal neighbor: one that is open while the cell behind
+// it (against dy) is blocked, so no horizontal-first path could reach it.
+//
+template <typename Graph>
+bool JumpPointSearch<Graph>::jumpVertical( int x, int y, int dy, int& jy )const
+{
+    for( ;; )
+    {
+        y += dy;
+        if( !passable( x, y ) )
+            return false;
+
+        if( isDestination( x, y ) ||
+            ( passable( x-1, y ) && !passable( x-1, y-dy ) ) ||
+            ( passable( x+1, y ) && !passable( x+1, y-dy ) ) )
+        {
+            jy = y;
+            return true;
+        }
+    }
+}
+
+
+template <typename Graph>
+void JumpPointSearch<Graph>::expand( Node* current )
+{
+    const int x = current->x;
+    const int y = current->y;
+
+    // Direction of travel into this node, ( 0, 0 ) at the origin
+    int dx = 0;
+    int dy = 0;
+    if( current->prev )
+    {
+        dx = ( x > current->prev->x ) - ( x < current->prev->x );
+        dy = ( y > current->prev->y ) - ( y < current->prev->y );
+    }
+
+    int jx, jy;
+    if( dy == 0 )
+    {
+        //
+        // Arrived horizontally (or origin): keep going, or turn vertical
+        //
+        if( dx >= 0 && jumpHorizontal( x, y, +1, jx ) ) addJumpPoint( current, jx, y );
+        if( dx <= 0 && jumpHorizontal( x, y, -1, jx ) ) addJumpPoint( current, jx, y );
+        if( jumpVertical( x, y, +1, jy ) ) addJumpPoint( current, x, jy );
+        if( jumpVertical( x, y, -1, jy ) ) addJumpPoint( current, x, jy );
+    }
+    else
+    {
+        //
+        // Arrived vertically: keep going, or turn horizontal where forced
+        //
+        if( jumpVertical( x, y, dy, jy ) ) addJumpPoint( current, x, jy );
+
+        if( passable( x-1, y ) && !passable( x-1, y-dy ) &&
+            jumpHorizontal( x, y, -1, jx ) )
+            addJumpPoint( current, jx, y );
+
+        if( passable( x+1, y ) && !passable( x+1, y-dy ) &&
+            jumpHorizontal( x, y, +1, jx ) )
+            addJumpPoint( current, jx, y );
+    }
+}
+
+
+template <typename Graph>
+void JumpPointSearch<Graph>::addJumpPoint( Node* current, int x, int y )
+{
+    const float g = current->g +
+                    static_cast<float>( abs( x - current->x ) + abs( y - current->y ) );
+
+    const GraphNode graph_node( x, y );
+    Node* node = m_nodes.find( graph_node );
+    if( node )
+    {
+        if( m_open_heap.contains( node ) && g < node->g )
+        {
+            m_updates++;
+            node->g    = g;
+            node->prev = current;
+            m_open_heap.update( node );
+        }
+        return;
+    }
+
+    node = m_nodes.create( graph_node, Node( x, y, g, heuristic( x, y ), current ) );
+    m_open_heap.push( node );
+}
+
+
+template <typename Graph>
+void JumpPointSearch<Graph>::getPath( GraphNodeVec& path )const
+{
+    if( !m_destination_node )
+        return;
+
+    //
+    // Walk back over the jump points, filling in the straight segments
+    //
+    const size_t begin = path.size();
+    for( Node* current = m_destination_node; current->prev != 0; current = current->prev )
+    {
+        const Node* prev = current->prev;
+        const int dx = ( prev->x > current->x ) - ( prev->x < current->x );
+        const int dy = ( prev->y > current->y ) - ( prev->y < current->y );
+        for( int x = current->x, y = current->y; x != prev->x || y != prev->y; x += dx, y += dy )
+            path.push_back( GraphNode( x, y ) );
+    }
+
+    std::reverse( path.begin() + begin, path.end() );
+}
+
+
+#endif // KLIB_JUMP_POINT_SEARCH_H_
@@ -0,0 +1,361 @@
+
+#ifndef KLIB_LATENCY_HISTOGRAM_H_
+#define KLIB_LATENCY_HISTOGRAM_H_
+
+//
+// Log-bucketed (HDR style) histogram of durations, for tail latencies such
+// as worst-case turn times rather than averages.
+//
+// Usage:
+//   LatencyHistogram turn_times( "turn", 0.5 );   // 500 ms budget
+//   turn_times.printAtExit();
+//   ...
+//   {
+//       AutoTimerRef<LatencyHistogram> timer( turn_times );
+//       ...
+//   }
+//
+//   - Samples are kept in nanoseconds in buckets which split each power of
+//     two into 128 linear steps, so percentiles are within 0.4% of the true
+//     value; min, max, mean and the count over budget are exact
+//   - Recording is a handful of integer ops and not thread safe.  Give each
+//     thread its own histogram and merge() them
+//   - printAtExit() prints the histogram when it is destroyed or, for
+//     statics, at process exit, whichever comes first
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+
+class LatencyHistogram
+{
+public:
+    /// Budget in seconds; samples over it are counted separately if non-zero
+    explicit LatencyHistogram( const std::string& name = "", double budget = 0.0 );
+    LatencyHistogram( const LatencyHistogram& other );
+    ~LatencyHistogram();
+
+    LatencyHistogram& operator=( const LatencyHistogram& other );
+
+    /// Record a duration in seconds.  Lets AutoTimer/AutoTimerRef feed it.
+    void operator()( double seconds )        { record( seconds ); }
+
+    void record( double seconds );
+    void recordNanoseconds( uint64_t nanoseconds );
+
+    /// Add other's samples.  Over budget counts are taken as recorded, so
+    /// merged histograms should share a budget.
+    void merge( const LatencyHistogram& other );
+    void reset();
+
+    const std::string& getName()const        { return m_name;        }
+    double             getBudget()const      { return m_budget;      }
+    uint64_t           getCount()const       { return m_count;       }
+    uint64_t           getNumOverBudget()const { return m_over_budget; }
+
+    /// Seconds
+    double getMin()const;
+    double getMax()const;
+    double getMean()const;
+
+    /// Duration in seconds below which percent of the samples fall
+    double getPercentile( double percent )const;
+
+    /// One line: count, mean, p50, p90, p99, p99.9, max and over budget
+    void print( std::ostream& out )const;
+
+    /// Print to out when destroyed or at exit
+    void printAtExit( std::ostream& out = std::cerr );
+
+private:
+    static const unsigned SUB_BITS    = 8;
+    static const unsigned HALF_COUNT  = 1u << ( SUB_BITS-1 );
+    static const unsigned MAX_BITS    = 40;   // About 18 minutes
+    static const unsigned NUM_BUCKETS = ( MAX_BITS-SUB_BITS+2 ) * HALF_COUNT;
+
+    static unsigned bucket( uint64_t value );
+    static uint64_t bucketLow( unsigned index );
+    static uint64_t bucketWidth( unsigned index );
+
+    struct ExitReport
+    {
+        ~ExitReport();
+
+        std::mutex                      mutex;
+        std::vector<LatencyHistogram*>  histograms;
+    };
+    static ExitReport& exitReport();
+
+    std::string            m_name;
+    double                 m_budget;
+    uint64_t               m_budget_ns;
+    std::vector<uint64_t>  m_counts;
+    uint64_t               m_count;
+    uint64_t               m_over_budget;
+    uint64_t               m_total;
+    uint64_t               m_min;
+    uint64_t               m_max;
+    std::ostream*          m_exit_stream;
+};
+
+
+inline LatencyHistogram::LatencyHistogram( const std::string& name, double budget )
+    : m_name( name ),
+      m_budget( budget ),
+      m_budget_ns( static_cast<uint64_t>( budget*1.0e9 ) ),
+      m_counts( NUM_BUCKETS, 0u ),
+      m_count( 0 ),
+      m_over_budget( 0 ),
+      m_total( 0 ),
+      m_min( 0 ),
+      m_max( 0 ),
+      m_exit_stream( 0 )
+{
+}
+
+
+/// Copies are not printed at exit
+inline LatencyHistogram::LatencyHistogram( const LatencyHistogram& other )
+    : m_name( other.m_name ),
+      m_budget( other.m_budget ),
+      m_budget_ns( other.m_budget_ns ),
+      m_counts( other.m_counts ),
+      m_count( other.m_count ),
+      m_over_budget( other.m_over_budget ),
+      m_total( other.m_total ),
+      m_min( other.m_min ),
+      m_max( other.m_max ),
+      m_exit_stream( 0 )
+{
+}
+
+
+inline LatencyHistogram::~LatencyHistogram()
+{
+    if( !m_exit_stream )
+        return;
+
+    ExitReport& report = exitReport();
+    {
+        std::lock_guard<std::mutex> lock( report.mutex );
+        report.histograms.erase( std::remove( report.histograms.begin(),
+                                              report.histograms.end(), this ),
+                                 report.histograms.end() );
+    }
+    print( *m_exit_stream );
+}
+
+
+inline LatencyHistogram& LatencyHistogram::operator=( const LatencyHistogram& other )
+{
+    m_name        = other.m_name;
+    m_budget      = other.m_budget;
+    m_budget_ns   = other.m_budget_ns;
+    m_counts      = other.m_counts;
+    m_count       = other.m_count;
+    m_over_budget = other.m_over_budget;
+    m_total       = other.m_total;
+    m_min         = other.m_min;
+    m_max         = other.m_max;
+    return *this;
+}
+
+
+inline void LatencyHistogram::record( double seconds )
+{
+    recordNanoseconds( seconds > 0.0 ? static_cast<uint64_t>( seconds*1.0e9 + 0.5 ) : 0u );
+}
+
+
+inline void LatencyHistogram::recordNanoseconds( uint64_t value )
+{
+    ++m_counts[ bucket( value ) ];
+    if( m_count == 0 || value < m_min )
+        m_min = value;
+    if( value > m_max )
+        m_max = value;
+    if( m_budget_ns != 0 && value > m_budget_ns )
+        ++m_over_budget;
+    m_total += value;
+    ++m_count;
+}
+
+
+inline void LatencyHistogram::merge( const LatencyHistogram& other )
+{
+    if( other.m_count == 0 )
+        return;
+
+    for( unsigned i = 0; i < NUM_BUCKETS; ++i )
+        m_counts[ i ] += other.m_counts[ i ];
+    m_min          = m_count == 0 ? other.m_min : std::min( m_min, other.m_min );
+    m_max          = std::max( m_max, other.m_max );
+    m_count       += other.m_count;
+    m_over_budget += other.m_over_budget;
+    m_total       += other.m_total;
+}
+
+
+inline void LatencyHistogram::reset()
+{
+    std::fill( m_counts.begin(), m_counts.end(), 0u );
+    m_count       = 0;
+    m_over_budget = 0;
+    m_total       = 0;
+    m_min         = 0;
+    m_max         = 0;
+}
+
+
+inline double LatencyHistogram::getMin()const
+{
+    return m_min*1.0e-9;
+}
+
+
+inline double LatencyHistogram::getMax()const
+{
+    return m_max*1.0e-9;
+}
+
+
+inline double LatencyHistogram::getMean()const
+{
+    return m_count == 0 ? 0.0 : m_total*1.0e-9 / m_count;
+}
+
+
+/// Middle of the bucket holding the sample of that rank, clamped to the
+/// exact extremes
+inline double LatencyHistogram::getPercentile( double percent )const
+{
+    if( m_count == 0 )
+        return 0.0;
+
+    const double   fraction = std::min( std::max( percent, 0.0 ), 100.0 ) / 100.0;
+    const uint64_t rank     = std::max<uint64_t>(
+        1u, static_cast<uint64_t>( std::ceil( fraction*m_count ) ) );
+
+    uint64_t seen = 0;
+    for( unsigned i = 0; i < NUM_BUCKETS; ++i )
+    {
+        seen += m_counts[ i ];
+        if( seen >= rank )
+        {
+            const uint64_t value = bucketLow( i ) + bucketWidth( i )/2;
+            return std::min( std::max( value, m_min ), m_max )*1.0e-9;
+        }
+    }
+    return getMax();
+}
+
+
+inline void LatencyHistogram::print( std::ostream& out )const
+{
+    // Unit by the median, so the tail doesn't round the body away
+    const double median = getPercentile( 50.0 );
+    const double scale  = median >= 1.0    ? 1.0    :
+                          median >= 1.0e-3 ? 1.0e3  :
+                          median >= 1.0e-6 ? 1.0e6  : 1.0e9;
+    const char*  unit  = scale == 1.0   ? "s"  :
+                         scale == 1.0e3 ? "ms" :
+                         scale == 1.0e6 ? "us" : "ns";
+
+    const std::ios_base::fmtflags flags     = out.flags();
+    const std::streamsize         precision = out.precision();
+    out << std::fixed << std::setprecision( 3 )
+        << ( m_name.empty() ? "latency" : m_name ) << ": "
+        << m_count << " samples"
+        << "  mean "  << getMean()*scale
+        << "  p50 "   << getPercentile( 50.0 )*scale
+        << "  p90 "   << getPercentile( 90.0 )*scale
+        << "  p99 "   << getPercentile( 99.0 )*scale
+        << "  p99.9 " << getPercentile( 99.9 )*scale
+        << "  max "   << getMax()*scale << " " << unit;
+    if( m_budget > 0.0 )
+        out << "  over " << m_budget*scale << " " << unit << " budget: "
+            << m_over_budget << std::setprecision( 2 ) << " ("
+            << ( m_count ? 100.0*m_over_budget / m_count : 0.0 ) << "%)";
+    out << std::endl;
+    out.flags( flags );
+    out.precision( precision );
+}
+
+
+inline void LatencyHistogram::printAtExit( std::ostream& out )
+{
+    ExitReport& report = exitReport();
+    std::lock_guard<std::mutex> lock( report.mutex );
+    if( !m_exit_stream )
+        report.histograms.push_back( this );
+    m_exit_stream = &out;
+}
+
+
+//
+// Value v >= 2^SUB_BITS goes in row shift = msb( v ) - SUB_BITS + 1 at column
+// v >> shift, which lies in [HALF_COUNT, 2*HALF_COUNT).  Smaller values are
+// exact, in row 0.
+//
+inline unsigned LatencyHistogram::bucket( uint64_t value )
+{
+    value = std::min<uint64_t>( value, ( uint64_t( 1 ) << MAX_BITS ) - 1 );
+
+    unsigned msb = 0;
+#if defined( __GNUC__ )
+    msb = value ? 63 - __builtin_clzll( value ) : 0;
+#else
+    for( uint64_t v = value; v >>= 1; )
+        ++msb;
+#endif
+    const unsigned shift = msb < SUB_BITS ? 0 : msb - SUB_BITS + 1;
+    return ( shift << ( SUB_BITS-1 ) ) + static_cast<unsigned>( value >> shift );
+}
+
+
+inline uint64_t LatencyHistogram::bucketLow( unsigned index )
+{
+    if( index < 2*HALF_COUNT )
+        return index;
+    const unsigned shift = ( index >> ( SUB_BITS-1 ) ) - 1;
+    return uint64_t( index - ( shift << ( SUB_BITS-1 ) ) ) << shift;
+}
+
+
+inline uint64_t LatencyHistogram::bucketWidth( unsigned index )
+{
+    if( index < 2*HALF_COUNT )
+        return 1;
+    return uint64_t( 1 ) << ( ( index >> ( SUB_BITS-1 ) ) - 1 );
+}
+
+
+inline LatencyHistogram::ExitReport::~ExitReport()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    for( size_t i = 0; i < histograms.size(); ++i )
+    {
+        histograms[ i ]->print( *histograms[ i ]->m_exit_stream );
+        histograms[ i ]->m_exit_stream = 0;
+    }
+    histograms.clear();
+}
+
+
+inline LatencyHistogram::ExitReport& LatencyHistogram::exitReport()
+{
+    static ExitReport report;
+    return report;
+}
+
+
+#endif // KLIB_LATENCY_HISTOGRAM_H_
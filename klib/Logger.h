@@ -15,12 +15,32 @@
 //     KLOG( Log::WARNING ) << "Some warning message";
 //     The logger will insert newlines after each message
 //   - Defaults to writing to cerr. Use setStream() to write to cout, file, etc
+//   - Each message is formatted into its own buffer, reused across messages
+//     on a thread, and written whole, so messages from concurrent threads do
+//     not interleave.  A KLOG inside an argument's operator<< gets a buffer
+//     of its own
+//   - Log::startAsync() moves the writing to a background thread: producers
+//     copy finished messages into a bounded lock-free queue and the sink
+//     thread formats timestamps and writes them out.  This only shortens the
+//     caller's time per message when the sink has a core of its own
 //
 // Inspired by http://drdobbs.com/cpp/201804215
 //
 
-#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
 #include <sys/time.h>
 
 
@@ -50,6 +70,17 @@ public:
         DEBUG4
     };
 
+    /// What a producer does when the async queue is full
+    enum Overflow
+    {
+        DROP=0,  ///< Discard the message.  The sink reports how many it lost
+        BLOCK    ///< Wait for the sink thread to make room
+    };
+
+    /// Async messages longer than this are truncated, noting how many bytes
+    /// were lost.  Sized so a queue slot is 512 bytes
+    static const size_t MAX_MESSAGE_LENGTH = 464;
+
     //**************************************************************************
     // INFO: Do not use this public interface directly: use KLOG macro
     Log();
@@ -62,38 +93,410 @@ public:
     static void          setReportingLevel( Level level );
     static void          setStream( std::ostream& out );
 
+    /// Write messages from a background thread.  Producers copy each message
+    /// into a lock-free queue of capacity slots (rounded up to a power of
+    /// two) and overflow decides what happens when it is full.  Messages
+    /// still queued at exit are written.  Do not call setStream() while
+    /// async logging is running.
+    static void          startAsync( size_t capacity = 4096,
+                                     Overflow overflow = DROP );
+
+    /// Write out queued messages and go back to writing in the caller
+    static void          stopAsync();
+
+    /// Block until every message logged so far has reached the stream
+    static void          flush();
+
+    /// Messages discarded by the DROP policy since startAsync()
+    static unsigned long getNumDropped();
+
+    /// Pieces of the message prefix, also used by BinaryLog's decoder
+    static std::string time( const timeval& tv );
+    static std::string toString( Level level );
+
 private:
     Log(const Log&);
     Log& operator=(const Log&);
 
-    static std::string time();
-    static std::string toString( Level level );
-    
+    class LineBuffer;
+    class AsyncSink;
+    struct LineStream;
+    struct LineStack;
+
+    static LineStack&    lineStack();
+    static LineStream&   acquireLine();
+    static void          releaseLine();
+    static AsyncSink&    asyncSink();
+    static std::mutex&   streamMutex();
+
+    static const char*   levelName( Level level );
+    static int           formatTime( const timeval& tv, char* out, size_t size );
+
+    static void write( std::ostream& out, Level level, const timeval& tv,
+                       const char* text, size_t length, size_t truncated = 0 );
+
     static Level         s_reporting_level;
     static std::ostream* s_out;
+
+    Level       m_level;
+    timeval     m_time;
+    LineStream* m_line;
 };
 
 std::ostream* Log::s_out             = &std::cerr;
 Log::Level    Log::s_reporting_level = Log::WARNING;
 
 
+//
+// Message buffer which grows to fit.  Buffers are reused, so once one has
+// grown to the longest message formatting is allocation free
+//
+class Log::LineBuffer : public std::streambuf
+{
+public:
+    LineBuffer() : m_text( MAX_MESSAGE_LENGTH ) { reset(); }
+
+    void        reset()          { setp( &m_text[ 0 ], &m_text[ 0 ] + m_text.size() ); }
+    const char* text()   const   { return pbase(); }
+    size_t      length() const   { return pptr() - pbase(); }
+
+protected:
+    int_type overflow( int_type c )
+    {
+        if( traits_type::eq_int_type( c, traits_type::eof() ) )
+            return traits_type::not_eof( c );
+
+        const size_t length = this->length();
+        m_text.resize( m_text.size()*2 );
+        setp( &m_text[ 0 ], &m_text[ 0 ] + m_text.size() );
+        pbump( static_cast<int>( length ) );
+        return sputc( traits_type::to_char_type( c ) );
+    }
+
+private:
+    std::vector<char> m_text;
+};
+
+
+struct Log::LineStream
+{
+    LineStream() : stream( &buffer ) {}
+
+    LineBuffer   buffer;
+    std::ostream stream;
+};
+
+
+//
+// The streams of this thread's messages being formatted, innermost last.
+// KLOGs nest, from inside an argument's operator<<, but always finish in
+// reverse order
+//
+struct Log::LineStack
+{
+    LineStack() : depth( 0 ) {}
+
+    std::vector< std::unique_ptr<LineStream> > lines;
+    size_t                                     depth;
+};
+
+
+//
+// Bounded multi-producer, single-consumer queue of finished messages (after
+// Vyukov's bounded MPMC queue) drained by one sink thread.  Each slot's
+// sequence number says whether it is free for the producer that claimed
+// position pos (sequence == pos) or holds a message for the consumer
+// (sequence == pos+1), so producers only contend on the enqueue counter.
+//
+class Log::AsyncSink
+{
+public:
+    AsyncSink();
+    ~AsyncSink();
+
+    void start( size_t capacity, Overflow overflow );
+    void stop();
+    void flush();
+
+    /// Returns false if the sink is not running and the caller should write
+    /// the message itself
+    bool push( Level level, const timeval& tv, const char* text, size_t length );
+
+    unsigned long getNumDropped() const  { return m_dropped.load(); }
+
+private:
+    AsyncSink( const AsyncSink& );
+    AsyncSink& operator=( const AsyncSink& );
+
+    struct alignas( 64 ) Slot
+    {
+        std::atomic<size_t> sequence;
+        Level               level;
+        timeval             time;
+        size_t              length;
+        size_t              truncated;
+        char                text[ MAX_MESSAGE_LENGTH ];
+    };
+
+    void run();
+    bool available() const;
+    void wake();
+
+    std::unique_ptr<Slot[]>    m_slots;
+    size_t                     m_mask;
+    Overflow                   m_overflow;
+
+    std::atomic<bool>          m_running;
+    std::atomic<unsigned>      m_producers;     // pushes in flight
+    std::atomic<unsigned long> m_dropped;
+
+    alignas( 64 )
+    std::atomic<size_t>        m_enqueue;
+    alignas( 64 )
+    std::atomic<size_t>        m_dequeue;
+    std::atomic<size_t>        m_written;       // dequeued and flushed
+
+    std::atomic<bool>          m_stop;
+    std::atomic<bool>          m_sleeping;
+    std::mutex                 m_mutex;
+    std::condition_variable    m_wake;
+    std::thread                m_thread;
+};
+
+
+inline Log::AsyncSink::AsyncSink()
+    : m_mask( 0 ),
+      m_overflow( DROP ),
+      m_running( false ),
+      m_producers( 0 ),
+      m_dropped( 0 ),
+      m_enqueue( 0 ),
+      m_dequeue( 0 ),
+      m_written( 0 ),
+      m_stop( false ),
+      m_sleeping( false )
+{
+}
+
+
+inline Log::AsyncSink::~AsyncSink()
+{
+    stop();
+}
+
+
+inline void Log::AsyncSink::start( size_t capacity, Overflow overflow )
+{
+    stop();
+
+    size_t size = 2;
+    while( size < capacity )
+        size *= 2;
+
+    m_slots.reset( new Slot[ size ] );
+    for( size_t i = 0; i < size; ++i )
+        m_slots[ i ].sequence.store( i, std::memory_order_relaxed );
+    m_mask     = size - 1;
+    m_overflow = overflow;
+    m_dropped.store( 0 );
+    m_enqueue.store( 0 );
+    m_dequeue.store( 0 );
+    m_written.store( 0 );
+    m_stop.store( false );
+
+    m_thread = std::thread( &AsyncSink::run, this );
+    m_running.store( true );
+}
+
+
+inline void Log::AsyncSink::stop()
+{
+    if( !m_running.exchange( false ) )
+        return;
+
+    // Let pushes that saw m_running set finish before the queue goes away
+    while( m_producers.load() != 0 )
+        std::this_thread::yield();
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stop.store( true );
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    m_slots.reset();
+}
+
+
+inline void Log::AsyncSink::flush()
+{
+    if( !m_running.load() )
+        return;
+
+    const size_t target = m_enqueue.load();
+    while( m_written.load( std::memory_order_acquire ) < target )
+    {
+        wake();
+        std::this_thread::yield();
+    }
+}
+
+
+inline bool Log::AsyncSink::push(
+        Level level,
+        const timeval& tv,
+        const char* text,
+        size_t length )
+{
+    m_producers.fetch_add( 1 );
+    if( !m_running.load() )
+    {
+        m_producers.fetch_sub( 1 );
+        return false;
+    }
+
+    Slot*  slot = 0;
+    size_t pos  = m_enqueue.load( std::memory_order_relaxed );
+    for( ;; )
+    {
+        slot = &m_slots[ pos & m_mask ];
+        const size_t sequence = slot->sequence.load( std::memory_order_acquire );
+        const ptrdiff_t diff  = static_cast<ptrdiff_t>( sequence - pos );
+        if( diff == 0 )
+        {
+            if( m_enqueue.compare_exchange_weak( pos, pos+1, std::memory_order_relaxed ) )
+                break;
+        }
+        else if( diff < 0 )
+        {
+            // Full
+            if( m_overflow == DROP )
+            {
+                m_dropped.fetch_add( 1, std::memory_order_relaxed );
+                m_producers.fetch_sub( 1 );
+                return true;
+            }
+            wake();
+            std::this_thread::yield();
+            pos = m_enqueue.load( std::memory_order_relaxed );
+        }
+        else
+        {
+            pos = m_enqueue.load( std::memory_order_relaxed );
+        }
+    }
+
+    slot->level     = level;
+    slot->time      = tv;
+    slot->length    = length < MAX_MESSAGE_LENGTH ? length : MAX_MESSAGE_LENGTH;
+    slot->truncated = length - slot->length;
+    std::memcpy( slot->text, text, slot->length );
+    slot->sequence.store( pos+1, std::memory_order_release );
+
+    // The sink also wakes up on a timeout, so a missed wake only delays it
+    if( m_sleeping.load( std::memory_order_relaxed ) )
+        wake();
+
+    m_producers.fetch_sub( 1 );
+    return true;
+}
+
+
+inline bool Log::AsyncSink::available() const
+{
+    const size_t pos = m_dequeue.load( std::memory_order_relaxed );
+    return m_slots[ pos & m_mask ].sequence.load( std::memory_order_acquire ) == pos+1;
+}
+
+
+inline void Log::AsyncSink::wake()
+{
+    m_wake.notify_one();
+}
+
+
+inline void Log::AsyncSink::run()
+{
+    unsigned long reported = 0;
+    for( ;; )
+    {
+        size_t pos = m_dequeue.load( std::memory_order_relaxed );
+        bool wrote = false;
+        while( available() )
+        {
+            Slot& slot = m_slots[ pos & m_mask ];
+            write( *s_out, slot.level, slot.time, slot.text, slot.length, slot.truncated );
+            slot.sequence.store( pos + m_mask + 1, std::memory_order_release );
+            m_dequeue.store( ++pos, std::memory_order_relaxed );
+            wrote = true;
+        }
+
+        const unsigned long dropped = m_dropped.load( std::memory_order_relaxed );
+        if( dropped != reported )
+        {
+            timeval tv;
+            gettimeofday( &tv, 0 );
+            char text[ 64 ];
+            const int length = std::snprintf( text, sizeof( text ),
+                    "%lu log messages dropped", dropped - reported );
+            write( *s_out, WARNING, tv, text, length );
+            reported = dropped;
+            wrote    = true;
+        }
+
+        if( wrote )
+        {
+            s_out->flush();
+            m_written.store( pos, std::memory_order_release );
+            continue;
+        }
+
+        // Nothing was queued.  All pushes finished before m_stop was set, so
+        // the queue is empty for good
+        if( m_stop.load() )
+            break;
+
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_sleeping.store( true );
+        if( !available() && !m_stop.load() )
+            m_wake.wait_for( lock, std::chrono::milliseconds( 10 ) );
+        m_sleeping.store( false );
+    }
+}
+
+
 //
 inline Log::Log()
+    : m_level( INFO ),
+      m_line( 0 )
 {
 }
 
 
 inline Log::~Log()
 {
-    *s_out << "\n";
+    if( !m_line )
+        return;
+
+    const LineBuffer& buffer = m_line->buffer;
+    if( !asyncSink().push( m_level, m_time, buffer.text(), buffer.length() ) )
+    {
+        std::lock_guard<std::mutex> lock( streamMutex() );
+        write( *s_out, m_level, m_time, buffer.text(), buffer.length() );
+    }
+    releaseLine();
 }
 
 
 inline std::ostream& Log::get( Log::Level level )
 {
-    *s_out << "[" << time() << "] " << toString( level ) << ": "
-          << std::string( (level > INFO ? level - INFO : 0 ), '\t' );
-    return *s_out;
+    m_level = level;
+    gettimeofday( &m_time, 0 );
+
+    m_line = &acquireLine();
+    m_line->buffer.reset();
+    m_line->stream.clear();
+    return m_line->stream;
 }
 
 
@@ -113,7 +516,93 @@ inline void Log::setStream( std::ostream& out )
     s_out = &out;
 }
 
-inline std::string Log::toString( Log::Level level )
+
+inline void Log::startAsync( size_t capacity, Overflow overflow )
+{
+    asyncSink().start( capacity, overflow );
+}
+
+
+inline void Log::stopAsync()
+{
+    asyncSink().stop();
+}
+
+
+inline void Log::flush()
+{
+    asyncSink().flush();
+}
+
+
+inline unsigned long Log::getNumDropped()
+{
+    return asyncSink().getNumDropped();
+}
+
+
+inline Log::LineStack& Log::lineStack()
+{
+    static thread_local LineStack stack;
+    return stack;
+}
+
+
+inline Log::LineStream& Log::acquireLine()
+{
+    LineStack& stack = lineStack();
+    if( stack.depth == stack.lines.size() )
+        stack.lines.push_back( std::unique_ptr<LineStream>( new LineStream ) );
+    return *stack.lines[ stack.depth++ ];
+}
+
+
+inline void Log::releaseLine()
+{
+    --lineStack().depth;
+}
+
+
+inline Log::AsyncSink& Log::asyncSink()
+{
+    // Function static so it is destroyed, writing out anything still
+    // queued, at exit
+    static AsyncSink sink;
+    return sink;
+}
+
+
+inline std::mutex& Log::streamMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+
+inline void Log::write(
+        std::ostream& out,
+        Level level,
+        const timeval& tv,
+        const char* text,
+        size_t length,
+        size_t truncated )
+{
+    char prefix[ 64 ];
+    int  prefix_length = 0;
+    prefix[ prefix_length++ ] = '[';
+    prefix_length += formatTime( tv, prefix + prefix_length, sizeof( prefix ) - prefix_length );
+    prefix_length += std::snprintf( prefix + prefix_length, sizeof( prefix ) - prefix_length,
+                                    "] %s: %.*s", levelName( level ),
+                                    level > INFO ? level - INFO : 0, "\t\t\t\t\t" );
+    out.write( prefix, prefix_length );
+    out.write( text, length );
+    if( truncated )
+        out << "... [" << truncated << " bytes truncated]";
+    out.put( '\n' );
+}
+
+
+inline const char* Log::levelName( Log::Level level )
 {
     static const char* const level2string[] = 
     {
@@ -130,19 +619,35 @@ inline std::string Log::toString( Log::Level level )
 }
 
 
-inline std::string Log::time()
+inline std::string Log::toString( Log::Level level )
 {
-    char buffer[11];
-    time_t t;
-    std::time(&t);
-    tm r = {0};
-    strftime(buffer, sizeof(buffer), "%X", localtime_r(&t, &r));
+    return levelName( level );
+}
 
-    struct timeval tv;
-    gettimeofday(&tv, 0);
 
-    char result[100];
-    std::sprintf(result, "%s.%03ld", buffer, (long)tv.tv_usec / 1000); 
+//
+// localtime_r takes a lock and checks the time zone each call, so keep the
+// last second formatted on this thread
+//
+inline int Log::formatTime( const timeval& tv, char* out, size_t size )
+{
+    static thread_local time_t cached_seconds = -1;
+    static thread_local char   cached[ 11 ];
+    if( tv.tv_sec != cached_seconds )
+    {
+        time_t t = tv.tv_sec;
+        tm r = {0};
+        strftime( cached, sizeof( cached ), "%X", localtime_r( &t, &r ) );
+        cached_seconds = tv.tv_sec;
+    }
+    return std::snprintf( out, size, "%s.%03ld", cached, (long)tv.tv_usec / 1000 );
+}
+
+
+inline std::string Log::time( const timeval& tv )
+{
+    char result[ 32 ];
+    formatTime( tv, result, sizeof( result ) );
     return result;
 }
 
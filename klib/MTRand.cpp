@@ -52,6 +52,171 @@
 
 #include "MTRand.hpp"
 
+#include <cassert>
+
+namespace
+{
+
+typedef std::vector<uint64_t> Polynomial;
+
+// Bits in the linear state of either generator: 624 32-bit or 312 64-bit
+// words, of which 19937 matter
+const size_t StateBits = 19968;
+
+// Jumps shorter than this just run the generator forward
+const uint64_t SkipLimit = 1u << 23;
+
+inline uint64_t bit(const uint64_t* p, size_t i) {
+	return (p[i >> 6] >> (i & 63)) & 1;
+}
+
+inline uint64_t parity(uint64_t x) {
+	x ^= x >> 32;
+	x ^= x >> 16;
+	x ^= x >> 8;
+	x ^= x >> 4;
+	x ^= x >> 2;
+	x ^= x >> 1;
+	return x & 1;
+}
+
+/// 64 bits of p starting at bit i
+inline uint64_t window(const uint64_t* p, size_t i) {
+	const size_t w = i >> 6, b = i & 63;
+	return b == 0 ? p[w] : (p[w] >> b) | (p[w + 1] << (64 - b));
+}
+
+/// dst ^= src << shift for the first count words of src.  dst must have room
+/// for count + shift/64 + 1 words.
+void xorShifted(uint64_t* dst, const uint64_t* src, size_t count, size_t shift) {
+	dst += shift >> 6;
+	const size_t b = shift & 63;
+	if (b == 0) {
+		for (size_t i = 0; i < count; i++)
+			dst[i] ^= src[i];
+		return;
+	}
+	uint64_t carry = 0;
+	for (size_t i = 0; i < count; i++) {
+		dst[i] ^= (src[i] << b) | carry;
+		carry = src[i] >> (64 - b);
+	}
+	dst[count] ^= carry;
+}
+
+size_t degree(const Polynomial& p) {
+	size_t i = p.size() * 64;
+	while (i-- > 0)
+		if (bit(&p[0], i))
+			return i;
+	return 0;
+}
+
+/// Coefficient bits of a 32 bit polynomial moved to even positions, ie. the
+/// square of the polynomial over GF(2)
+inline uint64_t spread(uint32_t x) {
+	uint64_t v = x;
+	v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+	v = (v | (v << 8))  & 0x00ff00ff00ff00ffULL;
+	v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+	v = (v | (v << 2))  & 0x3333333333333333ULL;
+	v = (v | (v << 1))  & 0x5555555555555555ULL;
+	return v;
+}
+
+/// r = r mod p, for r of degree below top and monic p of degree deg
+void reduce(Polynomial& r, size_t top, const Polynomial& p, size_t deg) {
+	for (size_t i = top; i-- > deg; )
+		if (bit(&r[0], i))
+			xorShifted(&r[0], &p[0], p.size(), i - deg);
+}
+
+/// r = r^2 mod p
+void squareMod(Polynomial& r, const Polynomial& p, size_t deg, Polynomial& tmp) {
+	const size_t words = p.size();
+	tmp.assign(2 * words + 2, 0);
+	for (size_t i = 0; i < words; i++) {
+		tmp[2 * i]     = spread(static_cast<uint32_t>(r[i]));
+		tmp[2 * i + 1] = spread(static_cast<uint32_t>(r[i] >> 32));
+	}
+	reduce(tmp, 2 * deg - 1, p, deg);
+	r.assign(tmp.begin(), tmp.begin() + words);
+}
+
+/// r = r * x mod p
+void timesXMod(Polynomial& r, const Polynomial& p, size_t deg) {
+	uint64_t carry = 0;
+	for (size_t i = 0; i < r.size(); i++) {
+		const uint64_t top = r[i] >> 63;
+		r[i] = (r[i] << 1) | carry;
+		carry = top;
+	}
+	if (bit(&r[0], deg))
+		for (size_t i = 0; i < r.size(); i++)
+			r[i] ^= p[i];
+}
+
+/// Minimal polynomial of the bit sequence seq[0..n), monic and lowest
+/// coefficient first, by Berlekamp-Massey
+void berlekampMassey(const Polynomial& seq, size_t n, Polynomial& poly) {
+	// Reversed so each discrepancy is a word-wise dot product: bit j of
+	// reversed is seq[n-1-j]
+	Polynomial reversed(2 * n / 64 + 4, 0);
+	for (size_t i = 0; i < n; i++)
+		if (bit(&seq[0], i))
+			reversed[(n - 1 - i) >> 6] |= 1ULL << ((n - 1 - i) & 63);
+
+	const size_t words = n / 64 + 2;
+	Polynomial c(words, 0), b(words, 0), t;
+	c[0] = b[0] = 1;
+	size_t l = 0, m = 1;
+	for (size_t k = 0; k < n; k++) {
+		uint64_t d = 0;
+		for (size_t w = 0; w <= l >> 6; w++)
+			d ^= c[w] & window(&reversed[0], n - 1 - k + 64 * w);
+		if (!parity(d)) {
+			m++;
+			continue;
+		}
+		if (2 * l <= k) {
+			t = c;
+			xorShifted(&c[0], &b[0], words - m / 64 - 1, m);
+			l = k + 1 - l;
+			b.swap(t);
+			m = 1;
+		} else {
+			xorShifted(&c[0], &b[0], words - m / 64 - 1, m);
+			m++;
+		}
+	}
+
+	// c is the connection polynomial; the minimal polynomial is its reverse
+	poly.assign(l / 64 + 1, 0);
+	for (size_t i = 0; i <= l; i++)
+		if (bit(&c[0], i))
+			poly[(l - i) >> 6] |= 1ULL << ((l - i) & 63);
+}
+
+/// Bit 0 of successive outputs is a linear function of the state, so it
+/// follows the state's recurrence.  That polynomial is irreducible, which
+/// makes it the sequence's minimal polynomial, found from twice its degree
+/// in bits.
+template <class Integer>
+Polynomial outputPolynomial() {
+	legion::MTRand<Integer> rng;
+	const size_t n = 2 * StateBits;
+	Polynomial seq(n / 64, 0);
+	for (size_t i = 0; i < n; i++)
+		seq[i >> 6] |= static_cast<uint64_t>(rng.next() & 1) << (i & 63);
+
+	Polynomial poly;
+	berlekampMassey(seq, n, poly);
+	assert(degree(poly) == 19937);
+	return poly;
+}
+
+}
+
 namespace legion
 {
 
@@ -114,4 +279,110 @@ uint64_t MTRand<uint64_t>::twist(uint64_t a, uint64_t b, uint64_t c) {
 		(((b & 0xffffffff80000000ULL) | (c & 0x7fffffffULL)) >> 1) ^
 		(((c & 1) * 0xffffffffffffffffULL) & 0xb5026f5aa96619e9ULL);
 }
+
+
+template <class Integer>
+void MTRand<Integer>::jump(uint64_t n) {
+	if (n < SkipLimit) {
+		skip(n);
+		return;
+	}
+	Polynomial poly;
+	jumpPolynomial(n, poly);
+	applyJump(poly);
+}
+
+template <class Integer>
+void MTRand<Integer>::split(Integer aSeed, uint64_t stride, size_t num_streams,
+                            std::vector<MTRand>& streams) {
+	streams.assign(num_streams, MTRand(aSeed));
+	if (num_streams < 2)
+		return;
+
+	Polynomial poly;
+	if (stride >= SkipLimit)
+		jumpPolynomial(stride, poly);
+	for (size_t i = 1; i < num_streams; i++) {
+		streams[i] = streams[i - 1];
+		if (stride >= SkipLimit)
+			streams[i].applyJump(poly);
+		else
+			streams[i].skip(stride);
+	}
+}
+
+template <class Integer>
+const typename MTRand<Integer>::Polynomial& MTRand<Integer>::characteristicPolynomial() {
+	static const Polynomial poly = outputPolynomial<Integer>();
+	return poly;
+}
+
+/// x^n mod the characteristic polynomial, by square and multiply
+template <class Integer>
+void MTRand<Integer>::jumpPolynomial(uint64_t n, Polynomial& poly) {
+	const Polynomial& p = characteristicPolynomial();
+	const size_t deg = degree(p);
+
+	poly.assign(p.size(), 0);
+	poly[0] = 1;
+	Polynomial tmp;
+	int i = 63;
+	while (i >= 0 && !((n >> i) & 1))
+		i--;
+	for (; i >= 0; i--) {
+		squareMod(poly, p, deg, tmp);
+		if ((n >> i) & 1)
+			timesXMod(poly, p, deg);
+	}
+}
+
+/// With A the map advancing a 624 word window of the stream by one word
+/// and poly = x^n mod A's characteristic polynomial, poly(A) = A^n.  The
+/// state block is such a window, so summing A^i state over poly's terms
+/// moves the block n words on; index is unchanged.
+template <class Integer>
+void MTRand<Integer>::applyJump(const Polynomial& poly) {
+	Integer window[MaxState];
+	Integer result[MaxState];
+	for (size_t i = 0; i < MaxState; i++) {
+		window[i] = state[i];
+		result[i] = 0;
+	}
+
+	// window is circular, starting at offset
+	size_t offset = 0;
+	const size_t terms = degree(poly) + 1;
+	for (size_t j = 0; j < terms; j++) {
+		if (bit(&poly[0], j)) {
+			for (size_t i = 0; i < MaxState - offset; i++)
+				result[i] ^= window[offset + i];
+			for (size_t i = 0; i < offset; i++)
+				result[MaxState - offset + i] ^= window[i];
+		}
+
+		size_t m = offset + Period;
+		if (m >= MaxState)
+			m -= MaxState;
+		const size_t next = offset + 1 == MaxState ? 0 : offset + 1;
+		window[offset] = twist(window[m], window[offset], window[next]);
+		offset = next;
+	}
+
+	for (size_t i = 0; i < MaxState; i++)
+		state[i] = result[i];
+}
+
+template <class Integer>
+void MTRand<Integer>::skip(uint64_t n) {
+	while (n > MaxState - index) {
+		n -= MaxState - index;
+		seed();
+	}
+	index += static_cast<Integer>(n);
+}
+
+template void MTRand<uint32_t>::jump(uint64_t);
+template void MTRand<uint64_t>::jump(uint64_t);
+template void MTRand<uint32_t>::split(uint32_t, uint64_t, size_t, std::vector<MTRand<uint32_t> >&);
+template void MTRand<uint64_t>::split(uint64_t, uint64_t, size_t, std::vector<MTRand<uint64_t> >&);
 }
@@ -52,6 +52,7 @@
 
 #include <cstddef> //  size_t
 #include <stdint.h> // uint32_t 
+#include <vector>
 
 #ifndef LEGION_COMMON_MATH_MTRAND_HPP_
 #define LEGION_COMMON_MATH_MTRAND_HPP_
@@ -67,7 +68,27 @@ public:
     MTRand( Integer aSeed = 5489u );
 
     Integer next();
-    float operator()() { return next() * ( 1.0f / 4294967296.0f ); }
+    float operator()() { return toFloat( next() ); }
+
+    /// Same values as n calls to next()/operator(), without the per-call
+    /// state check.  See SFMT.hpp for a faster, differently sequenced
+    /// bulk generator.
+    void fill(Integer* out, size_t n);
+    void fillFloats(float* out, size_t n);
+
+    /// Advance the stream by n outputs, as if next() had been called n
+    /// times.  Long jumps compute x^n modulo the generator's characteristic
+    /// polynomial and apply it to the state, so they cost milliseconds
+    /// however large n is.
+    void jump(uint64_t n);
+
+    /// Split the stream of MTRand(aSeed) into num_streams generators for
+    /// parallel use, the kth starting k*stride outputs in.  Reading stride
+    /// outputs from each of streams[0], streams[1], ... in turn reproduces
+    /// the single stream exactly, and no two streams overlap as long as
+    /// each takes at most stride outputs.
+    static void split(Integer aSeed, uint64_t stride, size_t num_streams,
+                      std::vector<MTRand>& streams);
 
 private:
     static const size_t MaxState = 624 * sizeof(uint32_t) / sizeof(Integer);
@@ -75,9 +96,21 @@ private:
 
     void seed();
 
+    /// Scale the high 32 bits of an output to [0,1]
+    static float toFloat(uint32_t x) { return x * ( 1.0f / 4294967296.0f ); }
+    static float toFloat(uint64_t x) { return toFloat(static_cast<uint32_t>(x >> 32)); }
+
     static Integer hashFunction(Integer anInteger);
     static Integer twist(Integer a, Integer b, Integer c);
 
+    /// GF(2) polynomial, one bit per coefficient, lowest degree first
+    typedef std::vector<uint64_t> Polynomial;
+
+    static const Polynomial& characteristicPolynomial();
+    static void jumpPolynomial(uint64_t n, Polynomial& poly);
+    void applyJump(const Polynomial& poly);
+    void skip(uint64_t n);
+
     Integer state[MaxState];
     Integer index;
 };
@@ -95,6 +128,38 @@ Integer MTRand<Integer>::next()
 }
 
 
+template <class Integer>
+void MTRand<Integer>::fill(Integer* out, size_t n)
+{
+    while (n != 0) {
+        if (index >= MaxState)
+            seed();
+        const size_t count = n < MaxState - index ? n : MaxState - index;
+        for (size_t i = 0; i < count; i++)
+            out[i] = hashFunction(state[index + i]);
+        index += count;
+        out   += count;
+        n     -= count;
+    }
+}
+
+
+template <class Integer>
+void MTRand<Integer>::fillFloats(float* out, size_t n)
+{
+    while (n != 0) {
+        if (index >= MaxState)
+            seed();
+        const size_t count = n < MaxState - index ? n : MaxState - index;
+        for (size_t i = 0; i < count; i++)
+            out[i] = toFloat(hashFunction(state[index + i]));
+        index += count;
+        out   += count;
+        n     -= count;
+    }
+}
+
+
 template <class Integer>
 void MTRand<Integer>::seed()
 {
@@ -0,0 +1,528 @@
+
+#ifndef KLIB_PROFILER_H_
+#define KLIB_PROFILER_H_
+
+//
+// Hierarchical scoped profiler: an AutoTimer which files its result in a
+// per-thread call tree instead of calling back.
+//
+// Usage:
+//   - Compile with -DKPROFILE.  Without it KPROFILE_SCOPE expands to nothing,
+//     so instrumented library code costs nothing unless asked for
+//   - KPROFILE_SCOPE( "name" ) times the rest of the enclosing block.  The
+//     name must be a string literal (or otherwise outlive the profiler)
+//   - Each thread keeps its own tree of scopes, keyed by name under their
+//     parent, holding call count and total/min/max time.  Recording takes
+//     no locks; timing uses the cycle counter on x86
+//   - Profiler::writeReport() prints a flat table per scope name,
+//     writeTree() the call tree of each thread.  After enableTrace() every
+//     scope is also logged as an event for writeChromeTrace(), which can be
+//     loaded into chrome://tracing or Perfetto
+//   - Reports read other threads' trees unsynchronized, so take them once
+//     profiled threads have finished or are idle
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#   include <x86intrin.h>
+#endif
+
+
+#define KPROFILE_CONCAT_( a, b ) a ## b
+#define KPROFILE_CONCAT( a, b )  KPROFILE_CONCAT_( a, b )
+
+#ifdef KPROFILE
+#   define KPROFILE_SCOPE( name )                                              \
+        ProfileScope KPROFILE_CONCAT( kprofile_scope_, __LINE__ )( name )
+#else
+#   define KPROFILE_SCOPE( name )
+#endif
+
+
+class Profiler
+{
+public:
+    /// Totals for one scope name over all threads and call sites.  Times are
+    /// inclusive of nested scopes; self_time excludes them.
+    struct Stats
+    {
+        Stats() : count( 0 ), total_time( 0.0 ), self_time( 0.0 ),
+                  min_time( 0.0 ), max_time( 0.0 ) {}
+
+        unsigned long long count;
+        double             total_time;   ///< Seconds
+        double             self_time;
+        double             min_time;
+        double             max_time;
+    };
+
+    /// Log every scope from now on, up to max_events per thread, for
+    /// writeChromeTrace()
+    static void   enableTrace( size_t max_events = 1u << 20 );
+
+    /// Totals for name; zero count if it was never entered
+    static Stats  getStats( const char* name );
+
+    /// Table of every scope name, slowest total first
+    static void   writeReport( std::ostream& out );
+
+    /// Each thread's call tree, indented by depth
+    static void   writeTree( std::ostream& out );
+
+    /// Chrome trace-event JSON of the logged events
+    static void   writeChromeTrace( std::ostream& out );
+
+    /// Clear all threads' data.  No scope may be open on any thread.
+    static void   reset();
+
+    static uint64_t ticks();
+    static double   secondsPerTick();
+
+private:
+    friend class ProfileScope;
+
+    Profiler();
+
+    struct Node
+    {
+        const char*        name;
+        unsigned           parent;
+        unsigned           first_child;
+        unsigned           next_sibling;
+        unsigned long long count;
+        uint64_t           total;
+        uint64_t           min;
+        uint64_t           max;
+    };
+
+    struct Event
+    {
+        unsigned node;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    struct ThreadData
+    {
+        unsigned            id;
+        unsigned            current;
+        std::vector<Node>   nodes;        // nodes[0] is the root
+        std::vector<Event>  events;
+        size_t              max_events;
+        unsigned long long  dropped_events;
+    };
+
+    struct Registry
+    {
+        Registry();
+        ~Registry();
+
+        std::mutex                             mutex;
+        std::vector<ThreadData*>               threads;
+        size_t                                 max_events;
+        uint64_t                               start_ticks;
+        std::chrono::steady_clock::time_point  start_time;
+    };
+
+    static Registry&   registry();
+    static ThreadData& threadData();
+    static void        clear( ThreadData& data );
+    static unsigned    child( ThreadData& data, const char* name );
+    static void        aggregate( std::map<std::string, Stats>& stats );
+    static void        writeNode( std::ostream& out, const ThreadData& data,
+                                  unsigned node, unsigned depth, double seconds_per_tick );
+    static void        writeJSONString( std::ostream& out, const char* s );
+
+    static const unsigned NONE = ~0u;
+};
+
+
+///
+/// Times its lifetime into the current thread's call tree.  Use through
+/// KPROFILE_SCOPE.
+///
+class ProfileScope
+{
+public:
+    explicit ProfileScope( const char* name );
+    ~ProfileScope();
+
+private:
+    ProfileScope( const ProfileScope& );
+    ProfileScope& operator=( const ProfileScope& );
+
+    Profiler::ThreadData* m_data;
+    unsigned              m_parent;
+    uint64_t              m_start;
+};
+
+
+//------------------------------------------------------------------------------
+//
+// ProfileScope
+//
+//------------------------------------------------------------------------------
+
+inline ProfileScope::ProfileScope( const char* name )
+    : m_data( &Profiler::threadData() )
+{
+    m_parent          = m_data->current;
+    m_data->current   = Profiler::child( *m_data, name );
+    m_start           = Profiler::ticks();
+}
+
+
+inline ProfileScope::~ProfileScope()
+{
+    const uint64_t end      = Profiler::ticks();
+    const uint64_t duration = end - m_start;
+
+    Profiler::Node& node = m_data->nodes[ m_data->current ];
+    if( node.count == 0 || duration < node.min )
+        node.min = duration;
+    if( duration > node.max )
+        node.max = duration;
+    node.total += duration;
+    ++node.count;
+
+    if( m_data->max_events != 0 )
+    {
+        if( m_data->events.size() < m_data->max_events )
+        {
+            const Profiler::Event event = { m_data->current, m_start, end };
+            m_data->events.push_back( event );
+        }
+        else
+        {
+            ++m_data->dropped_events;
+        }
+    }
+
+    m_data->current = m_parent;
+}
+
+
+//------------------------------------------------------------------------------
+//
+// Profiler
+//
+//------------------------------------------------------------------------------
+
+inline Profiler::Registry::Registry()
+    : max_events( 0 ),
+      start_ticks( ticks() ),
+      start_time( std::chrono::steady_clock::now() )
+{
+}
+
+
+inline Profiler::Registry::~Registry()
+{
+    for( size_t i = 0; i < threads.size(); ++i )
+        delete threads[ i ];
+}
+
+
+inline Profiler::Registry& Profiler::registry()
+{
+    static Registry r;
+    return r;
+}
+
+
+/// Registered on first use and kept after the thread exits, for reports
+inline Profiler::ThreadData& Profiler::threadData()
+{
+    static thread_local ThreadData* data = 0;
+    if( !data )
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock( r.mutex );
+        data = new ThreadData;
+        data->id         = static_cast<unsigned>( r.threads.size() );
+        data->max_events = r.max_events;
+        clear( *data );
+        r.threads.push_back( data );
+    }
+    return *data;
+}
+
+
+inline void Profiler::clear( ThreadData& data )
+{
+    const Node root = { "<root>", NONE, NONE, NONE, 0, 0, 0, 0 };
+    data.nodes.assign( 1, root );
+    data.current = 0;
+    data.events.clear();
+    data.dropped_events = 0;
+}
+
+
+/// Child of the current node called name, added if this is its first call
+inline unsigned Profiler::child( ThreadData& data, const char* name )
+{
+    const unsigned parent = data.current;
+    unsigned last = NONE;
+    for( unsigned i = data.nodes[ parent ].first_child; i != NONE; i = data.nodes[ i ].next_sibling )
+    {
+        if( data.nodes[ i ].name == name || std::strcmp( data.nodes[ i ].name, name ) == 0 )
+            return i;
+        last = i;
+    }
+
+    const Node node = { name, parent, NONE, NONE, 0, 0, 0, 0 };
+    const unsigned index = static_cast<unsigned>( data.nodes.size() );
+    data.nodes.push_back( node );
+    if( last == NONE )
+        data.nodes[ parent ].first_child = index;
+    else
+        data.nodes[ last ].next_sibling = index;
+    return index;
+}
+
+
+inline uint64_t Profiler::ticks()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+
+/// Cycle counter rate measured against steady_clock since the profiler was
+/// first used, waiting if that is too short to be accurate
+inline double Profiler::secondsPerTick()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    const Registry& r = registry();
+    const std::chrono::duration<double> min_interval( 0.02 );
+    const std::chrono::duration<double> waited =
+        std::chrono::steady_clock::now() - r.start_time;
+    if( waited < min_interval )
+        std::this_thread::sleep_for( min_interval - waited );
+
+    const uint64_t now = ticks();
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - r.start_time ).count();
+    return seconds / ( now - r.start_ticks );
+#else
+    return 1.0e-9;
+#endif
+}
+
+
+inline void Profiler::enableTrace( size_t max_events )
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock( r.mutex );
+    r.max_events = max_events;
+    for( size_t i = 0; i < r.threads.size(); ++i )
+        r.threads[ i ]->max_events = max_events;
+}
+
+
+inline void Profiler::reset()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock( r.mutex );
+    for( size_t i = 0; i < r.threads.size(); ++i )
+        clear( *r.threads[ i ] );
+}
+
+
+inline void Profiler::aggregate( std::map<std::string, Stats>& stats )
+{
+    const double seconds_per_tick = secondsPerTick();
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock( r.mutex );
+    for( size_t t = 0; t < r.threads.size(); ++t )
+    {
+        const std::vector<Node>& nodes = r.threads[ t ]->nodes;
+        for( size_t i = 1; i < nodes.size(); ++i )
+        {
+            const Node& node = nodes[ i ];
+            if( node.count == 0 )
+                continue;
+
+            uint64_t children = 0;
+            for( unsigned c = node.first_child; c != NONE; c = nodes[ c ].next_sibling )
+                children += nodes[ c ].total;
+
+            Stats& s = stats[ node.name ];
+            const double min_time = node.min*seconds_per_tick;
+            const double max_time = node.max*seconds_per_tick;
+            s.min_time    = s.count == 0 ? min_time : std::min( s.min_time, min_time );
+            s.max_time    = std::max( s.max_time, max_time );
+            s.count      += node.count;
+            s.total_time += node.total*seconds_per_tick;
+            s.self_time  += ( node.total - std::min( children, node.total ) )*seconds_per_tick;
+        }
+    }
+}
+
+
+inline Profiler::Stats Profiler::getStats( const char* name )
+{
+    std::map<std::string, Stats> stats;
+    aggregate( stats );
+    std::map<std::string, Stats>::const_iterator it = stats.find( name );
+    return it == stats.end() ? Stats() : it->second;
+}
+
+
+inline void Profiler::writeReport( std::ostream& out )
+{
+    std::map<std::string, Stats> stats;
+    aggregate( stats );
+
+    std::vector< std::pair<double, std::string> > order;
+    size_t width = 5;
+    for( std::map<std::string, Stats>::const_iterator it = stats.begin(); it != stats.end(); ++it )
+    {
+        order.push_back( std::make_pair( -it->second.total_time, it->first ) );
+        width = std::max( width, it->first.size() + 2 );
+    }
+    std::sort( order.begin(), order.end() );
+
+    const std::ios_base::fmtflags flags = out.flags();
+    out << std::left  << std::setw( width ) << "scope" << std::right
+        << std::setw( 12 ) << "calls"
+        << std::setw( 12 ) << "total ms"
+        << std::setw( 12 ) << "self ms"
+        << std::setw( 12 ) << "mean us"
+        << std::setw( 12 ) << "min us"
+        << std::setw( 12 ) << "max us"
+        << "\n";
+    for( size_t i = 0; i < order.size(); ++i )
+    {
+        const Stats& s = stats[ order[ i ].second ];
+        out << std::left  << std::setw( width ) << order[ i ].second << std::right
+            << std::setw( 12 ) << s.count
+            << std::fixed << std::setprecision( 3 )
+            << std::setw( 12 ) << s.total_time*1.0e3
+            << std::setw( 12 ) << s.self_time*1.0e3
+            << std::setw( 12 ) << s.total_time*1.0e6 / s.count
+            << std::setw( 12 ) << s.min_time*1.0e6
+            << std::setw( 12 ) << s.max_time*1.0e6
+            << "\n";
+    }
+    out.flags( flags );
+}
+
+
+inline void Profiler::writeNode(
+        std::ostream& out,
+        const ThreadData& data,
+        unsigned node,
+        unsigned depth,
+        double seconds_per_tick )
+{
+    for( unsigned c = data.nodes[ node ].first_child; c != NONE; c = data.nodes[ c ].next_sibling )
+    {
+        const Node& n = data.nodes[ c ];
+        const std::string name = std::string( 2*depth, ' ' ) + n.name;
+        out << std::left  << std::setw( 40 ) << name << std::right
+            << std::setw( 12 ) << n.count
+            << std::fixed << std::setprecision( 3 )
+            << std::setw( 12 ) << n.total*seconds_per_tick*1.0e3
+            << std::setw( 12 ) << ( n.count ? n.total*seconds_per_tick*1.0e6 / n.count : 0.0 )
+            << std::setw( 12 ) << n.min*seconds_per_tick*1.0e6
+            << std::setw( 12 ) << n.max*seconds_per_tick*1.0e6
+            << "\n";
+        writeNode( out, data, c, depth+1, seconds_per_tick );
+    }
+}
+
+
+inline void Profiler::writeTree( std::ostream& out )
+{
+    const double seconds_per_tick = secondsPerTick();
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock( r.mutex );
+
+    const std::ios_base::fmtflags flags = out.flags();
+    for( size_t t = 0; t < r.threads.size(); ++t )
+    {
+        const ThreadData& data = *r.threads[ t ];
+        if( data.nodes.size() == 1 )
+            continue;
+
+        out << std::left  << std::setw( 40 ) << ( "thread " + std::to_string( data.id ) )
+            << std::right
+            << std::setw( 12 ) << "calls"
+            << std::setw( 12 ) << "total ms"
+            << std::setw( 12 ) << "mean us"
+            << std::setw( 12 ) << "min us"
+            << std::setw( 12 ) << "max us"
+            << "\n";
+        writeNode( out, data, 0, 1, seconds_per_tick );
+    }
+    out.flags( flags );
+}
+
+
+inline void Profiler::writeJSONString( std::ostream& out, const char* s )
+{
+    out << '"';
+    for( ; *s; ++s )
+    {
+        if( *s == '"' || *s == '\\' )
+            out << '\\' << *s;
+        else if( static_cast<unsigned char>( *s ) < 0x20 )
+            out << ' ';
+        else
+            out << *s;
+    }
+    out << '"';
+}
+
+
+inline void Profiler::writeChromeTrace( std::ostream& out )
+{
+    const double us_per_tick = secondsPerTick()*1.0e6;
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock( r.mutex );
+
+    const std::ios_base::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision( 3 );
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for( size_t t = 0; t < r.threads.size(); ++t )
+    {
+        const ThreadData& data = *r.threads[ t ];
+        for( size_t i = 0; i < data.events.size(); ++i )
+        {
+            const Event& event = data.events[ i ];
+            out << ( first ? "\n" : ",\n" ) << "{\"name\":";
+            writeJSONString( out, data.nodes[ event.node ].name );
+            out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << data.id
+                << ",\"ts\":"  << ( event.start - r.start_ticks )*us_per_tick
+                << ",\"dur\":" << ( event.end - event.start )*us_per_tick
+                << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    out.flags( flags );
+}
+
+
+#endif // KLIB_PROFILER_H_
@@ -0,0 +1,257 @@
+// SIMD-oriented Fast Mersenne Twister (SFMT19937).  See SFMT.hpp for license
+// and references.
+//
+// The SSE2 path is used when the compiler targets SSE2 (all x86-64 builds);
+// define KLIB_SFMT_SCALAR to force the portable path, which produces the same
+// sequence.
+
+#include "SFMT.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined( __SSE2__ ) && !defined( KLIB_SFMT_SCALAR )
+#define KLIB_SFMT_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace legion;
+
+
+namespace
+{
+
+// SFMT19937 parameters
+const int      N      = 156;          // 128-bit words of state
+const int      POS1   = 122;
+const int      SL1    = 18;
+const int      SL2    = 1;
+const int      SR1    = 11;
+const int      SR2    = 1;
+const uint32_t MSK1   = 0xdfffffefU;
+const uint32_t MSK2   = 0xddfecb7fU;
+const uint32_t MSK3   = 0xbffaffffU;
+const uint32_t MSK4   = 0xbffffff6U;
+const uint32_t PARITY[4] = { 0x00000001U, 0x00000000U, 0x00000000U, 0x13c9e684U };
+
+
+#if defined( KLIB_SFMT_SSE2 )
+
+inline __m128i recursion( __m128i a, __m128i b, __m128i c, __m128i d, __m128i mask )
+{
+    __m128i x = a;
+    __m128i y = _mm_srli_epi32( b, SR1 );
+    __m128i z = _mm_srli_si128( c, SR2 );
+    __m128i v = _mm_slli_epi32( d, SL1 );
+    z = _mm_xor_si128( z, x );
+    z = _mm_xor_si128( z, v );
+    x = _mm_slli_si128( x, SL2 );
+    y = _mm_and_si128( y, mask );
+    z = _mm_xor_si128( z, x );
+    z = _mm_xor_si128( z, y );
+    return z;
+}
+
+
+void generateAll( uint32_t* state32 )
+{
+    __m128i* state = reinterpret_cast<__m128i*>( state32 );
+    const __m128i mask = _mm_set_epi32( MSK4, MSK3, MSK2, MSK1 );
+
+    __m128i r1 = _mm_load_si128( state + N - 2 );
+    __m128i r2 = _mm_load_si128( state + N - 1 );
+    int i = 0;
+    for( ; i < N - POS1; ++i )
+    {
+        const __m128i r = recursion( _mm_load_si128( state + i ),
+                                     _mm_load_si128( state + i + POS1 ),
+                                     r1, r2, mask );
+        _mm_store_si128( state + i, r );
+        r1 = r2;
+        r2 = r;
+    }
+    for( ; i < N; ++i )
+    {
+        const __m128i r = recursion( _mm_load_si128( state + i ),
+                                     _mm_load_si128( state + i + POS1 - N ),
+                                     r1, r2, mask );
+        _mm_store_si128( state + i, r );
+        r1 = r2;
+        r2 = r;
+    }
+}
+
+#else
+
+/// 128-bit shifts by whole bytes, operating on four little-endian words
+inline void rshift128( uint32_t* out, const uint32_t* in, int shift )
+{
+    const uint64_t th = ( static_cast<uint64_t>( in[3] ) << 32 ) | in[2];
+    const uint64_t tl = ( static_cast<uint64_t>( in[1] ) << 32 ) | in[0];
+    const uint64_t oh = th >> ( shift*8 );
+    const uint64_t ol = ( tl >> ( shift*8 ) ) | ( th << ( 64 - shift*8 ) );
+    out[0] = static_cast<uint32_t>( ol );
+    out[1] = static_cast<uint32_t>( ol >> 32 );
+    out[2] = static_cast<uint32_t>( oh );
+    out[3] = static_cast<uint32_t>( oh >> 32 );
+}
+
+
+inline void lshift128( uint32_t* out, const uint32_t* in, int shift )
+{
+    const uint64_t th = ( static_cast<uint64_t>( in[3] ) << 32 ) | in[2];
+    const uint64_t tl = ( static_cast<uint64_t>( in[1] ) << 32 ) | in[0];
+    const uint64_t oh = ( th << ( shift*8 ) ) | ( tl >> ( 64 - shift*8 ) );
+    const uint64_t ol = tl << ( shift*8 );
+    out[0] = static_cast<uint32_t>( ol );
+    out[1] = static_cast<uint32_t>( ol >> 32 );
+    out[2] = static_cast<uint32_t>( oh );
+    out[3] = static_cast<uint32_t>( oh >> 32 );
+}
+
+
+inline void recursion( uint32_t* r, const uint32_t* a, const uint32_t* b,
+                       const uint32_t* c, const uint32_t* d )
+{
+    uint32_t x[4], y[4];
+    lshift128( x, a, SL2 );
+    rshift128( y, c, SR2 );
+    r[0] = a[0] ^ x[0] ^ ( ( b[0] >> SR1 ) & MSK1 ) ^ y[0] ^ ( d[0] << SL1 );
+    r[1] = a[1] ^ x[1] ^ ( ( b[1] >> SR1 ) & MSK2 ) ^ y[1] ^ ( d[1] << SL1 );
+    r[2] = a[2] ^ x[2] ^ ( ( b[2] >> SR1 ) & MSK3 ) ^ y[2] ^ ( d[2] << SL1 );
+    r[3] = a[3] ^ x[3] ^ ( ( b[3] >> SR1 ) & MSK4 ) ^ y[3] ^ ( d[3] << SL1 );
+}
+
+
+void generateAll( uint32_t* state )
+{
+    const uint32_t* r1 = state + 4*( N - 2 );
+    const uint32_t* r2 = state + 4*( N - 1 );
+    int i = 0;
+    for( ; i < N - POS1; ++i )
+    {
+        recursion( state + 4*i, state + 4*i, state + 4*( i + POS1 ), r1, r2 );
+        r1 = r2;
+        r2 = state + 4*i;
+    }
+    for( ; i < N; ++i )
+    {
+        recursion( state + 4*i, state + 4*i, state + 4*( i + POS1 - N ), r1, r2 );
+        r1 = r2;
+        r2 = state + 4*i;
+    }
+}
+
+#endif
+
+
+/// 24 high bits scaled to [0,1), exact in a float
+inline float toFloat( uint32_t x )
+{
+    return static_cast<float>( x >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+
+void toFloats( const uint32_t* in, float* out, size_t n )
+{
+    size_t i = 0;
+#if defined( KLIB_SFMT_SSE2 )
+    const __m128 scale = _mm_set1_ps( 1.0f / 16777216.0f );
+    for( ; i+4 <= n; i += 4 )
+    {
+        const __m128i x = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+        const __m128  f = _mm_cvtepi32_ps( _mm_srli_epi32( x, 8 ) );
+        _mm_storeu_ps( out + i, _mm_mul_ps( f, scale ) );
+    }
+#endif
+    for( ; i < n; ++i )
+        out[i] = toFloat( in[i] );
+}
+
+}
+
+
+SFMT19937::SFMT19937( uint32_t aSeed )
+{
+    state[0] = aSeed;
+    for (size_t i = 1; i < BlockSize; i++) {
+        state[i] = 1812433253UL * (state[i - 1] ^ (state[i - 1] >> 30))
+                   + static_cast<uint32_t>(i);
+    }
+    index = BlockSize;
+    certifyPeriod();
+}
+
+
+void SFMT19937::fill( uint32_t* out, size_t n )
+{
+    while (n != 0) {
+        if (index >= BlockSize)
+            generateBlock();
+        const size_t count = std::min(n, BlockSize - index);
+        memcpy(out, state + index, count * sizeof(uint32_t));
+        index += count;
+        out   += count;
+        n     -= count;
+    }
+}
+
+
+void SFMT19937::fill( uint64_t* out, size_t n )
+{
+    index += index & 1;
+    while (n != 0) {
+        if (index >= BlockSize)
+            generateBlock();
+        const size_t count = std::min(n, (BlockSize - index) / 2);
+        memcpy(out, state + index, count * sizeof(uint64_t));
+        index += 2 * count;
+        out   += count;
+        n     -= count;
+    }
+}
+
+
+void SFMT19937::fillFloats( float* out, size_t n )
+{
+    while (n != 0) {
+        if (index >= BlockSize)
+            generateBlock();
+        const size_t count = std::min(n, BlockSize - index);
+        toFloats(state + index, out, count);
+        index += count;
+        out   += count;
+        n     -= count;
+    }
+}
+
+
+void SFMT19937::generateBlock()
+{
+    generateAll(state);
+    index = 0;
+}
+
+
+/// Make sure the initial state lies on the full period orbit
+void SFMT19937::certifyPeriod()
+{
+    uint32_t inner = 0;
+    for (int i = 0; i < 4; i++)
+        inner ^= state[i] & PARITY[i];
+    for (int i = 16; i > 0; i >>= 1)
+        inner ^= inner >> i;
+    if (inner & 1)
+        return;
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t work = 1;
+        for (int j = 0; j < 32; j++) {
+            if (work & PARITY[i]) {
+                state[i] ^= work;
+                return;
+            }
+            work <<= 1;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+// SIMD-oriented Fast Mersenne Twister (SFMT19937) bulk generator, written to
+// sit alongside MTRand.  Same period (2^19937-1) but a different, non-tempered
+// output sequence designed so a whole state block regenerates with 128-bit
+// vector operations.  Use MTRand where reproducing existing MT19937 streams
+// matters; use SFMT19937::fill/fillFloats to produce large batches quickly.
+//
+// Algorithm and parameters from SFMT 1.3.3 by Mutsuo Saito and Makoto
+// Matsumoto.
+//
+// Copyright (c) 2006,2007 Mutsuo Saito, Makoto Matsumoto and Hiroshima
+// University. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//     * Neither the name of the Hiroshima University nor the names of
+//       its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// References:
+// M. Saito and M. Matsumoto, ``SIMD-oriented Fast Mersenne Twister: a
+// 128-bit Pseudorandom Number Generator''
+// Monte Carlo and Quasi-Monte Carlo Methods 2006, Springer (2008) 607--622.
+// http://www.math.sci.hiroshima-u.ac.jp/~m-mat/MT/SFMT/
+
+#include <cstddef> //  size_t
+#include <stdint.h> // uint32_t
+
+#ifndef LEGION_COMMON_MATH_SFMT_HPP_
+#define LEGION_COMMON_MATH_SFMT_HPP_
+
+
+namespace legion
+{
+
+class SFMT19937
+{
+public:
+    SFMT19937( uint32_t aSeed = 5489u );
+
+    /// One 32-bit output.  fill() is much faster for more than a few values.
+    uint32_t next();
+
+    /// Fill out with n 32-bit outputs, continuing the stream from next()
+    void fill( uint32_t* out, size_t n );
+
+    /// Fill out with n 64-bit outputs, each built from two consecutive 32-bit
+    /// outputs (low word first).  Realigns to an even position in the stream.
+    void fill( uint64_t* out, size_t n );
+
+    /// Fill out with n floats in [0,1), 24 bits of precision each
+    void fillFloats( float* out, size_t n );
+
+    /// Number of 32-bit outputs per state block
+    static const size_t BlockSize = 624;
+
+private:
+    void generateBlock();
+    void certifyPeriod();
+
+    // 16 byte aligned so the block can be processed as __m128i
+    alignas( 16 ) uint32_t state[BlockSize];
+    size_t index;
+};
+
+
+inline uint32_t SFMT19937::next()
+{
+    if (index >= BlockSize)
+        generateBlock();
+    return state[index++];
+}
+
+
+}
+
+
+#endif // LEGION_COMMON_MATH_SFMT_HPP_
@@ -1,20 +1,67 @@
+#ifndef KLIB_SIMULATED_ANNEALING_H_
+#define KLIB_SIMULATED_ANNEALING_H_
+
+//
+// Simulated annealing with parallel tempering (replica exchange).
+//
+// K replicas of the search run concurrently, each at its own temperature on a
+// geometric ladder between Options::min_temperature and
+// Options::max_temperature.  Every Options::steps_per_exchange steps the
+// replicas synchronize and neighboring temperatures swap states with the
+// usual Metropolis exchange probability, letting good states found by the
+// hot, exploratory replicas trickle down to the cold, greedy ones.  With a
+// single replica this is plain simulated annealing.
+//
+// Replicas are distributed over worker threads and each draws from its own
+// MTRand32 stream, so runs with the same Options are reproducible regardless
+// of thread count.
+//
+// Usage:
+//   SimulatedAnnealing<Graph, LinearCoolingSchedule, MetropolisTransitionP>
+//       annealer( graph, LinearCoolingSchedule( 200 ), MetropolisTransitionP() );
+//   annealer.run( initial_state, solution_state );
+//
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+#include "MTRand.hpp"
+#include "Profiler.h"
 
-#ifndef SIMULATED_ANNEALING_H_
-#define SIMULATED_ANNEALING_H_
 
 // TODO: allow arbitrary Score type -- right now hardcoded to float
 
+
+//------------------------------------------------------------------------------
+//
+// Cooling schedules.  step() is called once per exchange round and returns a
+// scale in [0,1] applied to every replica's ladder temperature for that round.
+//
+//------------------------------------------------------------------------------
+
+/// Scale falls linearly from 1 to 0 over max_steps rounds
 class LinearCoolingSchedule
 {
 public:
-    LinearCoolingSchedule( unsigned max_iterations )
+    explicit LinearCoolingSchedule( unsigned max_steps )
         : m_max_steps( static_cast<float>( max_steps ) ),
           m_current_step( 0.0f )
     {
     }
 
     float step()
-    { 
+    {
         m_current_step += 1.0f;
         return ( m_max_steps - m_current_step ) / m_max_steps;
     }
@@ -25,111 +72,581 @@ public:
     }
 
 private:
-    const float m_max_steps;
+    float m_max_steps;
     float m_current_step;
 };
 
 
-class SimpleTransitionP 
+/// Scale falls by a constant factor each round, starting from 1
+class GeometricCoolingSchedule
+{
+public:
+    GeometricCoolingSchedule( unsigned max_steps, float factor )
+        : m_max_steps( max_steps ),
+          m_current_step( 0 ),
+          m_factor( factor ),
+          m_scale( 1.0f )
+    {
+        assert( factor > 0.0f && factor <= 1.0f );
+    }
+
+    float step()
+    {
+        ++m_current_step;
+        m_scale *= m_factor;
+        return m_scale;
+    }
+
+    bool finished()const
+    {
+        return m_current_step >= m_max_steps;
+    }
+
+private:
+    unsigned m_max_steps;
+    unsigned m_current_step;
+    float    m_factor;
+    float    m_scale;
+};
+
+
+/// Constant scale of 1 for max_steps rounds: pure parallel tempering
+class ConstantSchedule
+{
+public:
+    explicit ConstantSchedule( unsigned max_steps )
+        : m_max_steps( max_steps ),
+          m_current_step( 0 )
+    {
+    }
+
+    float step()
+    {
+        ++m_current_step;
+        return 1.0f;
+    }
+
+    bool finished()const
+    {
+        return m_current_step >= m_max_steps;
+    }
+
+private:
+    unsigned m_max_steps;
+    unsigned m_current_step;
+};
+
+
+//------------------------------------------------------------------------------
+//
+// Transition probabilities.  get( e0, e1, temperature ) returns the
+// probability of moving from a state with energy e0 to one with energy e1.
+//
+//------------------------------------------------------------------------------
+
+/// exp( -( e1 - e0 ) / T ) for uphill moves, always accept downhill moves
+class MetropolisTransitionP
+{
+public:
+    float get( float e0, float e1, float temperature )const
+    {
+        if( e1 <= e0 )
+            return 1.0f;
+        if( temperature <= 0.0f )
+            return 0.0f;
+        return expf( ( e0 - e1 ) / temperature );
+    }
+};
+
+
+class SimpleTransitionP
 {
 public:
-    // Initial greediness should be in [0,1].
+    // Initial greediness should be in [0,1] and temperature in [0,1].
     //   * Initial greediness of zero; P starts at .5/.5 transition
     //     probablilities for score improving/worsening transitions respectively
     //   * Initial greediness of one; P starts at 1.0/0.0 (fully greeedy).
     //   * In either case, P moves linearly to fully greedy by end of cooling.
-    SimpleTransitionP( float initial_greediness )
-        : m_initial_greediness( 0.5f * initial_greediness )
+    explicit SimpleTransitionP( float initial_greediness )
+        : m_initial_worsening_p( 0.5f * ( 1.0f - initial_greediness ) )
     {
         assert( initial_greediness <=  1.000001f );
         assert( initial_greediness >= -0.000001f );
     }
 
 
-    float get( float s0, float s1, float temperature )
+    float get( float e0, float e1, float temperature )const
     {
-        float t = lerp( m_initial_greediness, 0.0f, temperature );
-        if( s0 > s1 ) return 1.0f-t;
-        else          return 0.0f+t
+        const float t = lerp( 0.0f, m_initial_worsening_p, temperature );
+        if( e0 > e1 ) return 1.0f-t;
+        else          return 0.0f+t;
     }
 
 private:
     static inline float lerp( float a, float b, float t )
     { return a + t*( b-a ); }
 
-    float m_initial_greediness;
+    float m_initial_worsening_p;
+};
+
+
+/// Parallel tempering parameters, see SimulatedAnnealing
+struct SimulatedAnnealingOptions
+{
+    SimulatedAnnealingOptions()
+        : num_replicas( 8 ),
+          num_threads( 0 ),
+          min_temperature( 0.01f ),
+          max_temperature( 1.0f ),
+          steps_per_exchange( 1000 ),
+          seed( 5489u )
+    {
+    }
+
+    unsigned num_replicas;
+    unsigned num_threads;        ///< 0 for one per hardware thread
+    float    min_temperature;    ///< Coldest replica
+    float    max_temperature;    ///< Hottest replica
+    unsigned steps_per_exchange; ///< Steps each replica takes per round
+    uint32_t seed;
 };
 
 
+/// Detects the optional Graph::proposeDelta()/Graph::commit() trait
+template <typename Graph, typename Enable = void>
+struct HasDeltaEnergy : std::false_type {};
+
+template <typename Graph>
+struct HasDeltaEnergy<
+    Graph,
+    decltype( (void)std::declval<const Graph&>().proposeDelta(
+                  std::declval<const typename Graph::State&>(),
+                  std::declval<legion::MTRand32&>() ),
+              (void)std::declval<const Graph&>().commit(
+                  std::declval<typename Graph::State&>(),
+                  std::declval<const typename Graph::Move&>() ) ) >
+    : std::true_type {};
+
+
+//------------------------------------------------------------------------------
 //
 // Graph:
-//     * Needs to evaluate the 'energy' of a given state
-//     * identify a perfect sol'n
-//     * Graph::State is a state in the search space
-//     * Graph::Energy represents energy of a State
-//     * Graph::transition( Graph::State ) modifies the state in place to a
-//       neighbor state
+//     * Graph::State is a state in the search space.  Must be copyable.
+//     * Graph::Energy represents energy of a State.  Must convert to float.
+//     * Graph::evaluate( const State& )const returns the energy of a state
+//     * Graph::isOptimal( Energy )const identifies a perfect sol'n
+//     * Graph::transition( State&, legion::MTRand32& )const modifies the
+//       state in place to a random neighbor state
+//     * Graph::revert( State& )const undoes the most recent transition.  Any
+//       undo information must live in the State, not the Graph.
+//     * All methods are called concurrently from several threads
+//     * Optionally implement the delta energy trait, which lets the annealer
+//       score a move without applying it:
+//
+//       typename Graph::Move
+//
+//       std::pair<Graph::Move, Graph::Energy>
+//       Graph::proposeDelta( const State&, legion::MTRand32& )const
+//           - picks a random move and returns it with the energy change it
+//             would cause
+//
+//       void Graph::commit( State&, const Graph::Move& )const
+//           - applies a move returned by proposeDelta()
+//
+//       When present, rejected moves cost nothing and evaluate() is only used
+//       once per round to resynchronize the running energy.  transition() and
+//       revert() are then unused.
 // CoolingSchedule:
-//     * Temp should be decreasing and in [1.0, 0.0]
-//     * Report when cooling is finished
-// P:
-//     * P( score, score_prime, Temp ) should decrease as Temp decreases 
-//     * Must accept Graph::Score as input for P
+//     * step() returns temperature scale, decreasing and in [1.0, 0.0]
+//     * finished() reports when cooling is finished
+// TransitionP:
+//     * get( e0, e1, Temp ) should decrease as Temp decreases
 //
+//------------------------------------------------------------------------------
 template< typename Graph,
-          typename CoolingSchedule = LinearCooling,
-          typename TransitionP = SimpleTransitionP >
+          typename CoolingSchedule = LinearCoolingSchedule,
+          typename TransitionP     = MetropolisTransitionP >
 class SimulatedAnnealing
 {
 public:
-    SimulatedAnnealing( Graph&          graph,
+    typedef typename Graph::State  State;
+    typedef typename Graph::Energy Energy;
+
+    typedef SimulatedAnnealingOptions Options;
+
+    SimulatedAnnealing( const Graph&    graph,
                         CoolingSchedule cooling_schedule,
-                        TransitionP     transition_p )
-        : m_graph( graph ),
-          m_cooling_schedule( cooling_schedule ),
-          m_transition_p( transition_p )
+                        TransitionP     transition_p,
+                        const Options&  options = Options() );
+
+    /// Anneal from initial_state.  solution_state receives the lowest
+    /// energy state seen by any replica.  Returns its energy.
+    Energy run( const State& initial_state, State& solution_state );
+
+    /// Total transitions tried over all replicas by the last run
+    unsigned long long getNumSteps()const      { return m_num_steps;     }
+
+    /// Replica exchanges attempted/accepted by the last run
+    unsigned getNumExchanges()const            { return m_num_exchanges; }
+    unsigned getNumAcceptedExchanges()const    { return m_num_accepted;  }
+
+private:
+    //
+    // Uncopyable
+    //
+    SimulatedAnnealing( const SimulatedAnnealing& );
+    SimulatedAnnealing& operator=( const SimulatedAnnealing& );
+
+    struct Replica
     {
-    }
+        explicit Replica( uint32_t seed ) : rng( seed ), num_steps( 0 ) {}
 
+        State              state;
+        Energy             energy;
+        State              best_state;
+        Energy             best_energy;
+        legion::MTRand32   rng;
+        unsigned long long num_steps;
+    };
 
-    void run( const Graph::State& initial_state, Graph::State& solution_state )
+    /// Reusable rendezvous point for the worker threads of one run
+    class Barrier
     {
-        solution_state              = initial_state;
-        Graph::Energy lowest_energy = m_graph.evaluate( initial_state ); 
+    public:
+        explicit Barrier( unsigned count )
+            : m_count( count ), m_waiting( 0 ), m_generation( 0 ) {}
 
-        Graph::State  current_state  = initial_state;
-        Graph::Energy current_energy = lowest_energy;
-        while( !m_graph.isOptimal( best_score ) && !m_cooling_schedule.isFinished() )
+        void wait()
         {
-            m_graph.transition( current_state );
-            Graph::Energy new_energy = m_graph.evaluate( current_state );
-
-            if( current_energy < lowest_energy )
+            std::unique_lock<std::mutex> lock( m_mutex );
+            const unsigned generation = m_generation;
+            if( ++m_waiting == m_count )
             {
-                lowest_energy  = current_energy;
-                solution_state = current_state;
+                m_waiting = 0;
+                ++m_generation;
+                m_cv.notify_all();
+                return;
             }
+            while( generation == m_generation )
+                m_cv.wait( lock );
+        }
 
-            const float temperature = m_cooling_schedule.step();
-            const float p = m_transition_p.get( last_score, current_score, temperature );
-            const float e = drand48();
-            if( p > e )
-            {
-                cur_energy = new_energy;
-            }
-            else
+    private:
+        std::mutex              m_mutex;
+        std::condition_variable m_cv;
+        unsigned                m_count;
+        unsigned                m_waiting;
+        unsigned                m_generation;
+    };
+
+    void workerLoop( unsigned worker, unsigned num_workers, Barrier& barrier );
+    void anneal( Replica& replica, float temperature )
+    {
+        KPROFILE_SCOPE( "SimulatedAnnealing::anneal" );
+        anneal( replica, temperature, HasDeltaEnergy<Graph>() );
+    }
+
+    void anneal( Replica& replica, float temperature, std::false_type );
+    void anneal( Replica& replica, float temperature, std::true_type );
+
+    void acceptedEnergy( Replica& replica, Energy energy );
+    bool beginRound();
+    void exchange();
+
+
+    const Graph&           m_graph;
+    const CoolingSchedule  m_initial_schedule;
+    CoolingSchedule        m_cooling_schedule;  ///< Restarted by each run()
+    TransitionP            m_transition_p;
+    Options                m_options;
+
+    std::vector<Replica*>  m_replicas;
+    std::vector<float>     m_ladder;        ///< Base temperature, coldest first
+    std::vector<unsigned>  m_assignment;    ///< Replica at each ladder rung
+    float                  m_scale;         ///< From the cooling schedule
+    bool                   m_done;
+    unsigned               m_round;
+    legion::MTRand32       m_exchange_rng;
+
+    unsigned long long     m_num_steps;
+    unsigned               m_num_exchanges;
+    unsigned               m_num_accepted;
+};
+
+
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::SimulatedAnnealing(
+        const Graph&    graph,
+        CoolingSchedule cooling_schedule,
+        TransitionP     transition_p,
+        const Options&  options )
+    : m_graph( graph ),
+      m_initial_schedule( cooling_schedule ),
+      m_cooling_schedule( cooling_schedule ),
+      m_transition_p( transition_p ),
+      m_options( options ),
+      m_scale( 1.0f ),
+      m_done( false ),
+      m_round( 0 ),
+      m_exchange_rng( options.seed ),
+      m_num_steps( 0 ),
+      m_num_exchanges( 0 ),
+      m_num_accepted( 0 )
+{
+    assert( m_options.num_replicas > 0 );
+    assert( m_options.min_temperature > 0.0f );
+    assert( m_options.min_temperature <= m_options.max_temperature );
+
+    //
+    // Geometric ladder so neighboring rungs have similar exchange rates
+    //
+    const unsigned n = m_options.num_replicas;
+    const float ratio = n > 1 ?
+        powf( m_options.max_temperature / m_options.min_temperature,
+              1.0f / static_cast<float>( n - 1 ) ) :
+        1.0f;
+    float temperature = n > 1 ? m_options.min_temperature :
+                                m_options.max_temperature;
+    for( unsigned i = 0; i < n; ++i, temperature *= ratio )
+        m_ladder.push_back( temperature );
+}
+
+
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+typename SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::Energy
+SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::run(
+        const State& initial_state,
+        State&       solution_state )
+{
+    KPROFILE_SCOPE( "SimulatedAnnealing::run" );
+    const Energy initial_energy = m_graph.evaluate( initial_state );
+
+    m_replicas.clear();
+    m_assignment.clear();
+    for( unsigned i = 0; i < m_options.num_replicas; ++i )
+    {
+        // Seeds are spread by a large odd constant to decorrelate streams
+        Replica* replica = new Replica( m_options.seed + 0x9e3779b9u*( i+1 ) );
+        replica->state       = initial_state;
+        replica->energy      = initial_energy;
+        replica->best_state  = initial_state;
+        replica->best_energy = initial_energy;
+        m_replicas.push_back( replica );
+        m_assignment.push_back( i );
+    }
+
+    m_cooling_schedule  = m_initial_schedule;
+    m_done              = m_graph.isOptimal( initial_energy );
+    m_round             = 0;
+    m_num_exchanges     = 0;
+    m_num_accepted      = 0;
+
+    unsigned num_threads = m_options.num_threads;
+    if( num_threads == 0 )
+        num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+    num_threads = std::min( num_threads, m_options.num_replicas );
+
+    if( !m_done )
+    {
+        m_done = !beginRound();
+
+        Barrier barrier( num_threads );
+        std::vector<std::thread> threads;
+        for( unsigned i = 1; i < num_threads; ++i )
+            threads.push_back( std::thread( &SimulatedAnnealing::workerLoop,
+                                            this, i, num_threads,
+                                            std::ref( barrier ) ) );
+        workerLoop( 0, num_threads, barrier );
+
+        for( unsigned i = 0; i < threads.size(); ++i )
+            threads[ i ].join();
+    }
+
+    //
+    // Collect the best state over all replicas
+    //
+    unsigned best = 0;
+    m_num_steps   = 0;
+    for( unsigned i = 0; i < m_replicas.size(); ++i )
+    {
+        m_num_steps += m_replicas[ i ]->num_steps;
+        if( m_replicas[ i ]->best_energy < m_replicas[ best ]->best_energy )
+            best = i;
+    }
+
+    // Re-evaluate since delta updated energies carry rounding error
+    solution_state = m_replicas[ best ]->best_state;
+    const Energy lowest_energy = m_graph.evaluate( solution_state );
+
+    for( unsigned i = 0; i < m_replicas.size(); ++i )
+        delete m_replicas[ i ];
+    m_replicas.clear();
+
+    return lowest_energy;
+}
+
+
+//
+// Each worker anneals the rungs rung % num_workers == worker for one round,
+// then all meet at the barrier while worker 0 exchanges replicas and advances
+// the cooling schedule.
+//
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+void SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::workerLoop(
+        unsigned worker,
+        unsigned num_workers,
+        Barrier& barrier )
+{
+    while( !m_done )
+    {
+        for( unsigned rung = worker; rung < m_ladder.size(); rung += num_workers )
+            anneal( *m_replicas[ m_assignment[ rung ] ], m_ladder[ rung ]*m_scale );
+
+        {
+            KPROFILE_SCOPE( "SimulatedAnnealing::wait" );
+            barrier.wait();
+        }
+        if( worker == 0 )
+        {
+            exchange();
+            m_done = !beginRound();
+        }
+        KPROFILE_SCOPE( "SimulatedAnnealing::wait" );
+        barrier.wait();
+    }
+}
+
+
+//
+// Full evaluation: apply the transition, score the whole state, revert if
+// rejected
+//
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+void SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::anneal(
+        Replica& replica,
+        float    temperature,
+        std::false_type )
+{
+    for( unsigned i = 0; i < m_options.steps_per_exchange; ++i )
+    {
+        m_graph.transition( replica.state, replica.rng );
+        const Energy new_energy = m_graph.evaluate( replica.state );
+
+        const float p = m_transition_p.get( replica.energy, new_energy, temperature );
+        if( p >= 1.0f || replica.rng() < p )
+        {
+            acceptedEnergy( replica, new_energy );
+            if( m_graph.isOptimal( replica.energy ) )
             {
-                m_graph.revert( current_state );
+                replica.num_steps += i+1;
+                return;
             }
         }
+        else
+        {
+            m_graph.revert( replica.state );
+        }
     }
+    replica.num_steps += m_options.steps_per_exchange;
+}
 
-private:
-    Graph&          m_graph;
-    CoolingSchedule m_cooling_schedule;
-    TransitionP     m_transition_p;
-};
 
+//
+// Delta evaluation: score the proposed move and only touch the state if it
+// is accepted.  The running energy is a sum of deltas, so resync it with a
+// full evaluation at the end of each round to stop rounding error piling up.
+//
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+void SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::anneal(
+        Replica& replica,
+        float    temperature,
+        std::true_type )
+{
+    unsigned i = 0;
+    while( i < m_options.steps_per_exchange )
+    {
+        ++i;
+        const std::pair<typename Graph::Move, Energy> proposal =
+            m_graph.proposeDelta( replica.state, replica.rng );
+        const Energy new_energy = replica.energy + proposal.second;
+
+        const float p = m_transition_p.get( replica.energy, new_energy, temperature );
+        if( p >= 1.0f || replica.rng() < p )
+        {
+            m_graph.commit( replica.state, proposal.first );
+            acceptedEnergy( replica, new_energy );
+            if( m_graph.isOptimal( replica.energy ) )
+                break;
+        }
+    }
+    replica.num_steps += i;
+
+    replica.energy = m_graph.evaluate( replica.state );
+}
+
+
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+void SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::acceptedEnergy(
+        Replica& replica,
+        Energy   energy )
+{
+    replica.energy = energy;
+    if( energy < replica.best_energy )
+    {
+        replica.best_energy = energy;
+        replica.best_state  = replica.state;
+    }
+}
+
+
+/// Advance the schedule.  Returns false once annealing should stop.
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+bool SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::beginRound()
+{
+    for( unsigned i = 0; i < m_replicas.size(); ++i )
+        if( m_graph.isOptimal( m_replicas[ i ]->best_energy ) )
+            return false;
+
+    if( m_cooling_schedule.finished() )
+        return false;
+
+    m_scale = m_cooling_schedule.step();
+    ++m_round;
+    return true;
+}
+
+
+//
+// Offer swaps between neighboring rungs, alternating even and odd pairs from
+// round to round.  A swap of the states at temperatures Ti < Tj is accepted
+// with probability min( 1, exp( ( 1/Ti - 1/Tj )*( Ei - Ej ) ) ).
+//
+template< typename Graph, typename CoolingSchedule, typename TransitionP >
+void SimulatedAnnealing<Graph, CoolingSchedule, TransitionP>::exchange()
+{
+    KPROFILE_SCOPE( "SimulatedAnnealing::exchange" );
+    if( m_scale <= 0.0f )
+        return;
+
+    for( unsigned rung = m_round % 2; rung+1 < m_ladder.size(); rung += 2 )
+    {
+        const Replica& cold = *m_replicas[ m_assignment[ rung   ] ];
+        const Replica& hot  = *m_replicas[ m_assignment[ rung+1 ] ];
+
+        const float beta_cold = 1.0f / ( m_ladder[ rung   ]*m_scale );
+        const float beta_hot  = 1.0f / ( m_ladder[ rung+1 ]*m_scale );
+        const float delta     = ( beta_cold - beta_hot ) *
+                                ( static_cast<float>( cold.energy ) -
+                                  static_cast<float>( hot.energy ) );
+
+        ++m_num_exchanges;
+        if( delta >= 0.0f || m_exchange_rng() < expf( delta ) )
+        {
+            ++m_num_accepted;
+            std::swap( m_assignment[ rung ], m_assignment[ rung+1 ] );
+        }
+    }
+}
 
-#endif // SIMULATED_ANNEALING_H_
 
+#endif // KLIB_SIMULATED_ANNEALING_H_
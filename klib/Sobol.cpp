@@ -1,52 +1,230 @@
 
 #include "Sobol.hpp"
 
-using namespace legion;
+#include <cassert>
+#include <vector>
 
+#if defined( __SSE2__ )
+#include <immintrin.h>
+#endif
 
-struct uint4
-{
-  unsigned x;
-  unsigned y;
-  unsigned z;
-  unsigned w;
-};
+using namespace legion;
 
 
 unsigned Sobol::genu( unsigned i, unsigned dim,  unsigned s )
 {
-    const unsigned int adr = dim*(52/4);
+    // Each dimension's matrix is 52 words: 32 direction numbers for the
+    // index bits followed by 20 for the scramble bits
+    const unsigned* matrix = MATRICES + dim*52u;
     unsigned int result = 0;
 
-    for (unsigned int c = 0; (i != 0); i>>=8, c+=2) {
+    for (unsigned int c = 0; (i != 0); i>>=8, c+=8) {
+        result ^= (((matrix[c+0]&(unsigned)(-((int) i     & 1)))   ^
+                    (matrix[c+1]&(unsigned)(-((int)(i>>1) & 1))))  ^
+                   ((matrix[c+2]&(unsigned)(-((int)(i>>2) & 1)))   ^
+                    (matrix[c+3]&(unsigned)(-((int)(i>>3) & 1))))) ^
+                  (((matrix[c+4]&(unsigned)(-((int)(i>>4) & 1)))   ^
+                    (matrix[c+5]&(unsigned)(-((int)(i>>5) & 1))))  ^
+                   ((matrix[c+6]&(unsigned)(-((int)(i>>6) & 1)))   ^
+                    (matrix[c+7]&(unsigned)(-((int)(i>>7) & 1)))));
+    }
+
+    for (unsigned c = 32; ((s != 0) && (c < 52)); s>>=4, c+=4) {
+        result ^= (((matrix[c+0]&(unsigned)(-((int) s     & 1)))  ^
+                    (matrix[c+1]&(unsigned)(-((int)(s>>1) & 1)))) ^
+                   ((matrix[c+2]&(unsigned)(-((int)(s>>2) & 1)))  ^
+                    (matrix[c+3]&(unsigned)(-((int)(s>>3) & 1)))));
+    }
+
+    return result;
+}
+
+
+namespace
+{
+
+inline unsigned countTrailingZeros( unsigned x )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctz( x );
+#else
+    unsigned n = 0;
+    for( ; !( x & 1u ); x >>= 1 )
+        ++n;
+    return n;
+#endif
+}
 
-        //const Index4 matrix1 = reinterpret_cast<const Index4*>( MATRICES )[adr + c + 0];
-        //const Index4 matrix2 = reinterpret_cast<const Index4*>( MATRICES )[adr + c + 1];
-        const uint4 matrix1 = reinterpret_cast<const uint4*>( MATRICES )[adr + c + 0];
-        const uint4 matrix2 = reinterpret_cast<const uint4*>( MATRICES )[adr + c + 1];
 
-        result ^= (((matrix1.x&(unsigned)(-((int) i     & 1)))   ^
-                    (matrix1.y&(unsigned)(-((int)(i>>1) & 1))))  ^
-                   ((matrix1.z&(unsigned)(-((int)(i>>2) & 1)))   ^
-                    (matrix1.w&(unsigned)(-((int)(i>>3) & 1))))) ^
-                  (((matrix2.x&(unsigned)(-((int)(i>>4) & 1)))   ^
-                    (matrix2.y&(unsigned)(-((int)(i>>5) & 1))))  ^
-                   ((matrix2.z&(unsigned)(-((int)(i>>6) & 1)))   ^
-                    (matrix2.w&(unsigned)(-((int)(i>>7) & 1)))));
+/// row[ d ] = prev[ d ] ^ delta[ d ] for d in [0, count).  row may alias prev.
+inline void xorRow( const unsigned* prev,
+                    const unsigned* delta,
+                    unsigned*       row,
+                    unsigned        count )
+{
+    unsigned d = 0;
+#if defined( __AVX2__ )
+    for( ; d+8 <= count; d += 8 )
+    {
+        const __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( prev  + d ) );
+        const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( delta + d ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( row + d ), _mm256_xor_si256( a, b ) );
+    }
+#endif
+#if defined( __SSE2__ )
+    for( ; d+4 <= count; d += 4 )
+    {
+        const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( prev  + d ) );
+        const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( delta + d ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( row + d ), _mm_xor_si128( a, b ) );
     }
+#endif
+    for( ; d < count; ++d )
+        row[ d ] = prev[ d ] ^ delta[ d ];
+}
+
 
-    for (unsigned c = 8; ((s != 0) && (c < 13)); s>>=4, ++c) {
-        //const Index4 matrix1 = reinterpret_cast<const Index4*>( MATRICES )[adr + c];
-        const uint4 matrix1 = reinterpret_cast<const uint4*>( MATRICES )[adr + c];
-        result ^= (((matrix1.x&(unsigned)(-((int) s     & 1)))  ^
-                    (matrix1.y&(unsigned)(-((int)(s>>1) & 1)))) ^
-                   ((matrix1.z&(unsigned)(-((int)(s>>2) & 1)))  ^
-                    (matrix1.w&(unsigned)(-((int)(s>>3) & 1)))));
+/// Same mapping to [0,1) as Sobol::gen
+inline void toFloats( const unsigned* in, float* out, unsigned count )
+{
+    unsigned d = 0;
+#if defined( __AVX2__ )
+    {
+        const __m256i exponent = _mm256_set1_epi32( 0x3F800000 );
+        const __m256  one      = _mm256_set1_ps( 1.0f );
+        for( ; d+8 <= count; d += 8 )
+        {
+            const __m256i u = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( in + d ) );
+            const __m256i f = _mm256_or_si256( _mm256_srli_epi32( u, 9 ), exponent );
+            _mm256_storeu_ps( out + d, _mm256_sub_ps( _mm256_castsi256_ps( f ), one ) );
+        }
+    }
+#endif
+#if defined( __SSE2__ )
+    {
+        const __m128i exponent = _mm_set1_epi32( 0x3F800000 );
+        const __m128  one      = _mm_set1_ps( 1.0f );
+        for( ; d+4 <= count; d += 4 )
+        {
+            const __m128i u = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + d ) );
+            const __m128i f = _mm_or_si128( _mm_srli_epi32( u, 9 ), exponent );
+            _mm_storeu_ps( out + d, _mm_sub_ps( _mm_castsi128_ps( f ), one ) );
+        }
     }
+#endif
+    for( ; d < count; ++d )
+    {
+        const unsigned bits = 0x3F800000u | ( in[ d ] >> 9 );
+        float f;
+        memcpy( &f, &bits, sizeof( f ) );
+        out[ d ] = f - 1.0f;
+    }
+}
 
-    return result;
+
+//
+// Going from index i to i+1 flips bits 0..k of i where k = ctz( i+1 ), so
+// the next vector is the current one XORed with the prefix sum of the first
+// k+1 direction numbers.  Tabulate those prefix sums, bit-major so that the
+// row for bit k is contiguous over the requested dimensions.
+//
+void buildDeltaTable( unsigned dim, unsigned num_dims, std::vector<unsigned>& delta )
+{
+    delta.resize( 32*num_dims );
+    for( unsigned d = 0; d < num_dims; ++d )
+    {
+        const unsigned* matrix = Sobol::MATRICES + ( dim+d )*52u;
+        unsigned sum = 0u;
+        for( unsigned k = 0; k < 32; ++k )
+        {
+            sum ^= matrix[ k ];
+            delta[ k*num_dims + d ] = sum;
+        }
+    }
+}
+
+}
+
+
+void Sobol::genuBatch( unsigned first, unsigned n,
+                       unsigned dim,   unsigned num_dims,
+                       unsigned* out,  unsigned scramble )
+{
+    assert( dim + num_dims <= MAX_DIMS );
+    assert( n == 0 || static_cast<unsigned long long>( first ) + n <= ( 1ull << 32 ) );
+
+    if( n == 0 || num_dims == 0 )
+        return;
+
+    std::vector<unsigned> delta;
+    buildDeltaTable( dim, num_dims, delta );
+
+    for( unsigned d = 0; d < num_dims; ++d )
+        out[ d ] = genu( first, dim+d, scramble );
+
+    for( unsigned j = 1; j < n; ++j )
+    {
+        const unsigned k = countTrailingZeros( first+j );
+        xorRow( out + ( j-1 )*num_dims, &delta[ k*num_dims ], out + j*num_dims, num_dims );
+    }
 }
 
+
+void Sobol::genBatch( unsigned first, unsigned n,
+                      unsigned dim,   unsigned num_dims,
+                      float* out,     unsigned scramble )
+{
+    assert( dim + num_dims <= MAX_DIMS );
+    assert( n == 0 || static_cast<unsigned long long>( first ) + n <= ( 1ull << 32 ) );
+
+    if( n == 0 || num_dims == 0 )
+        return;
+
+    std::vector<unsigned> delta;
+    buildDeltaTable( dim, num_dims, delta );
+
+    std::vector<unsigned> current( num_dims );
+    for( unsigned d = 0; d < num_dims; ++d )
+        current[ d ] = genu( first, dim+d, scramble );
+    toFloats( &current[ 0 ], out, num_dims );
+
+    for( unsigned j = 1; j < n; ++j )
+    {
+        const unsigned k = countTrailingZeros( first+j );
+        xorRow( &current[ 0 ], &delta[ k*num_dims ], &current[ 0 ], num_dims );
+        toFloats( &current[ 0 ], out + j*num_dims, num_dims );
+    }
+}
+
+
+void Sobol::split( unsigned stride, unsigned num_streams,
+                   std::vector<Stream>& streams, unsigned scramble )
+{
+    assert( static_cast<unsigned long long>( stride )*num_streams <= ( 1ull << 32 ) );
+
+    streams.clear();
+    streams.reserve( num_streams );
+    for( unsigned i = 0; i < num_streams; ++i )
+        streams.push_back( Stream( i*stride, stride, scramble ) );
+}
+
+
+void Sobol::Stream::genuBatch( unsigned n, unsigned dim, unsigned num_dims, unsigned* out )
+{
+    assert( m_position + n <= m_size );
+    Sobol::genuBatch( m_first+m_position, n, dim, num_dims, out, m_scramble );
+    m_position += n;
+}
+
+
+void Sobol::Stream::genBatch( unsigned n, unsigned dim, unsigned num_dims, float* out )
+{
+    assert( m_position + n <= m_size );
+    Sobol::genBatch( m_first+m_position, n, dim, num_dims, out, m_scramble );
+    m_position += n;
+}
+
+
 const unsigned Sobol::MATRICES[ MAX_DIMS*52 ] =
 {
     0x80000000UL,
@@ -23,7 +23,8 @@
 #ifndef LEGION_COMMON_MATH_SOBOL_HPP_
 #define LEGION_COMMON_MATH_SOBOL_HPP_
 
-#include <Legion/Common/Math/Vector.hpp>
+#include <cstring>
+#include <vector>
 
 namespace legion
 {
@@ -51,6 +52,32 @@ public:
     static float    gen ( unsigned i, unsigned dim,  unsigned scramble = 0u );
     static unsigned genu( unsigned i, unsigned dim,  unsigned scramble = 0u );
 
+    /// Generate n consecutive Sobol vectors first, first+1, ... restricted to
+    /// dimensions [dim, dim+num_dims).  Output is point-major:
+    /// out[ j*num_dims + d ] == genu( first+j, dim+d, scramble ).  Each
+    /// vector costs one table row XOR per dimension, vectorized with
+    /// SSE2/AVX2 where available.  first+n must not exceed 2^32.
+    static void     genuBatch( unsigned first, unsigned n,
+                               unsigned dim,   unsigned num_dims,
+                               unsigned* out,  unsigned scramble = 0u );
+
+    /// As genuBatch, converted to floats in [0,1) as by gen()
+    static void     genBatch ( unsigned first, unsigned n,
+                               unsigned dim,   unsigned num_dims,
+                               float* out,     unsigned scramble = 0u );
+
+    class Stream;
+
+    /// Split vectors [0, stride*num_streams) into num_streams consecutive
+    /// ranges of stride vectors, one per worker.  Reading streams[0],
+    /// streams[1], ... to the end visits every vector once, in order, so
+    /// results do not depend on how the streams are scheduled.  Sobol
+    /// vectors are addressed by index, so this is only bookkeeping;
+    /// differing scrambles give correlated, not independent, sequences.
+    static void     split( unsigned stride, unsigned num_streams,
+                           std::vector<Stream>& streams,
+                           unsigned scramble = 0u );
+
 
     static const unsigned MAX_DIMS = 256u;
     static const unsigned MATRICES[ MAX_DIMS*52u ];
@@ -61,6 +88,36 @@ private:
 };
 
 
+/// Vectors [first, first+size) of a scrambled Sobol sequence, read in order
+class Sobol::Stream
+{
+public:
+    Stream( unsigned first = 0u, unsigned size = 0u, unsigned scramble = 0u )
+        : m_first( first ), m_size( size ), m_position( 0u ), m_scramble( scramble ) {}
+
+    unsigned first()    const { return m_first;    }
+    unsigned size()     const { return m_size;     }
+    unsigned position() const { return m_position; }
+    bool     done()     const { return m_position >= m_size; }
+
+    /// Element dim of the current vector
+    float    gen ( unsigned dim ) const { return Sobol::gen ( m_first+m_position, dim, m_scramble ); }
+    unsigned genu( unsigned dim ) const { return Sobol::genu( m_first+m_position, dim, m_scramble ); }
+
+    /// Move on to the next vector
+    void     next() { ++m_position; }
+
+    /// The next n vectors as by Sobol::genuBatch/genBatch, moving past them
+    void     genuBatch( unsigned n, unsigned dim, unsigned num_dims, unsigned* out );
+    void     genBatch ( unsigned n, unsigned dim, unsigned num_dims, float* out );
+
+private:
+    unsigned m_first;
+    unsigned m_size;
+    unsigned m_position;
+    unsigned m_scramble;
+};
+
 
 inline float Sobol::gen( unsigned i, unsigned dim,  unsigned scramble )
 {
@@ -70,7 +127,9 @@ inline float Sobol::gen( unsigned i, unsigned dim,  unsigned scramble )
 
 inline float Sobol::intAsFloat( int x )
 {
-  return *(float*)&x;
+  float f;
+  memcpy( &f, &x, sizeof( f ) );
+  return f;
 }
 
 
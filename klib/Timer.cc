@@ -9,7 +9,7 @@
 // gettimeofday based implementation for linux
 //
 
-#include <sys/Time.h>
+#include <sys/time.h>
 
 namespace
 {
@@ -0,0 +1,181 @@
+#ifndef KLIB_TEST_GRID_GRAPH_H_
+#define KLIB_TEST_GRID_GRAPH_H_
+
+#include <cstdlib>
+#include <ostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Simple 2D grid based graph class for testing A* search
+//
+//------------------------------------------------------------------------------
+class Graph
+{
+public:
+
+    struct Tile
+    {
+        Tile() : is_wall( false ), is_path( false ) {}
+        bool is_wall;
+        bool is_path;
+    };
+
+
+    class Node
+    {
+    public:
+
+        Node() : x( 0 ), y( 0 ) {}
+        Node( int x, int y ) : x( x ), y( y ) {}
+
+        bool operator<(  const Node& node1 )const
+        {
+            return ( x <  node1.x ) ||
+                   ( x == node1.x && y < node1.y );
+        }
+
+        bool operator==(  const Node& node1 )const
+        {
+            return x == node1.x && y == node1.y;
+        }
+
+        int x, y;
+    };
+
+
+    Graph( int x, int y )
+        : m_x( x ), m_y( y )
+    {
+        m_grid = new Tile*[ m_x ];
+        for( int i = 0; i < m_x; ++i )
+            m_grid[ i ] = new Tile[ m_y ];
+    }
+
+
+    ~Graph()
+    {
+        for( int i = 0; i < m_x; ++i )
+            delete [] m_grid[ i ]; 
+        delete [] m_grid;
+
+    }
+
+    float getCostHeuristic( const Node& node0, const Node& node1 )const
+    {
+        // Manhattan dist
+        return static_cast<float>( abs( node0.x - node1.x ) +
+                                   abs( node0.y - node1.y ) );
+    }
+
+    float getCost( const Node& node0, const Node& node1 )const
+    {
+        return 1.0f;
+    }
+
+    bool inRange( const Node& node )const
+    {
+        return node.x >= 0 && node.x < m_x-1  && node.y >= 0 && node.y < m_y-1;
+    }
+
+    // GridGraph trait for JumpPointSearch
+    int  width()const   { return m_x; }
+    int  height()const  { return m_y; }
+
+    bool isPassable( int x, int y )const
+    {
+        return inRange( Node( x, y ) ) && !m_grid[ x ][ y ].is_wall;
+    }
+
+    void getNeighbors( const Node& node, std::vector<Node>& neighbors )const
+    {
+
+        Node neighbor;
+        neighbor.x = node.x-1;
+        neighbor.y = node.y+0;
+        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
+            neighbors.push_back( neighbor );
+
+        neighbor.x = node.x+1;
+        neighbor.y = node.y+0;
+        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
+            neighbors.push_back( neighbor );
+        
+        neighbor.x = node.x+0;
+        neighbor.y = node.y-1;
+        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
+            neighbors.push_back( neighbor );
+
+        neighbor.x = node.x+0;
+        neighbor.y = node.y+1;
+        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
+            neighbors.push_back( neighbor );
+    }
+
+
+    int m_x, m_y;
+    Tile** m_grid;
+};
+
+
+//------------------------------------------------------------------------------
+//
+// Same grid, additionally providing the dense index trait so AStar keeps its
+// per-node state in flat arrays
+//
+//------------------------------------------------------------------------------
+class IndexedGraph : public Graph
+{
+public:
+    IndexedGraph( int x, int y ) : Graph( x, y ) {}
+
+    unsigned index( const Node& node )const  { return node.x*m_y + node.y; }
+    unsigned numNodes()const                 { return m_x*m_y;             }
+};
+
+
+//
+// Serpentine walls every m_x/8 columns, alternately open at top and bottom,
+// so a search between opposite corners has to sweep most of the grid
+//
+inline void buildSerpentineMaze( Graph& graph )
+{
+    const int spacing = graph.m_x / 8;
+    for( int x = spacing, k = 0; x < graph.m_x - 2; x += spacing, ++k )
+    {
+        const int gap_begin = ( k % 2 == 0 ) ? graph.m_y - 8 : 0;
+        const int gap_end   = ( k % 2 == 0 ) ? graph.m_y     : 8;
+        for( int y = 0; y < graph.m_y; ++y )
+            if( y < gap_begin || y >= gap_end )
+                graph.m_grid[ x ][ y ].is_wall = true;
+    }
+}
+
+
+inline std::ostream& operator<<( std::ostream& out, const Graph::Node& node )
+{
+    out << "[" << node.x << "," << node.y << "]";
+    return out;
+}
+
+inline std::ostream& operator<<( std::ostream& out, const Graph& graph )
+{
+    for( int i = 0; i < graph.m_x; ++i )
+    {
+        for( int j = 0; j < graph.m_y; ++j )
+        {
+            if( graph.m_grid[j][i].is_wall )
+                out << "X ";
+            else if( graph.m_grid[j][i].is_path )
+                out << "o ";
+            else 
+                out << ". ";
+        }
+        out << std::endl;
+    }
+
+    return out;
+}
+
+
+#endif // KLIB_TEST_GRID_GRAPH_H_
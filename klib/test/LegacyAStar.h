@@ -0,0 +1,173 @@
+#ifndef KLIB_TEST_LEGACY_ASTAR_H_
+#define KLIB_TEST_LEGACY_ASTAR_H_
+
+//
+// Snapshot of the original AStar open set handling (linear find_if over the
+// open queue followed by a full make_heap on every decrease-key).  Kept only
+// as a baseline for astar_bench -- do not use in new code.
+//
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+
+template <typename Graph>
+class LegacyAStar
+{
+public:
+    typedef typename Graph::Node       GraphNode;
+    typedef std::vector<GraphNode>     GraphNodeVec;
+
+    LegacyAStar( const Graph&     graph,
+                 unsigned         max_depth,
+                 const GraphNode& origin,
+                 const GraphNode& destination )
+        : m_graph( graph ),
+          m_destination( destination ),
+          m_max_depth( max_depth ),
+          m_destination_node( 0 ),
+          m_steps( 0 ),
+          m_updates( 0 )
+    {
+        pushNode( origin, 0.0f, m_graph.getCostHeuristic( origin, destination ), 0 );
+    }
+
+    ~LegacyAStar()
+    {
+        for( unsigned i = 0; i < m_all_nodes.size(); ++i )
+            delete m_all_nodes[ i ];
+    }
+
+    bool search()
+    {
+        while( !m_open_queue.empty() )
+            if( step() )
+                return true;
+        return false;
+    }
+
+    void getPath( GraphNodeVec& path )const
+    {
+        for( Node* current = m_destination_node; current->prev; current = current->prev )
+            path.push_back( current->graph_node );
+        std::reverse( path.begin(), path.end() );
+    }
+
+    int getNumSteps()const   { return m_steps;   }
+    int getNumUpdates()const { return m_updates; }
+
+private:
+    LegacyAStar( const LegacyAStar& );
+    LegacyAStar& operator=( const LegacyAStar& );
+
+    struct Node
+    {
+        Node( const GraphNode& graph_node, float g, float h, Node* prev )
+            : graph_node( graph_node ), g( g ), h( h ), prev( prev ) {}
+
+        float f()const { return g+h; }
+
+        GraphNode graph_node;
+        float g;
+        float h;
+        Node* prev;
+    };
+
+    struct HeapCompare
+    {
+        bool operator()( const Node* n0, const Node* n1 )const
+        {
+            return ( n0->f() >  n1->f() ) ||
+                   ( n0->f() == n1->f() && n0->h > n1->h );
+        }
+    };
+
+    struct HasGraphNode
+    {
+        HasGraphNode( const GraphNode& graph_node ) : graph_node( graph_node ) {}
+        bool operator()( Node* node )const { return node->graph_node == graph_node; }
+        GraphNode graph_node;
+    };
+
+    void pushNode( const GraphNode& graph_node, float g, float h, Node* prev )
+    {
+        m_open_set.insert( graph_node );
+        Node* node = new Node( graph_node, g, h, prev );
+        m_all_nodes.push_back( node );
+        m_open_queue.push_back( node );
+        std::push_heap( m_open_queue.begin(), m_open_queue.end(), HeapCompare() );
+    }
+
+    bool step()
+    {
+        m_steps++;
+
+        Node* current = m_open_queue.front();
+        std::pop_heap( m_open_queue.begin(), m_open_queue.end(), HeapCompare() );
+        m_open_queue.pop_back();
+        m_open_set.erase( current->graph_node );
+        m_closed_set.insert( current->graph_node );
+
+        if( current->graph_node == m_destination )
+        {
+            m_destination_node = current;
+            return true;
+        }
+
+        if( current->f() < m_max_depth )
+        {
+            m_neighbors.clear();
+            m_graph.getNeighbors( current->graph_node, m_neighbors );
+
+            for( typename GraphNodeVec::iterator neighbor = m_neighbors.begin();
+                 neighbor != m_neighbors.end();
+                 ++neighbor )
+            {
+                float neighbor_g = current->g +
+                                   m_graph.getCost( current->graph_node, *neighbor );
+
+                if( m_open_set.find( *neighbor ) != m_open_set.end() )
+                {
+                    Node* open_node = *std::find_if( m_open_queue.begin(),
+                                                     m_open_queue.end(),
+                                                     HasGraphNode( *neighbor ) );
+                    if( neighbor_g < open_node->g )
+                    {
+                        m_updates++;
+                        open_node->g    = neighbor_g;
+                        open_node->prev = current;
+                        std::make_heap( m_open_queue.begin(),
+                                        m_open_queue.end(),
+                                        HeapCompare() );
+                    }
+                    continue;
+                }
+
+                if( m_closed_set.find( *neighbor ) != m_closed_set.end() )
+                    continue;
+
+                float neighbor_h = m_graph.getCostHeuristic( *neighbor, m_destination );
+                if( neighbor_h + neighbor_g < m_max_depth )
+                    pushNode( *neighbor, neighbor_g, neighbor_h, current );
+            }
+        }
+        return false;
+    }
+
+    std::vector<Node*>    m_open_queue;
+    std::set<GraphNode>   m_open_set;
+    std::set<GraphNode>   m_closed_set;
+    GraphNodeVec          m_neighbors;
+    std::vector<Node*>    m_all_nodes;
+
+    const Graph&          m_graph;
+    const GraphNode       m_destination;
+    unsigned              m_max_depth;
+    Node*                 m_destination_node;
+    int                   m_steps;
+    int                   m_updates;
+};
+
+
+#endif // KLIB_TEST_LEGACY_ASTAR_H_
@@ -0,0 +1,272 @@
+#include "../MTRand.hpp"
+#include "../SimulatedAnnealing.h"
+#include "../Timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Euclidean TSP on random cities in the unit square, solved by 2-opt moves.
+// Compares single replica simulated annealing with parallel tempering at the
+// same total step budget, and parallel tempering over 1..8 threads, once with
+// full evaluation after every move and once through the delta energy trait.
+// Checks that every returned tour is a permutation whose length matches the
+// reported energy, and that results do not depend on the thread count.
+//
+// Usage: anneal_bench [cities, default 200] [rounds, default 200]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+class TSPGraph
+{
+public:
+    typedef float Energy;
+
+    struct State
+    {
+        State() : i( 0 ), j( 0 ) {}
+
+        std::vector<int> tour;
+        int              i, j;   ///< Last reversed segment, for revert()
+    };
+
+    TSPGraph( int num_cities, uint32_t seed )
+    {
+        legion::MTRand32 rng( seed );
+        for( int i = 0; i < num_cities; ++i )
+        {
+            m_x.push_back( rng() );
+            m_y.push_back( rng() );
+        }
+    }
+
+    int numCities()const { return m_x.size(); }
+
+    float distance( int a, int b )const
+    {
+        const float dx = m_x[ a ] - m_x[ b ];
+        const float dy = m_y[ a ] - m_y[ b ];
+        return sqrtf( dx*dx + dy*dy );
+    }
+
+    Energy evaluate( const State& state )const
+    {
+        const std::vector<int>& tour = state.tour;
+        float length = distance( tour.back(), tour.front() );
+        for( unsigned i = 1; i < tour.size(); ++i )
+            length += distance( tour[ i-1 ], tour[ i ] );
+        return length;
+    }
+
+    bool isOptimal( Energy )const { return false; }
+
+    void transition( State& state, legion::MTRand32& rng )const
+    {
+        const int n = state.tour.size();
+        int i = rng.next() % n;
+        int j = rng.next() % ( n-1 );
+        if( j >= i ) ++j;
+        if( i > j ) std::swap( i, j );
+
+        state.i = i;
+        state.j = j;
+        std::reverse( state.tour.begin() + i, state.tour.begin() + j + 1 );
+    }
+
+    void revert( State& state )const
+    {
+        std::reverse( state.tour.begin() + state.i, state.tour.begin() + state.j + 1 );
+    }
+
+private:
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+};
+
+
+//
+// Same problem with the delta energy trait: a 2-opt move only changes the
+// two edges at the ends of the reversed segment
+//
+class DeltaTSPGraph : public TSPGraph
+{
+public:
+    struct Move
+    {
+        int i, j;
+    };
+
+    DeltaTSPGraph( int num_cities, uint32_t seed ) : TSPGraph( num_cities, seed ) {}
+
+    std::pair<Move, Energy> proposeDelta( const State& state, legion::MTRand32& rng )const
+    {
+        const std::vector<int>& tour = state.tour;
+        const int n = tour.size();
+        Move move;
+        move.i = rng.next() % n;
+        move.j = rng.next() % ( n-1 );
+        if( move.j >= move.i ) ++move.j;
+        if( move.i > move.j ) std::swap( move.i, move.j );
+
+        // Reversing the whole tour leaves its length unchanged
+        if( move.i == 0 && move.j == n-1 )
+            return std::make_pair( move, 0.0f );
+
+        const int a = tour[ ( move.i + n - 1 ) % n ];
+        const int b = tour[ move.i ];
+        const int c = tour[ move.j ];
+        const int d = tour[ ( move.j + 1 ) % n ];
+        return std::make_pair( move, distance( a, c ) + distance( b, d ) -
+                                     distance( a, b ) - distance( c, d ) );
+    }
+
+    void commit( State& state, const Move& move )const
+    {
+        std::reverse( state.tour.begin() + move.i, state.tour.begin() + move.j + 1 );
+    }
+};
+
+
+bool validTour( const TSPGraph& graph, const TSPGraph::State& state, float energy )
+{
+    std::vector<int> sorted( state.tour );
+    std::sort( sorted.begin(), sorted.end() );
+    for( int i = 0; i < graph.numCities(); ++i )
+        if( sorted[ i ] != i )
+            return false;
+    return fabsf( graph.evaluate( state ) - energy ) < 1e-3f;
+}
+
+
+typedef SimulatedAnnealingOptions AnnealerOptions;
+
+
+struct Result
+{
+    float  energy;
+    double seconds;
+    bool   valid;
+};
+
+
+template <typename Graph>
+Result bench( const char*            name,
+              const Graph&           graph,
+              const TSPGraph::State& initial,
+              unsigned               rounds,
+              const AnnealerOptions& options )
+{
+    SimulatedAnnealing<Graph, LinearCoolingSchedule, MetropolisTransitionP> annealer( graph, LinearCoolingSchedule( rounds ),
+                       MetropolisTransitionP(), options );
+
+    TSPGraph::State solution;
+    Timer timer;
+    timer.start();
+    const float energy = annealer.run( initial, solution );
+    const double seconds = timer.getTimeElapsed();
+
+    Result result;
+    result.energy  = energy;
+    result.seconds = seconds;
+    result.valid   = validTour( graph, solution, energy );
+
+    std::cout << std::setw( 24 ) << name
+              << std::setw( 10 ) << options.num_replicas
+              << std::setw( 10 ) << options.num_threads
+              << std::setw( 12 ) << annealer.getNumSteps()
+              << std::setw( 12 ) << std::fixed << std::setprecision( 4 ) << energy
+              << std::setw( 12 ) << std::setprecision( 3 )
+              << ( annealer.getNumExchanges() ?
+                   static_cast<float>( annealer.getNumAcceptedExchanges() ) /
+                   annealer.getNumExchanges() : 0.0f )
+              << std::setw( 12 ) << std::setprecision( 3 ) << seconds
+              << ( result.valid ? "" : "  INVALID" )
+              << std::endl;
+    return result;
+}
+
+
+/// Runs single replica annealing and parallel tempering over 1..8 threads
+template <typename Graph>
+bool benchAll( const char*            name,
+               const Graph&           graph,
+               const TSPGraph::State& initial,
+               unsigned               rounds )
+{
+    const unsigned replicas = 8;
+    bool ok = true;
+
+    std::cout << name << std::endl;
+
+    //
+    // Same total step budget: one replica gets replicas times the rounds
+    //
+    AnnealerOptions sa_options;
+    sa_options.num_replicas    = 1;
+    sa_options.num_threads     = 1;
+    sa_options.min_temperature = 0.002f;
+    sa_options.max_temperature = 0.05f;
+    ok = bench( "annealing", graph, initial, rounds*replicas, sa_options ).valid && ok;
+
+    AnnealerOptions pt_options;
+    pt_options.num_replicas    = replicas;
+    pt_options.min_temperature = 0.002f;
+    pt_options.max_temperature = 0.05f;
+
+    float reference_energy = 0.0f;
+    for( unsigned threads = 1; threads <= replicas; threads *= 2 )
+    {
+        pt_options.num_threads = threads;
+        const Result result = bench( "parallel tempering", graph, initial, rounds, pt_options );
+        ok = result.valid && ok;
+
+        if( threads == 1 )
+            reference_energy = result.energy;
+        else if( result.energy != reference_energy )
+        {
+            std::cerr << "  result depends on thread count" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const int      num_cities = argc > 1 ? atoi( argv[1] ) : 200;
+    const unsigned rounds     = argc > 2 ? atoi( argv[2] ) : 200;
+
+    TSPGraph      graph( num_cities, 1234 );
+    DeltaTSPGraph delta_graph( num_cities, 1234 );
+
+    TSPGraph::State initial;
+    for( int i = 0; i < num_cities; ++i )
+        initial.tour.push_back( i );
+
+    std::cout << "initial tour " << graph.evaluate( initial ) << std::endl;
+    std::cout << std::setw( 24 ) << "method"
+              << std::setw( 10 ) << "replicas"
+              << std::setw( 10 ) << "threads"
+              << std::setw( 12 ) << "steps"
+              << std::setw( 12 ) << "length"
+              << std::setw( 12 ) << "exch rate"
+              << std::setw( 12 ) << "seconds"
+              << std::endl;
+
+    bool ok = true;
+    ok = benchAll( "full evaluate", graph,       initial, rounds ) && ok;
+    ok = benchAll( "delta energy",  delta_graph, initial, rounds ) && ok;
+
+    return ok ? 0 : 1;
+}
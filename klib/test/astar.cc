@@ -2,139 +2,10 @@
 #include "../AStar.h"
 #include "../Logger.h"
 #include "../Timer.h"
+#include "GridGraph.h"
 
 #include <fstream>
 
-//------------------------------------------------------------------------------
-//
-// Simple 2D grid based graph class for testing A* search
-//
-//------------------------------------------------------------------------------
-class Graph
-{
-public:
-
-    struct Tile
-    {
-        Tile() : is_wall( false ), is_path( false ) {}
-        bool is_wall;
-        bool is_path;
-    };
-
-
-    class Node
-    {
-    public:
-
-        Node() : x( 0 ), y( 0 ) {}
-        Node( int x, int y ) : x( x ), y( y ) {}
-
-        bool operator<(  const Node& node1 )const
-        {
-            return ( x <  node1.x ) ||
-                   ( x == node1.x && y < node1.y );
-        }
-
-        bool operator==(  const Node& node1 )const
-        {
-            return x == node1.x && y == node1.y;
-        }
-
-        int x, y;
-    };
-
-
-    Graph( int x, int y )
-        : m_x( x ), m_y( y )
-    {
-        m_grid = new Tile*[ m_x ];
-        for( int i = 0; i < m_x; ++i )
-            m_grid[ i ] = new Tile[ m_y ];
-    }
-
-
-    ~Graph()
-    {
-        for( int i = 0; i < m_x; ++i )
-            delete [] m_grid[ i ]; 
-        delete [] m_grid;
-
-    }
-
-    float getCostHeuristic( const Node& node0, const Node& node1 )const
-    {
-        // Manhattan dist
-        return static_cast<float>( abs( node0.x - node1.x ) +
-                                   abs( node0.y - node1.y ) );
-    }
-
-    float getCost( const Node& node0, const Node& node1 )const
-    {
-        return 1.0f;
-    }
-
-    bool inRange( const Node& node )const
-    {
-        return node.x >= 0 && node.x < m_x-1  && node.y >= 0 && node.y < m_y-1;
-    }
-
-    void getNeighbors( const Node& node, std::vector<Node>& neighbors )const
-    {
-
-        Node neighbor;
-        neighbor.x = node.x-1;
-        neighbor.y = node.y+0;
-        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
-            neighbors.push_back( neighbor );
-
-        neighbor.x = node.x+1;
-        neighbor.y = node.y+0;
-        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
-            neighbors.push_back( neighbor );
-        
-        neighbor.x = node.x+0;
-        neighbor.y = node.y-1;
-        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
-            neighbors.push_back( neighbor );
-
-        neighbor.x = node.x+0;
-        neighbor.y = node.y+1;
-        if( inRange( neighbor ) && !m_grid[ neighbor.x ][ neighbor.y ].is_wall )
-            neighbors.push_back( neighbor );
-    }
-
-
-    int m_x, m_y;
-    Tile** m_grid;
-};
-
-
-std::ostream& operator<<( std::ostream& out, const Graph::Node& node )
-{
-    out << "[" << node.x << "," << node.y << "]";
-    return out;
-}
-
-std::ostream& operator<<( std::ostream& out, const Graph& graph )
-{
-    for( int i = 0; i < graph.m_x; ++i )
-    {
-        for( int j = 0; j < graph.m_y; ++j )
-        {
-            if( graph.m_grid[j][i].is_wall )
-                out << "X ";
-            else if( graph.m_grid[j][i].is_path )
-                out << "o ";
-            else 
-                out << ". ";
-        }
-        out << std::endl;
-    }
-
-    return out;
-}
-
-
 //------------------------------------------------------------------------------
 //
 // test functions 
@@ -0,0 +1,121 @@
+#include "../AStarBatch.h"
+#include "../Logger.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+//------------------------------------------------------------------------------
+//
+// Thread scaling for AStarBatch.  Solves the same random query set with 1 to
+// N worker threads and checks every run against a serial AStarContext.
+//
+// Usage: astar_batch_bench [grid size, default 512] [queries, default 1000]
+//                          [max threads, default hardware threads]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+typedef AStarBatch<IndexedGraph> Batch;
+
+
+Graph::Node randomOpenNode( const Graph& graph )
+{
+    for( ;; )
+    {
+        Graph::Node node( lrand48() % graph.m_x, lrand48() % graph.m_y );
+        if( graph.inRange( node ) && !graph.m_grid[ node.x ][ node.y ].is_wall )
+            return node;
+    }
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    Log::setReportingLevel( Log::WARNING );
+
+    const int      size        = argc > 1 ? atoi( argv[1] ) : 512;
+    const int      num_queries = argc > 2 ? atoi( argv[2] ) : 1000;
+    const unsigned max_threads = argc > 3 ? atoi( argv[3] ) :
+                                 std::max( 1u, std::thread::hardware_concurrency() );
+
+    IndexedGraph graph( size, size );
+    buildSerpentineMaze( graph );
+
+    srand48( 1234 );
+    Batch::QueryVec queries;
+    for( int i = 0; i < num_queries; ++i )
+        queries.push_back( std::make_pair( randomOpenNode( graph ),
+                                           randomOpenNode( graph ) ) );
+
+    //
+    // Serial reference
+    //
+    Batch::PathVec expected( queries.size() );
+    double serial_seconds = 0.0;
+    {
+        AStarContext<IndexedGraph> context( graph );
+        Timer timer;
+        timer.start();
+        for( unsigned i = 0; i < queries.size(); ++i )
+            if( context.search( queries[ i ].first, queries[ i ].second ) )
+                context.getPath( expected[ i ] );
+        serial_seconds = timer.getTimeElapsed();
+    }
+
+    std::cout << std::setw( 8 )  << "threads"
+              << std::setw( 14 ) << "time (ms)"
+              << std::setw( 14 ) << "queries/s"
+              << std::setw( 10 ) << "speedup"
+              << std::endl;
+    std::cout << std::setw( 8 )  << "serial"
+              << std::setw( 14 ) << std::fixed << std::setprecision( 2 )
+              << secondsToMilliseconds( serial_seconds )
+              << std::setw( 14 ) << std::setprecision( 0 )
+              << num_queries / serial_seconds
+              << std::setw( 10 ) << std::setprecision( 2 ) << 1.0
+              << std::endl;
+
+    bool ok = true;
+    for( unsigned num_threads = 1; num_threads <= max_threads; )
+    {
+        Batch batch( graph, num_threads );
+        Batch::PathVec paths;
+
+        // Warm up the worker contexts, then time a second pass
+        batch.solve( queries, paths );
+
+        Timer timer;
+        timer.start();
+        batch.solve( queries, paths );
+        const double seconds = timer.getTimeElapsed();
+
+        if( paths != expected )
+        {
+            std::cerr << "Mismatched paths with " << num_threads << " threads"
+                      << std::endl;
+            ok = false;
+        }
+
+        std::cout << std::setw( 8 )  << num_threads
+                  << std::setw( 14 ) << std::setprecision( 2 )
+                  << secondsToMilliseconds( seconds )
+                  << std::setw( 14 ) << std::setprecision( 0 )
+                  << num_queries / seconds
+                  << std::setw( 10 ) << std::setprecision( 2 )
+                  << serial_seconds / seconds
+                  << std::endl;
+
+        num_threads = ( num_threads == max_threads ) ? max_threads + 1 :
+                      std::min( num_threads*2, max_threads );
+    }
+
+    return ok ? 0 : 1;
+}
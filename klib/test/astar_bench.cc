@@ -0,0 +1,108 @@
+#include "../AStar.h"
+#include "../Logger.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+#include "LegacyAStar.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+//------------------------------------------------------------------------------
+//
+// Compares AStar (sparse and dense node stores) against the original
+// find_if/make_heap open set on square grids.
+//
+// Usage: astar_bench [max legacy size, default 512]
+//
+// The legacy search is quadratic in the open set size so larger grids are
+// skipped unless requested explicitly.
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+struct Result
+{
+    Result() : steps( 0 ), updates( 0 ), path_len( 0 ), seconds( 0.0 ) {}
+    int    steps;
+    int    updates;
+    int    path_len;
+    double seconds;
+};
+
+
+template <typename Search, typename G>
+Result run( const G& graph, int size )
+{
+    const Graph::Node origin( 1, 1 );
+    const Graph::Node destination( size - 3, size - 3 );
+
+    Result result;
+    Timer timer;
+    timer.start();
+
+    Search search( graph, size*size, origin, destination );
+    if( search.search() )
+    {
+        std::vector<Graph::Node> path;
+        search.getPath( path );
+        result.path_len = path.size();
+    }
+
+    result.seconds = timer.getTimeElapsed();
+    result.steps   = search.getNumSteps();
+    result.updates = search.getNumUpdates();
+    return result;
+}
+
+
+void report( const char* name, int size, const Result& result )
+{
+    std::cout << std::setw( 8 )  << name
+              << std::setw( 7 )  << size
+              << std::setw( 12 ) << result.steps
+              << std::setw( 10 ) << result.updates
+              << std::setw( 10 ) << result.path_len
+              << std::setw( 14 ) << std::fixed << std::setprecision( 4 )
+              << secondsToMilliseconds( result.seconds )
+              << std::endl;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    Log::setReportingLevel( Log::WARNING );
+
+    const int legacy_max_size = argc > 1 ? atoi( argv[1] ) : 512;
+
+    std::cout << std::setw( 8 )  << "search"
+              << std::setw( 7 )  << "size"
+              << std::setw( 12 ) << "steps"
+              << std::setw( 10 ) << "updates"
+              << std::setw( 10 ) << "path len"
+              << std::setw( 14 ) << "time (ms)"
+              << std::endl;
+
+    for( int size = 64; size <= 2048; size *= 2 )
+    {
+        IndexedGraph graph( size, size );
+        buildSerpentineMaze( graph );
+
+        // Search through the base class to hide the dense index trait
+        const Graph& sparse_graph = graph;
+
+        report( "sparse", size, run< AStar<Graph> >( sparse_graph, size ) );
+        report( "dense",  size, run< AStar<IndexedGraph> >( graph, size ) );
+
+        if( size <= legacy_max_size )
+            report( "legacy", size, run< LegacyAStar<Graph> >( sparse_graph, size ) );
+        else
+            std::cout << std::setw( 8 ) << "legacy"
+                      << std::setw( 7 ) << size << "    skipped" << std::endl;
+    }
+}
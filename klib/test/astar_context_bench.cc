@@ -0,0 +1,195 @@
+#include "../AStar.h"
+#include "../AStarContext.h"
+#include "../Logger.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+//------------------------------------------------------------------------------
+//
+// Counts heap allocations per query for single use AStar objects versus a
+// reused AStarContext.  The query set is run twice through each context; the
+// second pass is the steady state and should not allocate at all.
+//
+// Usage: astar_context_bench [grid size, default 256] [queries, default 200]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+    unsigned long long s_num_allocations = 0;
+}
+
+
+void* operator new( size_t size )
+{
+    ++s_num_allocations;
+    if( void* p = malloc( size ) )
+        return p;
+    throw std::bad_alloc();
+}
+
+
+void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+
+
+void operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
+
+
+namespace
+{
+
+typedef std::pair<Graph::Node, Graph::Node> Query;
+typedef std::vector<Query>                  QueryVec;
+
+
+Graph::Node randomOpenNode( const Graph& graph )
+{
+    for( ;; )
+    {
+        Graph::Node node( lrand48() % graph.m_x, lrand48() % graph.m_y );
+        if( graph.inRange( node ) && !graph.m_grid[ node.x ][ node.y ].is_wall )
+            return node;
+    }
+}
+
+
+struct Result
+{
+    Result() : allocations( 0 ), seconds( 0.0 ), found( 0 ) {}
+    unsigned long long allocations;
+    double             seconds;
+    int                found;
+};
+
+
+template <typename G>
+Result runSingleUse( const G& graph, const QueryVec& queries )
+{
+    std::vector<Graph::Node> path;
+    path.reserve( graph.m_x*graph.m_y );
+
+    Result result;
+    Timer  timer;
+    timer.start();
+    const unsigned long long allocations = s_num_allocations;
+
+    for( QueryVec::const_iterator it = queries.begin(); it != queries.end(); ++it )
+    {
+        AStar<G> astar( graph, AStarContext<G>::NO_MAX_DEPTH, it->first, it->second );
+        if( astar.search() )
+        {
+            path.clear();
+            astar.getPath( path );
+            ++result.found;
+        }
+    }
+
+    result.allocations = s_num_allocations - allocations;
+    result.seconds     = timer.getTimeElapsed();
+    return result;
+}
+
+
+template <typename G>
+Result runContext( AStarContext<G>& context,
+                   const G&         graph,
+                   const QueryVec&  queries )
+{
+    std::vector<Graph::Node> path;
+    path.reserve( graph.m_x*graph.m_y );
+
+    Result result;
+    Timer  timer;
+    timer.start();
+    const unsigned long long allocations = s_num_allocations;
+
+    for( QueryVec::const_iterator it = queries.begin(); it != queries.end(); ++it )
+    {
+        if( context.search( it->first, it->second ) )
+        {
+            path.clear();
+            context.getPath( path );
+            ++result.found;
+        }
+    }
+
+    result.allocations = s_num_allocations - allocations;
+    result.seconds     = timer.getTimeElapsed();
+    return result;
+}
+
+
+void report( const char* name, const Result& result, int num_queries )
+{
+    std::cout << std::setw( 24 ) << name
+              << std::setw( 8 )  << result.found
+              << std::setw( 14 ) << result.allocations
+              << std::setw( 14 ) << std::fixed << std::setprecision( 1 )
+              << static_cast<double>( result.allocations ) / num_queries
+              << std::setw( 14 ) << std::setprecision( 4 )
+              << secondsToMilliseconds( result.seconds ) / num_queries
+              << std::endl;
+}
+
+
+/// Returns the number of steady state allocations
+template <typename G>
+unsigned long long bench( const char* name, const G& graph, const QueryVec& queries )
+{
+    const int n = queries.size();
+    std::cout << name << std::endl;
+
+    report( "  AStar (single use)", runSingleUse( graph, queries ), n );
+
+    AStarContext<G> context( graph );
+    report( "  AStarContext warmup", runContext( context, graph, queries ), n );
+
+    const Result steady = runContext( context, graph, queries );
+    report( "  AStarContext steady", steady, n );
+    return steady.allocations;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    Log::setReportingLevel( Log::WARNING );
+
+    const int size        = argc > 1 ? atoi( argv[1] ) : 256;
+    const int num_queries = argc > 2 ? atoi( argv[2] ) : 200;
+
+    IndexedGraph graph( size, size );
+    buildSerpentineMaze( graph );
+
+    srand48( 1234 );
+    QueryVec queries;
+    for( int i = 0; i < num_queries; ++i )
+        queries.push_back( Query( randomOpenNode( graph ), randomOpenNode( graph ) ) );
+
+    std::cout << std::setw( 24 ) << "search"
+              << std::setw( 8 )  << "found"
+              << std::setw( 14 ) << "allocs"
+              << std::setw( 14 ) << "allocs/query"
+              << std::setw( 14 ) << "ms/query"
+              << std::endl;
+
+    const Graph& sparse_graph = graph;
+    unsigned long long steady_allocations = 0;
+    steady_allocations += bench( "sparse", sparse_graph, queries );
+    steady_allocations += bench( "dense",  graph,        queries );
+
+    // Non-zero exit if the steady state allocated
+    return steady_allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+#include "../AStarContext.h"
+#include "../Logger.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+//------------------------------------------------------------------------------
+//
+// Compares plain, bidirectional and weighted A* on a serpentine maze and on an
+// open grid with scattered walls.  Checks that bidirectional search finds an
+// optimal path and that weighted A* stays within its epsilon bound, and that
+// every mode gives cost 0 from a node to itself.
+//
+// Usage: astar_modes_bench [grid size, default 1024]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+typedef AStarContext<IndexedGraph> Context;
+
+
+void buildScattered( Graph& graph, float density )
+{
+    srand48( 1234 );
+    for( int x = 0; x < graph.m_x; ++x )
+        for( int y = 0; y < graph.m_y; ++y )
+            graph.m_grid[ x ][ y ].is_wall = drand48() < density;
+
+    graph.m_grid[ 1 ][ 1 ].is_wall                         = false;
+    graph.m_grid[ graph.m_x-3 ][ graph.m_y-3 ].is_wall     = false;
+}
+
+
+struct Mode
+{
+    const char* name;
+    bool        bidirectional;
+    float       epsilon;
+};
+
+
+bool bench( const char* map_name, const IndexedGraph& graph )
+{
+    static const Mode modes[] =
+    {
+        { "A*",            false, 1.0f },
+        { "bidirectional", true,  1.0f },
+        { "weighted 1.5",  false, 1.5f },
+        { "weighted 2",    false, 2.0f },
+        { "weighted 5",    false, 5.0f }
+    };
+    static const int NUM_MODES = sizeof( modes ) / sizeof( modes[0] );
+
+    const Graph::Node origin( 1, 1 );
+    const Graph::Node destination( graph.m_x - 3, graph.m_y - 3 );
+
+    std::cout << map_name << " " << graph.m_x << "x" << graph.m_y << std::endl;
+
+    Context context( graph );
+    bool  ok           = true;
+    float optimal_cost = 0.0f;
+    for( int i = 0; i < NUM_MODES; ++i )
+    {
+        const Mode& mode = modes[ i ];
+        context.setHeuristicWeight( mode.epsilon );
+
+        Timer timer;
+        timer.start();
+        const bool found = mode.bidirectional ?
+                           context.searchBidirectional( origin, destination ) :
+                           context.search( origin, destination );
+        const double seconds = timer.getTimeElapsed();
+
+        std::vector<Graph::Node> path;
+        context.getPath( path );
+        const float cost = found ? context.getPathCost() : 0.0f;
+
+        if( i == 0 )
+            optimal_cost = cost;
+
+        if( !found ||
+            cost != static_cast<float>( path.size() ) ||
+            cost > mode.epsilon * optimal_cost ||
+            ( mode.bidirectional && cost != optimal_cost ) )
+        {
+            std::cerr << "  " << mode.name << ": bad path (cost " << cost
+                      << ", length " << path.size() << ")" << std::endl;
+            ok = false;
+        }
+
+        std::cout << std::setw( 16 ) << mode.name
+                  << std::setw( 12 ) << context.getNumSteps()
+                  << std::setw( 10 ) << context.getNumUpdates()
+                  << std::setw( 10 ) << std::fixed << std::setprecision( 0 ) << cost
+                  << std::setw( 10 ) << std::setprecision( 3 ) << cost / optimal_cost
+                  << std::setw( 14 ) << std::setprecision( 3 )
+                  << secondsToMilliseconds( seconds )
+                  << std::endl;
+    }
+    return ok;
+}
+
+
+/// Searches from a node to itself in every mode, which must give an empty
+/// path of cost 0
+bool checkZeroLength( const IndexedGraph& graph )
+{
+    const Graph::Node origin( 1, 1 );
+    Context context( graph );
+    bool ok = true;
+    for( int bidirectional = 0; bidirectional < 2; ++bidirectional )
+    {
+        const bool found = bidirectional ? context.searchBidirectional( origin, origin )
+                                         : context.search( origin, origin );
+        std::vector<Graph::Node> path;
+        context.getPath( path );
+        if( !found || context.getPathCost() != 0.0f || !path.empty() )
+        {
+            std::cerr << "  " << ( bidirectional ? "bidirectional" : "A*" )
+                      << ": bad zero length path (cost " << context.getPathCost()
+                      << ", length " << path.size() << ")" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    Log::setReportingLevel( Log::WARNING );
+
+    const int size = argc > 1 ? atoi( argv[1] ) : 1024;
+
+    std::cout << std::setw( 16 ) << "mode"
+              << std::setw( 12 ) << "steps"
+              << std::setw( 10 ) << "updates"
+              << std::setw( 10 ) << "cost"
+              << std::setw( 10 ) << "/optimal"
+              << std::setw( 14 ) << "time (ms)"
+              << std::endl;
+
+    bool ok = true;
+    {
+        IndexedGraph graph( size, size );
+        buildSerpentineMaze( graph );
+        ok = bench( "maze", graph ) && ok;
+    }
+    {
+        IndexedGraph graph( size, size );
+        buildScattered( graph, 0.2f );
+        ok = bench( "scattered", graph ) && ok;
+        ok = checkZeroLength( graph ) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+// Trace levels are compiled out by the Makefile's KLOG_MAX_LEVEL
+#undef  KLOG_MAX_LEVEL
+#define KLOG_MAX_LEVEL Log::DEBUG1
+
+#include "../BinaryLog.h"
+#include "../Logger.h"
+#include "../Timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Cost per call of KLOG (synchronous and async) against KLOG_BINARY for a
+// typical trace message, with 1 and 4 threads.  Then logs a mix of argument
+// types both ways and checks that BinaryLog::decode reproduces the text
+// output apart from timestamps.
+//
+// KLOG async only takes less time per call than KLOG when the sink thread
+// has a core to itself.  On one core the producers pay for its formatting
+// and writing too, plus the handoff.
+//
+// Usage: binlog_bench [messages per thread, default 200000]
+//                     [log file, default binlog_bench.klog]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+/// Discards output
+class NullBuffer : public std::streambuf
+{
+protected:
+    int_type        overflow( int_type c )                    { return traits_type::not_eof( c ); }
+    std::streamsize xsputn( const char*, std::streamsize n )  { return n; }
+};
+
+
+enum Mode
+{
+    TEXT_SYNC,
+    TEXT_ASYNC,
+    BINARY
+};
+
+
+const char* modeName( Mode mode )
+{
+    return mode == TEXT_SYNC ? "KLOG" : mode == TEXT_ASYNC ? "KLOG async" : "KLOG_BINARY";
+}
+
+
+void produce( Mode mode, unsigned thread, unsigned num_messages )
+{
+    const double cost = 0.25;
+    for( unsigned i = 0; i < num_messages; ++i )
+    {
+        if( mode == BINARY )
+            KLOG_BINARY( Log::DEBUG, "thread {} expanded node {} cost {} open {}",
+                         thread, i, cost*i, num_messages-i );
+        else
+            KLOG( Log::DEBUG ) << "thread " << thread << " expanded node " << i
+                               << " cost " << cost*i << " open " << num_messages-i;
+    }
+}
+
+
+void bench( Mode mode, unsigned num_threads, unsigned num_messages, const char* path )
+{
+    if( mode == TEXT_ASYNC )
+        Log::startAsync( 1u << 16, Log::BLOCK );
+    if( mode == BINARY )
+        BinaryLog::open( path, size_t( num_threads )*num_messages*48 + ( 1u << 20 ) );
+
+    Timer timer;
+    timer.start();
+    std::vector<std::thread> threads;
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads.push_back( std::thread( produce, mode, t, num_messages ) );
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads[ t ].join();
+    const double seconds = timer.getTimeElapsed();
+
+    Log::stopAsync();
+    BinaryLog::close();
+
+    std::cout << std::setw( 14 ) << modeName( mode )
+              << std::setw( 9 )  << num_threads
+              << std::setw( 12 ) << std::fixed << std::setprecision( 1 )
+              << seconds*1.0e9 / ( double( num_threads )*num_messages )
+              << std::endl;
+}
+
+
+/// Message text of each line, without the timestamp
+std::vector<std::string> messages( const std::string& text )
+{
+    std::vector<std::string> result;
+    std::istringstream in( text );
+    std::string line;
+    while( std::getline( in, line ) )
+    {
+        const size_t pos = line.find( "] " );
+        result.push_back( pos == std::string::npos ? line : line.substr( pos+2 ) );
+    }
+    return result;
+}
+
+
+enum Shape { SQUARE, CIRCLE };
+
+
+bool checkRoundTrip( const char* path )
+{
+    std::ostringstream text;
+    Log::setStream( text );
+    BinaryLog::open( path );
+
+    const std::string name( "alpha" );
+    int value = -17;
+    for( int i = 0; i < 100; ++i )
+    {
+        const float  f = i / 3.0f;
+        const double d = i * 1.0e-7;
+        const char   c = 'a' + i % 26;
+        const bool   b = i % 2 == 0;
+
+        KLOG( Log::INFO ) << "step " << i << " name " << name << " f " << f;
+        KLOG_BINARY( Log::INFO, "step {} name {} f {}", i, name, f );
+
+        KLOG( Log::DEBUG1 ) << "d=" << d << " c=" << c << " b=" << b << " "
+                            << ( i % 3 ? "odd" : "even" ) << " " << CIRCLE;
+        KLOG_BINARY( Log::DEBUG1, "d={} c={} b={} {} {}", d, c, b,
+                     i % 3 ? "odd" : "even", CIRCLE );
+
+        KLOG( Log::WARNING ) << "unsigned " << 4000000000u + i << " long "
+                             << -( 1ll << 40 ) - i << " ptr " << &value;
+        KLOG_BINARY( Log::WARNING, "unsigned {} long {} ptr {}",
+                     4000000000u + i, -( 1ll << 40 ) - i, &value );
+    }
+
+    BinaryLog::close();
+    Log::setStream( std::cerr );
+
+    std::ostringstream decoded;
+    if( !BinaryLog::decode( path, decoded ) )
+    {
+        std::cerr << "Could not decode " << path << std::endl;
+        return false;
+    }
+
+    const std::vector<std::string> expected = messages( text.str() );
+    const std::vector<std::string> actual   = messages( decoded.str() );
+    if( actual.size() != expected.size() )
+    {
+        std::cerr << "Decoded " << actual.size() << " messages, expected "
+                  << expected.size() << std::endl;
+        return false;
+    }
+    for( size_t i = 0; i < actual.size(); ++i )
+        if( actual[ i ] != expected[ i ] )
+        {
+            std::cerr << "Decoded '" << actual[ i ] << "', expected '"
+                      << expected[ i ] << "'" << std::endl;
+            return false;
+        }
+    return true;
+}
+
+
+/// Rewrites the site ids of the log's definition records to 0 and to a huge
+/// value and checks the decoder skips them rather than writing past sites
+bool checkCorruptSites( const char* path )
+{
+    std::string bytes;
+    {
+        std::ifstream in( path, std::ios::binary );
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        bytes = contents.str();
+    }
+
+    BinaryLog::FileHeader header;
+    std::memcpy( &header, bytes.data(), sizeof( header ) );
+    const uint32_t bad_ids[] = { 0u, 0xffffffffu };
+    unsigned       corrupted = 0;
+    for( size_t pos = ( header.header_size + 7u ) & ~size_t( 7u );
+         pos + sizeof( BinaryLog::RecordHeader ) + sizeof( uint32_t ) <= bytes.size() && corrupted < 2; )
+    {
+        BinaryLog::RecordHeader record;
+        std::memcpy( &record, &bytes[ pos ], sizeof( record ) );
+        if( record.length == 0 )
+            break;
+        if( record.site == 0 )
+            std::memcpy( &bytes[ pos + sizeof( record ) ], &bad_ids[ corrupted++ ], sizeof( uint32_t ) );
+        pos += record.length;
+    }
+
+    std::ofstream( path, std::ios::binary ).write( bytes.data(), bytes.size() );
+
+    std::ostringstream decoded;
+    return corrupted == 2 && BinaryLog::decode( path, decoded );
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned    num_messages = argc > 1 ? atoi( argv[1] ) : 200000;
+    const std::string path         = argc > 2 ? argv[2] : "binlog_bench.klog";
+
+    NullBuffer   buffer;
+    std::ostream sink( &buffer );
+    Log::setReportingLevel( Log::DEBUG1 );
+    Log::setStream( sink );
+
+    std::cout << std::setw( 14 ) << "logger"
+              << std::setw( 9 )  << "threads"
+              << std::setw( 12 ) << "ns/call"
+              << std::endl;
+
+    const Mode modes[] = { TEXT_SYNC, TEXT_ASYNC, BINARY };
+    for( unsigned num_threads = 1; num_threads <= 4; num_threads *= 4 )
+        for( unsigned m = 0; m < 3; ++m )
+            bench( modes[ m ], num_threads, num_messages, path.c_str() );
+
+    Log::setStream( std::cerr );
+    const bool ok = checkRoundTrip( path.c_str() );
+    std::cout << "round trip: " << ( ok ? "ok" : "FAILED" ) << std::endl;
+
+    const bool corrupt_ok = checkCorruptSites( path.c_str() );
+    std::cout << "corrupt site ids: " << ( corrupt_ok ? "ok" : "FAILED" ) << std::endl;
+
+    std::remove( path.c_str() );
+    return ok && corrupt_ok ? 0 : 1;
+}
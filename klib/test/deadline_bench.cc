@@ -0,0 +1,170 @@
+#include "../Deadline.h"
+#include "../Timer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+//------------------------------------------------------------------------------
+//
+// Cost per Deadline::expired() call, then runs anytime loops of fixed and
+// long-tailed iteration costs against a budget and reports how much of it
+// they used, a simulated turn loop whose callers keep working after expiry
+// (the Budget should learn to leave room), and cancellation from another
+// thread.  Fails on any turn after the first going more than 2 ms over
+// budget, which allows for the odd preemption on a loaded machine.
+//
+// Usage: deadline_bench [budget ms, default 50] [turns, default 20]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+
+/// Busy work for about seconds
+void spin( double seconds )
+{
+    const Clock::time_point end = Clock::now() +
+        std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( seconds ) );
+    while( Clock::now() < end )
+        ;
+}
+
+
+double expiredCost()
+{
+    const unsigned num_calls = 10000000;
+    Deadline deadline( 1.0e6 );
+    Timer timer;
+    timer.start();
+    unsigned count = 0;
+    for( unsigned i = 0; i < num_calls; ++i )
+        count += deadline.expired() ? 0 : 1;
+    return count == num_calls ? timer.getTimeElapsed()*1.0e9 / num_calls : -1.0;
+}
+
+
+/// Iteration costs: fixed, or log-normal with a long tail about mean
+class Work
+{
+public:
+    Work( double mean, bool tail ) : m_mean( mean ), m_tail( tail ), m_rng( 1234 ),
+                                     m_distribution( -0.125, 0.5 ) {}
+
+    void operator()()
+    {
+        spin( m_tail ? m_mean*m_distribution( m_rng ) : m_mean );
+    }
+
+private:
+    double                              m_mean;
+    bool                                m_tail;
+    std::mt19937                        m_rng;
+    std::lognormal_distribution<double> m_distribution;
+};
+
+
+bool benchLoop( const char* name, double budget_seconds, unsigned num_turns,
+                double cost, bool tail, double after_expiry )
+{
+    Budget budget( budget_seconds );
+    Work   work( cost, tail );
+
+    double   first_used = 0.0;
+    double   total_used = 0.0;
+    double   worst      = 0.0;
+    unsigned long long checks     = 0;
+    unsigned long long iterations = 0;
+    for( unsigned turn = 0; turn < num_turns; ++turn )
+    {
+        Deadline deadline = budget.start();
+        while( !deadline.expired() )
+            work();
+        spin( after_expiry );
+
+        budget.finish( deadline );
+        const double used = deadline.getElapsed() / budget_seconds;
+        if( turn == 0 )
+            first_used = used;
+        else
+            worst = std::max( worst, used );
+        total_used += used;
+        checks     += deadline.getNumChecks();
+        iterations += deadline.getNumIterations();
+    }
+
+    std::cout << std::setw( 22 ) << name
+              << std::fixed << std::setprecision( 1 )
+              << std::setw( 10 ) << 100.0*first_used
+              << std::setw( 10 ) << 100.0*total_used / num_turns
+              << std::setw( 10 ) << 100.0*worst
+              << std::setw( 10 ) << budget.getNumOverruns()
+              << std::setw( 12 ) << double( iterations ) / checks
+              << std::setw( 12 ) << std::setprecision( 3 ) << budget.getReserve()*1.0e3
+              << std::endl;
+    return ( worst - 1.0 )*budget_seconds <= 2.0e-3;
+}
+
+
+bool checkCancel( double budget_seconds )
+{
+    CancellationToken token;
+    Deadline deadline( 10.0*budget_seconds, 0.0, token );
+    std::thread canceller( [&token, budget_seconds]()
+                           {
+                               std::this_thread::sleep_for(
+                                   std::chrono::duration<double>( budget_seconds ) );
+                               token.cancel();
+                           } );
+    while( !deadline.expired() )
+        spin( 1.0e-6 );
+    canceller.join();
+
+    const double late = deadline.getElapsed() - budget_seconds;
+    std::cout << "cancel noticed after " << std::setprecision( 3 ) << late*1.0e3
+              << " ms" << std::endl;
+    return token.isCancelled() && late < 0.5*budget_seconds;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const double   budget    = ( argc > 1 ? atof( argv[1] ) : 50.0 ) * 1.0e-3;
+    const unsigned num_turns =   argc > 2 ? atoi( argv[2] ) : 20;
+
+    std::cout << "expired(): " << std::fixed << std::setprecision( 2 )
+              << expiredCost() << " ns" << std::endl << std::endl;
+
+    std::cout << std::setw( 22 ) << "work"
+              << std::setw( 10 ) << "first %"
+              << std::setw( 10 ) << "mean %"
+              << std::setw( 10 ) << "worst %"  // After the first
+              << std::setw( 10 ) << "overruns"
+              << std::setw( 12 ) << "iters/check"
+              << std::setw( 12 ) << "reserve ms"
+              << std::endl;
+
+    bool ok = true;
+    ok = benchLoop( "100 ns",             budget, num_turns, 100.0e-9, false, 0.0 ) && ok;
+    ok = benchLoop( "10 us",              budget, num_turns, 10.0e-6,  false, 0.0 ) && ok;
+    ok = benchLoop( "10 us, tail",        budget, num_turns, 10.0e-6,  true,  0.0 ) && ok;
+    ok = benchLoop( "1 ms, tail",         budget, num_turns, 1.0e-3,   true,  0.0 ) && ok;
+
+    // The first turn overruns by the unannounced work; later ones must not
+    ok = benchLoop( "10 us, 2 ms after",  budget, num_turns, 10.0e-6,  false, 2.0e-3 ) && ok;
+    std::cout << std::endl;
+
+    const bool cancel_ok = checkCancel( budget );
+    std::cout << std::endl
+              << "budgets: " << ( ok        ? "ok" : "FAILED" ) << std::endl
+              << "cancel:  " << ( cancel_ok ? "ok" : "FAILED" ) << std::endl;
+    return ok && cancel_ok ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#include "../AStar.h"
+#include "../DStarLite.h"
+#include "../Logger.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+//------------------------------------------------------------------------------
+//
+// Randomly adds and removes walls on a grid while an agent walks towards its
+// destination.  After every round of edits the DStarLite solution is checked
+// against a fresh AStar search: both must agree on whether a path exists and
+// on its cost, and the D* path must be connected and avoid walls.
+//
+// Usage: dstar_lite [grid size, default 96] [rounds, default 300]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+typedef AStarContext<Graph> Context;
+
+
+bool validPath( const Graph& graph,
+                const Graph::Node& origin,
+                const Graph::Node& destination,
+                const std::vector<Graph::Node>& path )
+{
+    Graph::Node prev = origin;
+    for( std::vector<Graph::Node>::const_iterator it = path.begin(); it != path.end(); ++it )
+    {
+        if( !graph.isPassable( it->x, it->y ) ||
+            abs( it->x - prev.x ) + abs( it->y - prev.y ) != 1 )
+            return false;
+        prev = *it;
+    }
+    return prev == destination;
+}
+
+
+template <typename G>
+bool test( const char* name, G& graph, int num_rounds )
+{
+    srand48( 1234 );
+    for( int x = 0; x < graph.m_x; ++x )
+        for( int y = 0; y < graph.m_y; ++y )
+            graph.m_grid[ x ][ y ].is_wall = drand48() < 0.2;
+
+    Graph::Node       origin( 1, 1 );
+    const Graph::Node destination( graph.m_x - 3, graph.m_y - 3 );
+    graph.m_grid[ origin.x ][ origin.y ].is_wall           = false;
+    graph.m_grid[ destination.x ][ destination.y ].is_wall = false;
+
+    DStarLite<G> planner( graph, origin, destination );
+
+    long long dstar_steps = 0, astar_steps = 0;
+    double    dstar_time  = 0.0, astar_time = 0.0;
+    int       failures    = 0, found = 0;
+
+    std::vector<Graph::Node> path, astar_path, neighbors;
+    for( int round = 0; round < num_rounds; ++round )
+    {
+        //
+        // Toggle a few cells, reporting every edge touching each one
+        //
+        if( round > 0 )
+        {
+            const int num_edits = 1 + lrand48() % 8;
+            for( int i = 0; i < num_edits; ++i )
+            {
+                const Graph::Node cell( lrand48() % graph.m_x, lrand48() % graph.m_y );
+                if( cell == origin || cell == destination || !graph.inRange( cell ) )
+                    continue;
+
+                graph.m_grid[ cell.x ][ cell.y ].is_wall =
+                    !graph.m_grid[ cell.x ][ cell.y ].is_wall;
+
+                neighbors.clear();
+                graph.getNeighbors( cell, neighbors );
+                for( unsigned j = 0; j < neighbors.size(); ++j )
+                    planner.edgeCostChanged( cell, neighbors[ j ] );
+            }
+        }
+
+        Timer timer;
+        timer.start();
+        const bool dstar_found = planner.search();
+        dstar_time  += timer.getTimeElapsed();
+        dstar_steps += planner.getNumSteps();
+
+        path.clear();
+        planner.getPath( path );
+
+        timer.reset();
+        timer.start();
+        AStar<G> astar( graph, Context::NO_MAX_DEPTH, origin, destination );
+        const bool astar_found = astar.search();
+        astar_time  += timer.getTimeElapsed();
+        astar_steps += astar.getNumSteps();
+
+        astar_path.clear();
+        astar.getPath( astar_path );
+
+        if( dstar_found != astar_found ||
+            ( dstar_found &&
+              ( planner.getPathCost() != static_cast<float>( astar_path.size() ) ||
+                path.size() != astar_path.size() ||
+                !validPath( graph, origin, destination, path ) ) ) )
+        {
+            std::cerr << "  round " << round << ": mismatch "
+                      << origin << " -> " << destination
+                      << " (D* " << dstar_found << "/" << path.size()
+                      << ", A* " << astar_found << "/" << astar_path.size()
+                      << ")" << std::endl;
+            ++failures;
+        }
+
+        //
+        // Walk one step along the path now and then
+        //
+        if( dstar_found )
+        {
+            ++found;
+            if( !path.empty() && !( path.front() == destination ) && round % 4 == 0 )
+            {
+                origin = path.front();
+                planner.setOrigin( origin );
+            }
+        }
+    }
+
+    std::cout << std::setw( 10 ) << name
+              << std::setw( 8 )  << found
+              << std::setw( 12 ) << dstar_steps / num_rounds
+              << std::setw( 12 ) << astar_steps / num_rounds
+              << std::setw( 12 ) << std::fixed << std::setprecision( 3 )
+              << secondsToMilliseconds( dstar_time ) / num_rounds
+              << std::setw( 12 ) << secondsToMilliseconds( astar_time ) / num_rounds
+              << std::setw( 10 ) << failures
+              << std::endl;
+
+    return failures == 0;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    Log::setReportingLevel( Log::WARNING );
+
+    const int size       = argc > 1 ? atoi( argv[1] ) : 96;
+    const int num_rounds = argc > 2 ? atoi( argv[2] ) : 300;
+
+    std::cout << std::setw( 10 ) << "store"
+              << std::setw( 8 )  << "found"
+              << std::setw( 12 ) << "D* steps"
+              << std::setw( 12 ) << "A* steps"
+              << std::setw( 12 ) << "D* ms"
+              << std::setw( 12 ) << "A* ms"
+              << std::setw( 10 ) << "bad"
+              << std::endl;
+
+    bool ok = true;
+    {
+        Graph graph( size, size );
+        ok = test( "sparse", graph, num_rounds ) && ok;
+    }
+    {
+        IndexedGraph graph( size, size );
+        ok = test( "dense", graph, num_rounds ) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
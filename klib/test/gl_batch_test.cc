@@ -0,0 +1,243 @@
+#include <Legion/Common/Util/GL.hpp>
+#include "../Timer.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Renders a field of textured quads with immediate mode and with
+// GL::DrawBatch (persistent and staged, with segments small enough to force
+// splits and ring wraps) into a headless Mesa pbuffer, checks the images
+// match, and times each path.
+//
+// Needs Mesa's EGL with the surfaceless platform (llvmpipe), which stands in
+// for OSMesa in current Mesa.  Run with LEGION_GL_LIBRARY unset to go
+// through libGL's dispatch, or set to libEGL.so.1.
+//
+// Usage: gl_batch_test [quads, default 20000] [frames, default 20]
+//
+//------------------------------------------------------------------------------
+
+using legion::GL;
+
+namespace
+{
+
+const int WIDTH  = 256;
+const int HEIGHT = 256;
+
+
+bool createContext()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+    if( !getPlatformDisplay )
+        return false;
+
+    EGLDisplay display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA,
+                                             EGL_DEFAULT_DISPLAY, 0 );
+    if( display == EGL_NO_DISPLAY || !eglInitialize( display, 0, 0 ) )
+        return false;
+
+    const EGLint config_attribs[] =
+    {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint    num_configs = 0;
+    if( !eglChooseConfig( display, config_attribs, &config, 1, &num_configs ) ||
+        num_configs == 0 )
+        return false;
+
+    const EGLint surface_attribs[] = { EGL_WIDTH, WIDTH, EGL_HEIGHT, HEIGHT, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface( display, config, surface_attribs );
+
+    // Compatibility profile for the fixed function pipeline
+    eglBindAPI( EGL_OPENGL_API );
+    const EGLint context_attribs[] =
+    {
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext( display, config, EGL_NO_CONTEXT, context_attribs );
+    return surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT &&
+           eglMakeCurrent( display, surface, surface, context );
+}
+
+
+struct Quad
+{
+    float x, y, size;
+};
+
+
+std::vector<Quad> makeQuads( unsigned num_quads )
+{
+    srand48( 1234 );
+    std::vector<Quad> quads( num_quads );
+    for( unsigned i = 0; i < num_quads; ++i )
+    {
+        quads[ i ].x    = drand48()*2.0f - 1.0f;
+        quads[ i ].y    = drand48()*2.0f - 1.0f;
+        quads[ i ].size = 0.002f + 0.02f*drand48();
+    }
+    return quads;
+}
+
+
+enum Path
+{
+    IMMEDIATE,
+    STAGED,
+    PERSISTENT
+};
+
+
+const char* pathName( Path path )
+{
+    return path == IMMEDIATE ? "immediate" : path == STAGED ? "staged" : "persistent";
+}
+
+
+/// Two textured triangles per quad
+void drawImmediate( const std::vector<Quad>& quads )
+{
+    GL::Begin( GL_TRIANGLES );
+    for( size_t i = 0; i < quads.size(); ++i )
+    {
+        const Quad& q = quads[ i ];
+        GL::TexCoord2f( 0.0f, 0.0f ); GL::Vertex2f( q.x,          q.y          );
+        GL::TexCoord2f( 1.0f, 0.0f ); GL::Vertex2f( q.x + q.size, q.y          );
+        GL::TexCoord2f( 1.0f, 1.0f ); GL::Vertex2f( q.x + q.size, q.y + q.size );
+        GL::TexCoord2f( 0.0f, 0.0f ); GL::Vertex2f( q.x,          q.y          );
+        GL::TexCoord2f( 1.0f, 1.0f ); GL::Vertex2f( q.x + q.size, q.y + q.size );
+        GL::TexCoord2f( 0.0f, 1.0f ); GL::Vertex2f( q.x,          q.y + q.size );
+    }
+    GL::End();
+}
+
+
+void drawBatch( GL::DrawBatch& batch, const std::vector<Quad>& quads )
+{
+    batch.begin( GL_TRIANGLES );
+    for( size_t i = 0; i < quads.size(); ++i )
+    {
+        const Quad& q = quads[ i ];
+        batch.texCoord2f( 0.0f, 0.0f ); batch.vertex2f( q.x,          q.y          );
+        batch.texCoord2f( 1.0f, 0.0f ); batch.vertex2f( q.x + q.size, q.y          );
+        batch.texCoord2f( 1.0f, 1.0f ); batch.vertex2f( q.x + q.size, q.y + q.size );
+        batch.texCoord2f( 0.0f, 0.0f ); batch.vertex2f( q.x,          q.y          );
+        batch.texCoord2f( 1.0f, 1.0f ); batch.vertex2f( q.x + q.size, q.y + q.size );
+        batch.texCoord2f( 0.0f, 1.0f ); batch.vertex2f( q.x,          q.y + q.size );
+    }
+    batch.end();
+}
+
+
+/// A 2x2 texture so the texture coordinates show up in the image
+void setupTexture()
+{
+    const unsigned char texels[] =
+    {
+        255,   0,   0, 255,     0, 255,   0, 255,
+          0,   0, 255, 255,   255, 255, 255, 255
+    };
+    GLuint texture = 0;
+    GL::GenTextures( 1, &texture );
+    GL::BindTexture( GL_TEXTURE_2D, texture );
+    GL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    GL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    GL::PixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    GL::TexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels );
+    GL::Enable( GL_TEXTURE_2D );
+}
+
+
+std::vector<unsigned char> render( Path path, const std::vector<Quad>& quads,
+                                   unsigned num_frames, double& ms_per_frame,
+                                   unsigned& draws_per_frame )
+{
+    // Small segments so a frame splits and wraps the ring several times
+    GL::DrawBatch batch( 6*1024, path == PERSISTENT );
+    if( path == PERSISTENT && !batch.isPersistent() )
+        std::cerr << "no buffer storage, persistent path is staged" << std::endl;
+
+    Timer timer;
+    timer.start();
+    for( unsigned frame = 0; frame < num_frames; ++frame )
+    {
+        glClear( GL_COLOR_BUFFER_BIT );
+        if( path == IMMEDIATE )
+            drawImmediate( quads );
+        else
+            drawBatch( batch, quads );
+    }
+    glFinish();
+    ms_per_frame    = timer.getTimeElapsed()*1.0e3 / num_frames;
+    draws_per_frame = batch.getNumDraws() / num_frames;
+
+    std::vector<unsigned char> pixels( WIDTH*HEIGHT*4 );
+    glReadPixels( 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0] );
+    return pixels;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned num_quads  = argc > 1 ? atoi( argv[1] ) : 20000;
+    const unsigned num_frames = argc > 2 ? atoi( argv[2] ) : 20;
+
+    if( !createContext() )
+    {
+        std::cerr << "Could not create a headless EGL context" << std::endl;
+        return 1;
+    }
+    std::cout << "GL_RENDERER: " << GL::GetString( GL_RENDERER ) << std::endl
+              << "buffer storage: " << ( GL::hasBufferStorage() ? "yes" : "no" )
+              << std::endl << std::endl;
+
+    glViewport( 0, 0, WIDTH, HEIGHT );
+    glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
+    setupTexture();
+
+    const std::vector<Quad> quads = makeQuads( num_quads );
+
+    std::cout << std::setw( 12 ) << "path"
+              << std::setw( 12 ) << "ms/frame"
+              << std::setw( 12 ) << "draws"
+              << std::setw( 10 ) << "image"
+              << std::endl;
+
+    bool ok = true;
+    std::vector<unsigned char> reference;
+    const Path paths[] = { IMMEDIATE, STAGED, PERSISTENT };
+    for( unsigned p = 0; p < 3; ++p )
+    {
+        double   ms    = 0.0;
+        unsigned draws = 0;
+        const std::vector<unsigned char> image = render( paths[ p ], quads, num_frames, ms, draws );
+        if( p == 0 )
+            reference = image;
+        const bool match = image == reference;
+        ok = match && ok;
+
+        std::cout << std::setw( 12 ) << pathName( paths[ p ] )
+                  << std::setw( 12 ) << std::fixed << std::setprecision( 2 ) << ms
+                  << std::setw( 12 ) << draws
+                  << std::setw( 10 ) << ( match ? "ok" : "DIFFERS" )
+                  << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#include "../AStarContext.h"
+#include "../JumpPointSearch.h"
+#include "../Logger.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+//------------------------------------------------------------------------------
+//
+// Compares jump point search with A* on open, scattered-wall and serpentine
+// maze grids.  Every query is run through both; JPS must return a connected,
+// passable path whose cost matches A*.  Reports expanded nodes and time.
+//
+// Usage: jps_bench [grid size, default 512] [queries, default 100]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+typedef std::pair<Graph::Node, Graph::Node> Query;
+typedef std::vector<Query>                  QueryVec;
+
+
+void buildScattered( Graph& graph, float density )
+{
+    srand48( 1234 );
+    for( int x = 0; x < graph.m_x; ++x )
+        for( int y = 0; y < graph.m_y; ++y )
+            graph.m_grid[ x ][ y ].is_wall = drand48() < density;
+}
+
+
+Graph::Node randomOpenNode( const Graph& graph )
+{
+    for( ;; )
+    {
+        Graph::Node node( lrand48() % graph.m_x, lrand48() % graph.m_y );
+        if( graph.isPassable( node.x, node.y ) )
+            return node;
+    }
+}
+
+
+bool validPath( const Graph& graph, const Query& query,
+                const std::vector<Graph::Node>& path )
+{
+    Graph::Node prev = query.first;
+    for( std::vector<Graph::Node>::const_iterator it = path.begin(); it != path.end(); ++it )
+    {
+        if( !graph.isPassable( it->x, it->y ) ||
+            abs( it->x - prev.x ) + abs( it->y - prev.y ) != 1 )
+            return false;
+        prev = *it;
+    }
+    return prev == query.second;
+}
+
+
+bool bench( const char* map_name, const IndexedGraph& graph, int num_queries )
+{
+    srand48( 4321 );
+    QueryVec queries;
+    for( int i = 0; i < num_queries; ++i )
+        queries.push_back( Query( randomOpenNode( graph ), randomOpenNode( graph ) ) );
+
+    AStarContext<IndexedGraph>    astar( graph );
+    JumpPointSearch<IndexedGraph> jps( graph );
+
+    long long astar_steps = 0, jps_steps = 0;
+    double    astar_time  = 0.0, jps_time = 0.0;
+    int       found = 0, mismatches = 0;
+
+    // No search yet, so no path
+    if( jps.getPathCost() != std::numeric_limits<float>::max() )
+        ++mismatches;
+
+    std::vector<Graph::Node> path;
+    for( QueryVec::const_iterator it = queries.begin(); it != queries.end(); ++it )
+    {
+        Timer timer;
+        timer.start();
+        const bool astar_found = astar.search( it->first, it->second );
+        astar_time += timer.getTimeElapsed();
+        astar_steps += astar.getNumSteps();
+
+        timer.reset();
+        timer.start();
+        const bool jps_found = jps.search( it->first, it->second );
+        jps_time += timer.getTimeElapsed();
+        jps_steps += jps.getNumSteps();
+
+        if( astar_found != jps_found )
+        {
+            ++mismatches;
+            continue;
+        }
+        if( !jps_found )
+        {
+            if( jps.getPathCost() != std::numeric_limits<float>::max() )
+                ++mismatches;
+            continue;
+        }
+
+        ++found;
+        path.clear();
+        jps.getPath( path );
+        if( jps.getPathCost() != astar.getPathCost() ||
+            static_cast<float>( path.size() ) != jps.getPathCost() ||
+            !validPath( graph, *it, path ) )
+        {
+            std::cerr << "  " << map_name << ": bad path " << it->first << " -> "
+                      << it->second << " (jps " << jps.getPathCost()
+                      << ", A* " << astar.getPathCost() << ")" << std::endl;
+            ++mismatches;
+        }
+    }
+
+    std::cout << std::setw( 12 ) << map_name
+              << std::setw( 8 )  << found
+              << std::setw( 12 ) << astar_steps / num_queries
+              << std::setw( 12 ) << jps_steps   / num_queries
+              << std::setw( 12 ) << std::fixed << std::setprecision( 3 )
+              << secondsToMilliseconds( astar_time ) / num_queries
+              << std::setw( 12 ) << secondsToMilliseconds( jps_time ) / num_queries
+              << std::setw( 10 ) << mismatches
+              << std::endl;
+
+    return mismatches == 0;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    Log::setReportingLevel( Log::WARNING );
+
+    const int size        = argc > 1 ? atoi( argv[1] ) : 512;
+    const int num_queries = argc > 2 ? atoi( argv[2] ) : 100;
+
+    std::cout << std::setw( 12 ) << "map"
+              << std::setw( 8 )  << "found"
+              << std::setw( 12 ) << "A* steps"
+              << std::setw( 12 ) << "JPS steps"
+              << std::setw( 12 ) << "A* ms"
+              << std::setw( 12 ) << "JPS ms"
+              << std::setw( 10 ) << "bad"
+              << std::endl;
+
+    bool ok = true;
+    {
+        IndexedGraph graph( size, size );
+        ok = bench( "open", graph, num_queries ) && ok;
+    }
+    {
+        IndexedGraph graph( size, size );
+        buildScattered( graph, 0.2f );
+        ok = bench( "scattered", graph, num_queries ) && ok;
+    }
+    {
+        IndexedGraph graph( size, size );
+        buildSerpentineMaze( graph );
+        ok = bench( "maze", graph, num_queries ) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
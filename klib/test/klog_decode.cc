@@ -0,0 +1,31 @@
+#include "../BinaryLog.h"
+
+#include <iostream>
+
+//------------------------------------------------------------------------------
+//
+// Renders binary logs written with KLOG_BINARY as KLOG text.
+//
+// Usage: klog-decode file.klog [file.klog ...]
+//
+//------------------------------------------------------------------------------
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 )
+    {
+        std::cerr << "Usage: " << argv[0] << " file.klog [file.klog ...]" << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    for( int i = 1; i < argc; ++i )
+    {
+        if( !BinaryLog::decode( argv[i], std::cout ) )
+        {
+            std::cerr << argv[0] << ": cannot decode " << argv[i] << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
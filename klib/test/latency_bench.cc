@@ -0,0 +1,178 @@
+#include "../LatencyHistogram.h"
+#include "../Timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Cost per LatencyHistogram::record, then checks its percentiles against the
+// exact ones of a long-tailed sample set, that histograms filled on separate
+// threads merge to the same result as one filled serially, and that
+// AutoTimerRef feeds it.  The timed sleeps are printed at exit.
+//
+// Usage: latency_bench [samples, default 1000000]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+/// Log-normal durations in seconds around a millisecond, with a long tail
+std::vector<double> makeSamples( unsigned num_samples, unsigned seed )
+{
+    std::mt19937 rng( seed );
+    std::lognormal_distribution<double> distribution( std::log( 1.0e-3 ), 1.5 );
+
+    std::vector<double> samples( num_samples );
+    for( unsigned i = 0; i < num_samples; ++i )
+        samples[ i ] = distribution( rng );
+    return samples;
+}
+
+
+double recordCost( const std::vector<double>& samples )
+{
+    LatencyHistogram histogram;
+    Timer timer;
+    timer.start();
+    for( size_t i = 0; i < samples.size(); ++i )
+        histogram.record( samples[ i ] );
+    const double seconds = timer.getTimeElapsed();
+    return histogram.getCount() == samples.size() ? seconds*1.0e9 / samples.size() : -1.0;
+}
+
+
+bool checkPercentiles( const std::vector<double>& samples )
+{
+    LatencyHistogram histogram( "samples" );
+    for( size_t i = 0; i < samples.size(); ++i )
+        histogram.record( samples[ i ] );
+
+    std::vector<double> sorted( samples );
+    std::sort( sorted.begin(), sorted.end() );
+
+    std::cout << std::setw( 10 ) << "percent"
+              << std::setw( 14 ) << "exact ms"
+              << std::setw( 14 ) << "histogram ms"
+              << std::setw( 12 ) << "error %"
+              << std::endl;
+
+    bool ok = true;
+    const double percents[] = { 0.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0 };
+    for( unsigned i = 0; i < sizeof( percents ) / sizeof( percents[0] ); ++i )
+    {
+        const size_t rank  = std::max<size_t>(
+            1u, static_cast<size_t>( std::ceil( percents[ i ] / 100.0 * sorted.size() ) ) );
+        const double exact = sorted[ rank-1 ];
+        const double value = histogram.getPercentile( percents[ i ] );
+        const double error = std::fabs( value - exact ) / exact;
+
+        // Half a bucket, plus rounding to whole nanoseconds
+        ok = error <= 1.0 / 256.0 + 1.0e-9 / exact && ok;
+        std::cout << std::setw( 10 ) << percents[ i ]
+                  << std::setw( 14 ) << std::fixed << std::setprecision( 4 ) << exact*1.0e3
+                  << std::setw( 14 ) << value*1.0e3
+                  << std::setw( 12 ) << std::setprecision( 3 ) << error*100.0
+                  << std::endl;
+    }
+
+    double total = 0.0;
+    for( size_t i = 0; i < samples.size(); ++i )
+        total += samples[ i ];
+    const double mean = total / samples.size();
+    ok = std::fabs( histogram.getMean() - mean ) <= 1.0e-9 && ok;
+    ok = std::fabs( histogram.getMax() - sorted.back() ) <= 1.0e-9 && ok;
+
+    histogram.print( std::cout );
+    return ok;
+}
+
+
+void fill( const std::vector<double>& samples, size_t begin, size_t end,
+           LatencyHistogram& histogram )
+{
+    for( size_t i = begin; i < end; ++i )
+        histogram.record( samples[ i ] );
+}
+
+
+bool checkMerge( const std::vector<double>& samples, unsigned num_threads )
+{
+    const double budget = 10.0e-3;
+
+    LatencyHistogram serial( "serial", budget );
+    fill( samples, 0, samples.size(), serial );
+
+    std::vector<LatencyHistogram> partial( num_threads, LatencyHistogram( "merged", budget ) );
+    std::vector<std::thread> threads;
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads.push_back( std::thread( fill, std::cref( samples ),
+                                        samples.size()*t / num_threads,
+                                        samples.size()*( t+1 ) / num_threads,
+                                        std::ref( partial[ t ] ) ) );
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads[ t ].join();
+
+    LatencyHistogram merged( "merged", budget );
+    for( unsigned t = 0; t < num_threads; ++t )
+        merged.merge( partial[ t ] );
+
+    serial.print( std::cout );
+    merged.print( std::cout );
+
+    bool ok = merged.getCount()        == serial.getCount()        &&
+              merged.getNumOverBudget() == serial.getNumOverBudget() &&
+              merged.getMin()          == serial.getMin()          &&
+              merged.getMax()          == serial.getMax();
+    for( double percent = 0.0; percent <= 100.0; percent += 0.5 )
+        ok = merged.getPercentile( percent ) == serial.getPercentile( percent ) && ok;
+    return ok;
+}
+
+
+bool checkAutoTimer( LatencyHistogram& sleeps )
+{
+    const unsigned num_sleeps = 20;
+    for( unsigned i = 0; i < num_sleeps; ++i )
+    {
+        AutoTimerRef<LatencyHistogram> timer( sleeps );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    return sleeps.getCount() == num_sleeps && sleeps.getMin() >= 1.0e-3;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned num_samples = argc > 1 ? atoi( argv[1] ) : 1000000;
+
+    static LatencyHistogram sleeps( "1 ms sleeps", 2.0e-3 );
+    sleeps.printAtExit( std::cout );
+
+    const std::vector<double> samples = makeSamples( num_samples, 1234 );
+    std::cout << "record: " << std::fixed << std::setprecision( 1 )
+              << recordCost( samples ) << " ns" << std::endl << std::endl;
+
+    const bool percentiles_ok = checkPercentiles( samples );
+    std::cout << std::endl;
+    const bool merge_ok       = checkMerge( samples, 4 );
+    const bool timer_ok       = checkAutoTimer( sleeps );
+
+    std::cout << std::endl
+              << "percentiles: " << ( percentiles_ok ? "ok" : "FAILED" ) << std::endl
+              << "merge:       " << ( merge_ok       ? "ok" : "FAILED" ) << std::endl
+              << "auto timer:  " << ( timer_ok       ? "ok" : "FAILED" ) << std::endl
+              << std::endl;
+
+    return percentiles_ok && merge_ok && timer_ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#include "../Logger.h"
+#include "../Timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Per-call KLOG latency with 1 to 16 producer threads, for synchronous
+// logging and for the async sink with the DROP and BLOCK overflow policies.
+// Output goes to a stream which only counts lines, so the numbers are the
+// logger's own overhead; the counts are checked against the number of
+// messages logged (less those reported dropped).
+//
+// Usage: log_bench [messages per thread, default 20000]
+//                  [async queue capacity, default 4096]
+//
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+/// Discards output, counting lines and WARNING messages.  The bench logs at
+/// INFO, so the warnings are the sink's reports of dropped messages.
+class CountingBuffer : public std::streambuf
+{
+public:
+    CountingBuffer() : m_lines( 0 ), m_warnings( 0 ) {}
+
+    unsigned long lines()    const  { return m_lines;    }
+    unsigned long warnings() const  { return m_warnings; }
+    void          reset()           { m_lines = m_warnings = 0; }
+
+protected:
+    int_type overflow( int_type c )
+    {
+        if( c == '\n' )
+            ++m_lines;
+        return traits_type::not_eof( c );
+    }
+
+    std::streamsize xsputn( const char* s, std::streamsize n )
+    {
+        static const char warning[] = "] WARNING: ";
+        m_lines += std::count( s, s+n, '\n' );
+        if( std::search( s, s+n, warning, warning + sizeof( warning )-1 ) != s+n )
+            ++m_warnings;
+        return n;
+    }
+
+private:
+    unsigned long m_lines;
+    unsigned long m_warnings;
+};
+
+
+enum Mode
+{
+    SYNC,
+    ASYNC_DROP,
+    ASYNC_BLOCK
+};
+
+
+const char* modeName( Mode mode )
+{
+    return mode == SYNC ? "sync" : mode == ASYNC_DROP ? "drop" : "block";
+}
+
+
+/// Logs num_messages messages, recording each call's latency in nanoseconds.
+/// Timer only has microsecond resolution on linux, so use steady_clock.
+void produce( unsigned thread, unsigned num_messages, std::vector<unsigned>& latencies )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    latencies.resize( num_messages );
+    for( unsigned i = 0; i < num_messages; ++i )
+    {
+        const Clock::time_point start = Clock::now();
+        KLOG( Log::INFO ) << "thread " << thread << " message " << i
+                          << " value " << i*0.5;
+        const Clock::time_point end = Clock::now();
+        latencies[ i ] = static_cast<unsigned>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() );
+    }
+}
+
+
+bool bench( Mode mode, unsigned num_threads, unsigned num_messages,
+            size_t capacity, CountingBuffer& sink )
+{
+    sink.reset();
+    if( mode != SYNC )
+        Log::startAsync( capacity, mode == ASYNC_DROP ? Log::DROP : Log::BLOCK );
+
+    std::vector< std::vector<unsigned> > latencies( num_threads );
+    Timer timer;
+    timer.start();
+    std::vector<std::thread> threads;
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads.push_back( std::thread( produce, t, num_messages,
+                                        std::ref( latencies[ t ] ) ) );
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads[ t ].join();
+    const double produce_seconds = timer.getTimeElapsed();
+
+    // Includes draining the queue
+    Log::stopAsync();
+    const double total_seconds = timer.getTimeElapsed();
+
+    std::vector<unsigned> all;
+    for( unsigned t = 0; t < num_threads; ++t )
+        all.insert( all.end(), latencies[ t ].begin(), latencies[ t ].end() );
+    std::sort( all.begin(), all.end() );
+
+    double mean = 0.0;
+    for( std::vector<unsigned>::const_iterator it = all.begin(); it != all.end(); ++it )
+        mean += *it;
+    mean /= all.size();
+
+    const unsigned long logged  = static_cast<unsigned long>( num_threads )*num_messages;
+    const unsigned long dropped = mode == ASYNC_DROP ? Log::getNumDropped() : 0;
+    const unsigned long written = sink.lines() - sink.warnings();
+    const bool ok = written + dropped == logged;
+
+    std::cout << std::setw( 8 )  << modeName( mode )
+              << std::setw( 9 )  << num_threads
+              << std::setw( 10 ) << std::fixed << std::setprecision( 0 ) << mean
+              << std::setw( 10 ) << all[ all.size()/2 ]
+              << std::setw( 10 ) << all[ all.size()*99/100 ]
+              << std::setw( 12 ) << all.back()
+              << std::setw( 10 ) << std::setprecision( 3 ) << produce_seconds
+              << std::setw( 10 ) << total_seconds
+              << std::setw( 10 ) << dropped
+              << std::setw( 8 )  << ( ok ? "ok" : "LOST" )
+              << std::endl;
+    return ok;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned num_messages = argc > 1 ? atoi( argv[1] ) : 20000;
+    const size_t   capacity     = argc > 2 ? atoi( argv[2] ) : 4096;
+
+    CountingBuffer buffer;
+    std::ostream   sink( &buffer );
+    Log::setReportingLevel( Log::INFO );
+    Log::setStream( sink );
+
+    std::cout << std::setw( 8 )  << "mode"
+              << std::setw( 9 )  << "threads"
+              << std::setw( 10 ) << "mean ns"
+              << std::setw( 10 ) << "p50 ns"
+              << std::setw( 10 ) << "p99 ns"
+              << std::setw( 12 ) << "max ns"
+              << std::setw( 10 ) << "log s"
+              << std::setw( 10 ) << "total s"
+              << std::setw( 10 ) << "dropped"
+              << std::setw( 8 )  << "result"
+              << std::endl;
+
+    bool ok = true;
+    const Mode modes[] = { SYNC, ASYNC_DROP, ASYNC_BLOCK };
+    for( unsigned m = 0; m < 3; ++m )
+        for( unsigned num_threads = 1; num_threads <= 16; num_threads *= 2 )
+            ok = bench( modes[ m ], num_threads, num_messages, capacity, buffer ) && ok;
+
+    Log::setStream( std::cerr );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+#include "../AStarContext.h"
+#include "../Logger.h"
+#include "../Profiler.h"
+#include "../Timer.h"
+#include "GridGraph.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Cost per KPROFILE_SCOPE with and without tracing, then checks the call
+// counts of a known nesting run on several threads and of an instrumented
+// AStarContext.  Prints the flat report and call trees of the A* run and
+// checks its Chrome trace holds one event per scope.
+//
+// Usage: profiler_bench [scopes per thread, default 1000000]
+//                       [trace file to keep, default none]
+//
+//------------------------------------------------------------------------------
+
+#ifndef KPROFILE
+#   error profiler_bench must be built with -DKPROFILE
+#endif
+
+namespace
+{
+
+volatile unsigned s_sink = 0;
+
+
+double overhead( unsigned num_scopes, bool profile )
+{
+    Timer timer;
+    timer.start();
+    if( profile )
+    {
+        for( unsigned i = 0; i < num_scopes; ++i )
+        {
+            KPROFILE_SCOPE( "bench::empty" );
+            s_sink = s_sink + i;
+        }
+    }
+    else
+    {
+        for( unsigned i = 0; i < num_scopes; ++i )
+            s_sink = s_sink + i;
+    }
+    return timer.getTimeElapsed()*1.0e9 / num_scopes;
+}
+
+
+void leaf()
+{
+    KPROFILE_SCOPE( "bench::leaf" );
+    s_sink = s_sink + 1;
+}
+
+
+void nest( unsigned outer, unsigned inner )
+{
+    for( unsigned i = 0; i < outer; ++i )
+    {
+        KPROFILE_SCOPE( "bench::outer" );
+        for( unsigned j = 0; j < inner; ++j )
+        {
+            KPROFILE_SCOPE( "bench::inner" );
+            leaf();
+        }
+        // Same name under a different parent is a separate tree node
+        leaf();
+    }
+}
+
+
+bool check( const char* name, unsigned long long expected )
+{
+    const Profiler::Stats stats = Profiler::getStats( name );
+    const bool ok = stats.count == expected &&
+                    stats.self_time <= stats.total_time &&
+                    stats.min_time  <= stats.max_time;
+    if( !ok )
+        std::cerr << name << ": " << stats.count << " calls, expected "
+                  << expected << std::endl;
+    return ok;
+}
+
+
+bool checkNesting( unsigned num_threads )
+{
+    const unsigned outer = 10;
+    const unsigned inner = 100;
+
+    Profiler::reset();
+    std::vector<std::thread> threads;
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads.push_back( std::thread( nest, outer, inner ) );
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads[ t ].join();
+
+    bool ok = true;
+    ok = check( "bench::outer", num_threads*outer ) && ok;
+    ok = check( "bench::inner", num_threads*outer*inner ) && ok;
+    ok = check( "bench::leaf",  num_threads*outer*( inner+1 ) ) && ok;
+    return ok;
+}
+
+
+Graph::Node randomOpenNode( const Graph& graph )
+{
+    for( ;; )
+    {
+        Graph::Node node( lrand48() % graph.m_x, lrand48() % graph.m_y );
+        if( graph.inRange( node ) && !graph.m_grid[ node.x ][ node.y ].is_wall )
+            return node;
+    }
+}
+
+
+/// Number of complete events in a trace written by writeChromeTrace
+unsigned countEvents( const std::string& trace )
+{
+    if( trace.compare( 0, 17, "{\"displayTimeUnit" ) != 0 ||
+        trace.find( "]}" ) == std::string::npos )
+        return 0;
+
+    unsigned count = 0;
+    for( size_t pos = trace.find( "\"ph\":\"X\"" ); pos != std::string::npos;
+         pos = trace.find( "\"ph\":\"X\"", pos+1 ) )
+        ++count;
+    return count;
+}
+
+
+bool checkAStar( const std::string& path )
+{
+    const unsigned num_queries = 200;
+
+    IndexedGraph graph( 256, 256 );
+    buildSerpentineMaze( graph );
+
+    Profiler::reset();
+    Profiler::enableTrace();
+
+    srand48( 1234 );
+    AStarContext<IndexedGraph> context( graph );
+    for( unsigned i = 0; i < num_queries; ++i )
+    {
+        KPROFILE_SCOPE( "bench::query" );
+        const Graph::Node origin      = randomOpenNode( graph );
+        const Graph::Node destination = randomOpenNode( graph );
+        if( i % 2 )
+            context.search( origin, destination );
+        else
+            context.searchBidirectional( origin, destination );
+    }
+
+    Profiler::writeReport( std::cout );
+    std::cout << std::endl;
+    Profiler::writeTree( std::cout );
+    std::cout << std::endl;
+
+    std::ostringstream trace;
+    Profiler::writeChromeTrace( trace );
+    if( !path.empty() )
+        std::ofstream( path.c_str() ) << trace.str();
+
+    bool ok = true;
+    ok = check( "bench::query",                     num_queries   ) && ok;
+    ok = check( "AStarContext::search",             num_queries/2 ) && ok;
+    ok = check( "AStarContext::searchBidirectional", num_queries/2 ) && ok;
+
+    const unsigned num_events = countEvents( trace.str() );
+    if( num_events != 2*num_queries )
+    {
+        std::cerr << "trace has " << num_events << " events, expected "
+                  << 2*num_queries << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned    num_scopes = argc > 1 ? atoi( argv[1] ) : 1000000;
+    const std::string path       = argc > 2 ? argv[2] : "";
+
+    Log::setReportingLevel( Log::WARNING );
+
+    const double base = overhead( num_scopes, false );
+    std::cout << std::setw( 20 ) << "scope"
+              << std::setw( 12 ) << "ns/scope"
+              << std::endl
+              << std::fixed << std::setprecision( 1 )
+              << std::setw( 20 ) << "profile"
+              << std::setw( 12 ) << overhead( num_scopes, true ) - base
+              << std::endl;
+    Profiler::enableTrace( num_scopes );
+    std::cout << std::setw( 20 ) << "profile + trace"
+              << std::setw( 12 ) << overhead( num_scopes, true ) - base
+              << std::endl << std::endl;
+    Profiler::enableTrace( 0 );
+
+    const bool nesting_ok = checkNesting( 4 );
+    const bool astar_ok   = checkAStar( path );
+    std::cout << "nesting: " << ( nesting_ok ? "ok" : "FAILED" ) << std::endl
+              << "astar:   " << ( astar_ok   ? "ok" : "FAILED" ) << std::endl;
+
+    return nesting_ok && astar_ok ? 0 : 1;
+}
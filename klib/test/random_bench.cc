@@ -0,0 +1,160 @@
+#include "../MTRand.hpp"
+#include "../SFMT.hpp"
+#include "../Timer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Throughput of scalar MTRand against its fill() bulk API and the SFMT19937
+// bulk generator.  First checks that MTRand::fill reproduces next() exactly
+// and that SFMT19937 matches the reference SFMT output for seed 1234.
+//
+// Usage: random_bench [numbers, default 100000000]
+//
+//------------------------------------------------------------------------------
+
+using namespace legion;
+
+namespace
+{
+
+const size_t BUFFER_SIZE = 4096;
+
+volatile uint64_t s_sink;
+
+
+template <typename Integer>
+bool checkMTRandFill()
+{
+    MTRand<Integer> scalar( 4321u ), bulk( 4321u );
+    std::vector<Integer> buffer( 1000 );
+    std::vector<float>   floats( 1000 );
+
+    // Odd sizes so fills straddle state regeneration
+    for( int pass = 0; pass < 5; ++pass )
+    {
+        bulk.fill( &buffer[ 0 ], 999 );
+        for( size_t i = 0; i < 999; ++i )
+            if( buffer[ i ] != scalar.next() )
+                return false;
+
+        bulk.fillFloats( &floats[ 0 ], 777 );
+        for( size_t i = 0; i < 777; ++i )
+            if( floats[ i ] != scalar() )
+                return false;
+    }
+    return true;
+}
+
+
+bool checkSFMT()
+{
+    // From the reference implementation's SFMT.19937.out.txt
+    static const uint32_t expected[] =
+        { 3440181298u, 1564997079u, 1510669302u, 2930277156u, 1452439940u };
+
+    SFMT19937 reference( 1234u );
+    for( int i = 0; i < 5; ++i )
+        if( reference.next() != expected[ i ] )
+            return false;
+
+    SFMT19937 scalar( 99u ), bulk( 99u );
+    std::vector<uint32_t> buffer( 1000 );
+    for( int pass = 0; pass < 5; ++pass )
+    {
+        bulk.fill( &buffer[ 0 ], 999 );
+        for( size_t i = 0; i < 999; ++i )
+            if( buffer[ i ] != scalar.next() )
+                return false;
+    }
+    return true;
+}
+
+
+void report( const char* name, double seconds, size_t count )
+{
+    std::cout << std::setw( 28 ) << name
+              << std::setw( 12 ) << std::fixed << std::setprecision( 4 ) << seconds
+              << std::setw( 14 ) << std::setprecision( 1 ) << count / seconds * 1e-6
+              << std::endl;
+}
+
+
+/// Calls fill( buffer, BUFFER_SIZE ) until count numbers have been made
+template <typename Generator, typename T>
+void benchFill( const char* name, size_t count, void ( Generator::*fill )( T*, size_t ) )
+{
+    Generator rng;
+    std::vector<T> buffer( BUFFER_SIZE );
+    uint64_t sum = 0;
+
+    Timer timer;
+    timer.start();
+    for( size_t done = 0; done < count; done += BUFFER_SIZE )
+    {
+        ( rng.*fill )( &buffer[ 0 ], BUFFER_SIZE );
+        sum += static_cast<uint64_t>( buffer[ done % BUFFER_SIZE ] );
+    }
+    report( name, timer.getTimeElapsed(), count );
+
+    s_sink = sum;
+}
+
+
+template <typename Generator>
+void benchNext( const char* name, size_t count )
+{
+    Generator rng;
+    uint64_t sum = 0;
+
+    Timer timer;
+    timer.start();
+    for( size_t i = 0; i < count; ++i )
+        sum ^= rng.next();
+    report( name, timer.getTimeElapsed(), count );
+
+    s_sink = sum;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const size_t count = argc > 1 ? atol( argv[1] ) : 100000000;
+
+    bool ok = true;
+    if( !checkMTRandFill<uint32_t>() || !checkMTRandFill<uint64_t>() )
+    {
+        std::cerr << "MTRand::fill does not match next()" << std::endl;
+        ok = false;
+    }
+    if( !checkSFMT() )
+    {
+        std::cerr << "SFMT19937 does not match reference output" << std::endl;
+        ok = false;
+    }
+
+    std::cout << std::setw( 28 ) << "generator"
+              << std::setw( 12 ) << "seconds"
+              << std::setw( 14 ) << "Mnumbers/s"
+              << std::endl;
+
+    benchNext<MTRand32>( "MTRand32::next", count );
+    benchFill<MTRand32, uint32_t>( "MTRand32::fill", count, &MTRand32::fill );
+    benchFill<MTRand32, float>( "MTRand32::fillFloats", count, &MTRand32::fillFloats );
+    benchNext<MTRand64>( "MTRand64::next", count );
+    benchFill<MTRand64, uint64_t>( "MTRand64::fill", count, &MTRand64::fill );
+
+    benchNext<SFMT19937>( "SFMT19937::next", count );
+    benchFill<SFMT19937, uint32_t>( "SFMT19937::fill (32)", count, &SFMT19937::fill );
+    benchFill<SFMT19937, uint64_t>( "SFMT19937::fill (64)", count, &SFMT19937::fill );
+    benchFill<SFMT19937, float>( "SFMT19937::fillFloats", count, &SFMT19937::fillFloats );
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include "../MTRand.hpp"
+#include "../Sobol.hpp"
+#include "../Timer.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Checks that split generator streams consumed by N threads give exactly the
+// values one thread gets reading the unsplit stream: MTRand32/MTRand64 with
+// strides taking both the run-forward and the polynomial jump path, and
+// Sobol streams read per element and in batches.  Also checks MTRand::jump
+// against calling next() and that jumps compose.
+//
+// Usage: random_streams [threads, default 8]
+//
+//------------------------------------------------------------------------------
+
+using namespace legion;
+
+namespace
+{
+
+/// Order dependent digest of a stream of values
+struct Digest
+{
+    Digest() : value( 14695981039346656037ull ) {}
+    void add( uint64_t x ) { value = ( value ^ x ) * 1099511628211ull; }
+    uint64_t value;
+};
+
+
+template <typename Integer>
+bool testJump()
+{
+    // Around block boundaries, then either side of the polynomial path
+    static const uint64_t lengths[] = { 0, 1, 623, 624, 625, 100003, 8388607, 9000001 };
+
+    for( size_t i = 0; i < sizeof( lengths ) / sizeof( lengths[0] ); ++i )
+    {
+        MTRand<Integer> jumped( 99u ), stepped( 99u );
+        jumped.next();
+        stepped.next();
+
+        jumped.jump( lengths[ i ] );
+        for( uint64_t j = 0; j < lengths[ i ]; ++j )
+            stepped.next();
+
+        for( int j = 0; j < 1000; ++j )
+            if( jumped.next() != stepped.next() )
+            {
+                std::cerr << "MTRand" << sizeof( Integer )*8 << "::jump( "
+                          << lengths[ i ] << " ) differs from next()" << std::endl;
+                return false;
+            }
+    }
+
+    // Too far to check against next(), but jumps must compose
+    const uint64_t a = 1ull << 50, b = 12345678901ull;
+    MTRand<Integer> twice( 7u ), once( 7u );
+    twice.jump( a );
+    twice.jump( b );
+    once.jump( a + b );
+    for( int j = 0; j < 1000; ++j )
+        if( twice.next() != once.next() )
+        {
+            std::cerr << "MTRand" << sizeof( Integer )*8 << " jumps do not compose"
+                      << std::endl;
+            return false;
+        }
+
+    return true;
+}
+
+
+template <typename Integer>
+bool testMTRandSplit( unsigned num_threads, uint64_t stride )
+{
+    const Integer seed = 4357u;
+
+    std::vector< MTRand<Integer> > streams;
+    Timer timer;
+    timer.start();
+    MTRand<Integer>::split( seed, stride, num_threads, streams );
+    const double split_time = timer.getTimeElapsed();
+
+    std::vector<Digest> parallel( num_threads );
+    std::vector<std::thread> threads;
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads.push_back( std::thread( [ &, t ]()
+        {
+            for( uint64_t i = 0; i < stride; ++i )
+                parallel[ t ].add( streams[ t ].next() );
+        } ) );
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads[ t ].join();
+
+    bool ok = true;
+    MTRand<Integer> serial( seed );
+    for( unsigned t = 0; t < num_threads; ++t )
+    {
+        Digest digest;
+        for( uint64_t i = 0; i < stride; ++i )
+            digest.add( serial.next() );
+        ok = ok && digest.value == parallel[ t ].value;
+    }
+
+    std::cout << std::setw( 12 ) << ( sizeof( Integer ) == 4 ? "MTRand32" : "MTRand64" )
+              << std::setw( 10 ) << num_threads
+              << std::setw( 12 ) << stride
+              << std::setw( 12 ) << std::fixed << std::setprecision( 2 ) << split_time*1000.0
+              << std::setw( 8 )  << ( ok ? "ok" : "FAILED" )
+              << std::endl;
+    return ok;
+}
+
+
+bool testSobolSplit( unsigned num_threads, unsigned stride )
+{
+    const unsigned num_dims = Sobol::NUM_DIMS;
+    const unsigned scramble = 0x5a5a5u;
+
+    std::vector<Sobol::Stream> streams;
+    Sobol::split( stride, num_threads, streams, scramble );
+
+    // Even threads read one element at a time, odd threads in batches
+    std::vector<unsigned> parallel( num_threads*stride*num_dims );
+    std::vector<std::thread> threads;
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads.push_back( std::thread( [ &, t ]()
+        {
+            Sobol::Stream& stream = streams[ t ];
+            unsigned* out = &parallel[ t*stride*num_dims ];
+            if( t % 2 == 0 )
+            {
+                for( ; !stream.done(); stream.next() )
+                    for( unsigned d = 0; d < num_dims; ++d )
+                        *out++ = stream.genu( d );
+            }
+            else
+            {
+                const unsigned half = stride / 2;
+                stream.genuBatch( half, 0, num_dims, out );
+                stream.genuBatch( stride - half, 0, num_dims, out + half*num_dims );
+            }
+        } ) );
+    for( unsigned t = 0; t < num_threads; ++t )
+        threads[ t ].join();
+
+    bool ok = true;
+    for( unsigned i = 0; i < num_threads*stride; ++i )
+        for( unsigned d = 0; d < num_dims; ++d )
+            ok = ok && parallel[ i*num_dims + d ] == Sobol::genu( i, d, scramble );
+
+    std::cout << std::setw( 12 ) << "Sobol"
+              << std::setw( 10 ) << num_threads
+              << std::setw( 12 ) << stride
+              << std::setw( 12 ) << "-"
+              << std::setw( 8 )  << ( ok ? "ok" : "FAILED" )
+              << std::endl;
+    return ok;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned max_threads = argc > 1 ? atoi( argv[1] ) : 8;
+
+    bool ok = testJump<uint32_t>();
+    ok = testJump<uint64_t>() && ok;
+
+    std::cout << std::setw( 12 ) << "generator"
+              << std::setw( 10 ) << "threads"
+              << std::setw( 12 ) << "stride"
+              << std::setw( 12 ) << "split ms"
+              << std::setw( 8 )  << "result"
+              << std::endl;
+
+    for( unsigned num_threads = 1; num_threads <= max_threads; num_threads *= 2 )
+    {
+        ok = testMTRandSplit<uint32_t>( num_threads, 100003 ) && ok;
+        ok = testMTRandSplit<uint64_t>( num_threads, 100003 ) && ok;
+        ok = testSobolSplit( num_threads, 10007 ) && ok;
+    }
+
+    // Long enough strides to take the polynomial jump path
+    ok = testMTRandSplit<uint32_t>( 4, 9000001 ) && ok;
+    ok = testMTRandSplit<uint64_t>( 4, 9000001 ) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include "../Filter.hpp"
+#include "../MTRand.hpp"
+#include "../Sobol.hpp"
+#include "../Timer.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Samples/sec for the sampling primitives: MTRand32/MTRand64 integer and
+// float output, Sobol::gen and the three filter warps.  Warps are fed
+// precomputed uniform samples so only the warp itself is timed.
+//
+// Usage: sampler_bench [samples, default 10000000]
+//
+//------------------------------------------------------------------------------
+
+using namespace legion;
+
+namespace
+{
+
+// Results are accumulated here so the optimizer cannot drop the work
+volatile float    s_float_sink;
+volatile uint64_t s_int_sink;
+
+
+void report( const char* name, double seconds, unsigned num_samples )
+{
+    std::cout << std::setw( 32 ) << name
+              << std::setw( 12 ) << std::fixed << std::setprecision( 4 ) << seconds
+              << std::setw( 14 ) << std::setprecision( 1 )
+              << num_samples / seconds * 1e-6
+              << std::endl;
+}
+
+
+template <typename Integer>
+void benchInteger( const char* name, unsigned num_samples )
+{
+    MTRand<Integer> rng;
+    Integer sum = 0;
+
+    Timer timer;
+    timer.start();
+    for( unsigned i = 0; i < num_samples; ++i )
+        sum ^= rng.next();
+    report( name, timer.getTimeElapsed(), num_samples );
+
+    s_int_sink = sum;
+}
+
+
+template <typename Integer>
+void benchFloat( const char* name, unsigned num_samples )
+{
+    MTRand<Integer> rng;
+    float sum = 0.0f;
+
+    Timer timer;
+    timer.start();
+    for( unsigned i = 0; i < num_samples; ++i )
+        sum += rng();
+    report( name, timer.getTimeElapsed(), num_samples );
+
+    s_float_sink = sum;
+}
+
+
+void benchSobol( unsigned num_samples )
+{
+    const unsigned num_points = num_samples / Sobol::NUM_DIMS;
+    float sum = 0.0f;
+
+    Timer timer;
+    timer.start();
+    for( unsigned i = 0; i < num_points; ++i )
+        for( unsigned d = 0; d < Sobol::NUM_DIMS; ++d )
+            sum += Sobol::gen( i, d );
+    report( "Sobol::gen", timer.getTimeElapsed(), num_points*Sobol::NUM_DIMS );
+
+    s_float_sink = sum;
+}
+
+
+void benchWarp( const char* name,
+                Vector2 ( *warp )( const Vector2& ),
+                const std::vector<Vector2>& samples )
+{
+    float sum = 0.0f;
+
+    Timer timer;
+    timer.start();
+    for( std::vector<Vector2>::const_iterator it = samples.begin(); it != samples.end(); ++it )
+    {
+        const Vector2 v = warp( *it );
+        sum += v.x + v.y;
+    }
+    report( name, timer.getTimeElapsed(), samples.size() );
+
+    s_float_sink = sum;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned num_samples = argc > 1 ? atoi( argv[1] ) : 10000000;
+
+    std::cout << std::setw( 32 ) << "sampler"
+              << std::setw( 12 ) << "seconds"
+              << std::setw( 14 ) << "Msamples/s"
+              << std::endl;
+
+    benchInteger<uint32_t>( "MTRand32::next",     num_samples );
+    benchInteger<uint64_t>( "MTRand64::next",     num_samples );
+    benchFloat  <uint32_t>( "MTRand32::operator()", num_samples );
+    benchFloat  <uint64_t>( "MTRand64::operator()", num_samples );
+    benchSobol( num_samples );
+
+    MTRand32 rng;
+    std::vector<Vector2> samples( num_samples );
+    for( unsigned i = 0; i < num_samples; ++i )
+        samples[ i ] = Vector2( rng(), rng() );
+
+    benchWarp( "warpSampleByBoxFilter",         warpSampleByBoxFilter,         samples );
+    benchWarp( "warpSampleByTentFilter",        warpSampleByTentFilter,        samples );
+    benchWarp( "warpSampleByCubicSplineFilter", warpSampleByCubicSplineFilter, samples );
+
+    return 0;
+}
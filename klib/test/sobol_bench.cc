@@ -0,0 +1,125 @@
+#include "../Sobol.hpp"
+#include "../Timer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// Checks Sobol::genuBatch/genBatch for bit-exact agreement with per-sample
+// Sobol::genu/gen over a range of start indices, dimension windows and
+// scrambles, then compares their throughput.
+//
+// Usage: sobol_bench [points, default 1000000] [dims, default NUM_DIMS]
+//
+//------------------------------------------------------------------------------
+
+using legion::Sobol;
+
+namespace
+{
+
+bool check( unsigned first, unsigned n, unsigned dim, unsigned num_dims, unsigned scramble )
+{
+    std::vector<unsigned> batch( n*num_dims );
+    std::vector<float>    batch_f( n*num_dims );
+    Sobol::genuBatch( first, n, dim, num_dims, &batch[ 0 ],   scramble );
+    Sobol::genBatch ( first, n, dim, num_dims, &batch_f[ 0 ], scramble );
+
+    for( unsigned j = 0; j < n; ++j )
+    {
+        for( unsigned d = 0; d < num_dims; ++d )
+        {
+            const unsigned u = Sobol::genu( first+j, dim+d, scramble );
+            const float    f = Sobol::gen ( first+j, dim+d, scramble );
+            if( batch[ j*num_dims + d ] != u ||
+                memcmp( &batch_f[ j*num_dims + d ], &f, sizeof( f ) ) != 0 )
+            {
+                std::cerr << "mismatch at i=" << first+j << " dim=" << dim+d
+                          << " scramble=" << scramble << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+void report( const char* name, double seconds, double samples )
+{
+    std::cout << std::setw( 16 ) << name
+              << std::setw( 12 ) << std::fixed << std::setprecision( 4 ) << seconds
+              << std::setw( 14 ) << std::setprecision( 1 ) << samples / seconds * 1e-6
+              << std::endl;
+}
+
+}
+
+
+int main( int argc, char** argv )
+{
+    const unsigned num_points = argc > 1 ? atoi( argv[1] ) : 1000000;
+    const unsigned num_dims   = argc > 2 ? atoi( argv[2] ) : Sobol::NUM_DIMS;
+
+    //
+    // Correctness
+    //
+    static const unsigned firsts[]    = { 0u, 1u, 7u, 1000u, 65535u, 0xFFFFF000u };
+    static const unsigned scrambles[] = { 0u, 0x12345u, 0xFFFFFFFFu };
+    static const unsigned windows[][2] =
+    {
+        { 0, Sobol::NUM_DIMS }, { 0, 1 }, { 13, 11 }, { 0, Sobol::MAX_DIMS }
+    };
+
+    bool ok = true;
+    for( unsigned f = 0; f < sizeof( firsts ) / sizeof( firsts[0] ); ++f )
+        for( unsigned s = 0; s < sizeof( scrambles ) / sizeof( scrambles[0] ); ++s )
+            for( unsigned w = 0; w < sizeof( windows ) / sizeof( windows[0] ); ++w )
+                ok = check( firsts[ f ], 4096, windows[ w ][ 0 ], windows[ w ][ 1 ],
+                            scrambles[ s ] ) && ok;
+
+    std::cout << ( ok ? "batch output matches genu/gen" : "BATCH OUTPUT MISMATCH" )
+              << std::endl;
+
+    //
+    // Throughput
+    //
+    const double num_samples = static_cast<double>( num_points )*num_dims;
+    std::vector<unsigned> out_u( num_points*num_dims );
+    std::vector<float>    out_f( num_points*num_dims );
+
+    std::cout << num_points << " points x " << num_dims << " dims" << std::endl;
+    std::cout << std::setw( 16 ) << "method"
+              << std::setw( 12 ) << "seconds"
+              << std::setw( 14 ) << "Msamples/s"
+              << std::endl;
+
+    Timer timer;
+    timer.start();
+    for( unsigned j = 0; j < num_points; ++j )
+        for( unsigned d = 0; d < num_dims; ++d )
+            out_u[ j*num_dims + d ] = Sobol::genu( j, d );
+    report( "genu", timer.getTimeElapsed(), num_samples );
+
+    timer.reset();
+    timer.start();
+    Sobol::genuBatch( 0, num_points, 0, num_dims, &out_u[ 0 ] );
+    report( "genuBatch", timer.getTimeElapsed(), num_samples );
+
+    timer.reset();
+    timer.start();
+    for( unsigned j = 0; j < num_points; ++j )
+        for( unsigned d = 0; d < num_dims; ++d )
+            out_f[ j*num_dims + d ] = Sobol::gen( j, d );
+    report( "gen", timer.getTimeElapsed(), num_samples );
+
+    timer.reset();
+    timer.start();
+    Sobol::genBatch( 0, num_points, 0, num_dims, &out_f[ 0 ] );
+    report( "genBatch", timer.getTimeElapsed(), num_samples );
+
+    return ok ? 0 : 1;
+}